@@ -12,10 +12,20 @@ set CFLAGS=-Wall -g3
 set LINKER=-lSDL2 -lSDL2main
 SET PFLAGS=-D_CRT_SECURE_NO_WARNINGS -D_CRT_NONSTDC_NO_DEPRECATE
 
+REM Debug Only Features (empty this out for release builds)
+SET DFLAGS=-DDEBUG_DRAW
+
 REM Core Exe
 SET SOURCES=src\*.c
-clang %IDIR% %LDIR% -o %NAME%.exe %CFLAGS% %PFLAGS% %SOURCES% %LINKER%
+clang %IDIR% %LDIR% -o %NAME%.exe %CFLAGS% %PFLAGS% %DFLAGS% %SOURCES% %LINKER%
 SET SOURCES=
 
+REM Asset Packer
+clang -o pak.exe %CFLAGS% %PFLAGS% tools\pak.c src\pak.c
+pak.exe -ext .png assets.pak assets/sprites
+
+REM Trace Decoder
+clang -o tracedump.exe %CFLAGS% %PFLAGS% tools\tracedump.c
+
 REM END
 
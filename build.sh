@@ -0,0 +1,23 @@
+#!/bin/sh
+
+# Linux build, mirrors build.bat
+# Needs the SDL2 development package (sdl2-config on the PATH)
+
+NAME=$(cat name.txt)
+
+CFLAGS="-Wall -g3"
+LINKER="$(sdl2-config --libs) -lm"
+
+# Debug Only Features (empty this out for release builds)
+DFLAGS="-DDEBUG_DRAW"
+
+# Core Exe
+SOURCES="src/*.c"
+cc $(sdl2-config --cflags) -o $NAME $CFLAGS $DFLAGS $SOURCES $LINKER
+
+# Asset Packer
+cc -o pak $CFLAGS tools/pak.c src/pak.c
+./pak -ext .png assets.pak assets/sprites
+
+# Trace Decoder
+cc -o tracedump $CFLAGS tools/tracedump.c
@@ -2,5 +2,5 @@
 
 set /p NAME=<name.txt
 
-del /F /Q %NAME%.exe *.exp *.lib *.ilk *.pdb
+del /F /Q %NAME%.exe pak.exe assets.pak *.exp *.lib *.ilk *.pdb
 
@@ -0,0 +1,278 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-25 19:03:12
+ *
+ * Linear Arena
+ */
+
+#include "common.h"
+
+#include "arena.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+
+// transparent huge pages are 2M on x86_64, and on arm64 with 4k pages
+#define HUGEPAGE_SIZE (2 << 20)
+#endif
+
+// ArenaBlockAlloc : the arena's block, from malloc, or the os for ARENA_HUGEPAGES
+static u8 *ArenaBlockAlloc(struct arena_t *arena, size_t size)
+{
+	if (arena->flags & ARENA_HUGEPAGES)
+		return ArenaPageAlloc(size, 1);
+	return C_ALLOC(arena->tag, size);
+}
+
+// ArenaBlockFree : frees a block from ArenaBlockAlloc
+static void ArenaBlockFree(struct arena_t *arena, u8 *base, size_t size)
+{
+	if (base == NULL)
+		return;
+
+	if (arena->flags & ARENA_HUGEPAGES) {
+		ArenaPageFree(base, size, 1);
+	} else {
+		C_FREE(base);
+	}
+}
+
+// ArenaInit : sets up an arena with size bytes (0 is fine, it grows on the first reset)
+s32 ArenaInit(struct arena_t *arena, char *name, s32 tag, size_t size, u32 flags)
+{
+	assert(arena);
+
+	memset(arena, 0, sizeof(*arena));
+
+	arena->name = name;
+	arena->tag = tag;
+	arena->flags = flags;
+
+	if (size == 0)
+		return 0;
+
+	arena->base = ArenaBlockAlloc(arena, size);
+	if (arena->base == NULL) {
+		ERR("Couldn't allocate %zu bytes for the '%s' arena\n", size, name);
+		return -1;
+	}
+
+	arena->size = size;
+
+	return 0;
+}
+
+// ArenaAlloc : bytes of uninitialized memory, good until the next reset
+void *ArenaAlloc(struct arena_t *arena, size_t bytes)
+{
+	void *p;
+	size_t at;
+
+	assert(arena);
+
+	arena->allocs++;
+
+	at = (arena->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+	if (at + bytes <= arena->size) {
+		arena->used = at + bytes;
+		arena->high = MAX(arena->high, arena->used + arena->spilled);
+		return arena->base + at;
+	}
+
+	// it doesn't fit, so this frame gets a malloc, and the next reset makes room for it
+	p = C_ALLOC(arena->tag, bytes);
+	if (p == NULL) {
+		ERR("Couldn't spill %zu bytes out of the '%s' arena\n", bytes, arena->name);
+		abort();
+	}
+
+	*C_PUSH(&arena->spills) = p;
+	arena->spilled += bytes + ARENA_ALIGN;
+	arena->high = MAX(arena->high, arena->used + arena->spilled);
+
+	return p;
+}
+
+// ArenaAllocZero : ArenaAlloc, zeroed
+void *ArenaAllocZero(struct arena_t *arena, size_t bytes)
+{
+	void *p;
+
+	p = ArenaAlloc(arena, bytes);
+	memset(p, 0, bytes);
+
+	return p;
+}
+
+// ArenaReset : frees everything at once (and grows the arena, if anything spilled)
+void ArenaReset(struct arena_t *arena)
+{
+	size_t i, size;
+	u8 *base;
+
+	assert(arena);
+
+	arena->last = arena->high;
+	arena->peak = MAX(arena->peak, arena->high);
+	arena->resets++;
+
+	if (arena->spills_len) {
+		for (i = 0; i < arena->spills_len; i++) {
+			C_FREE(arena->spills[i]);
+		}
+
+		// room for the worst frame so far, and then some, so this doesn't happen every frame
+		size = MAX(arena->size * 2, arena->peak + arena->peak / 2);
+
+		// everything in it is dead, so there's nothing to copy over
+		base = ArenaBlockAlloc(arena, size);
+		if (base) {
+			ArenaBlockFree(arena, arena->base, arena->size);
+			arena->base = base;
+			arena->size = size;
+		}
+
+		arena->spills_len = 0;
+		arena->spilled = 0;
+	}
+
+	arena->used = 0;
+	arena->high = 0;
+}
+
+// ArenaReserve : makes sure an empty arena holds at least size bytes
+s32 ArenaReserve(struct arena_t *arena, size_t size)
+{
+	u8 *base;
+
+	assert(arena);
+	assert(arena->used == 0);
+
+	if (size <= arena->size)
+		return 0;
+
+	// nothing in it is alive, so there's nothing to copy
+	base = ArenaBlockAlloc(arena, size);
+	if (base == NULL) {
+		ERR("Couldn't grow the '%s' arena to %zu bytes\n", arena->name, size);
+		return -1;
+	}
+
+	ArenaBlockFree(arena, arena->base, arena->size);
+
+	arena->base = base;
+	arena->size = size;
+
+	return 0;
+}
+
+// ArenaFree : releases the arena
+void ArenaFree(struct arena_t *arena)
+{
+	size_t i;
+
+	assert(arena);
+
+	for (i = 0; i < arena->spills_len; i++) {
+		C_FREE(arena->spills[i]);
+	}
+
+	C_FREE(arena->spills);
+	ArenaBlockFree(arena, arena->base, arena->size);
+
+	memset(arena, 0, sizeof(*arena));
+}
+
+#if defined(__linux__)
+
+// ArenaPageAlloc : size bytes of zeroed, page aligned memory from the os (huge pages if asked, and we can)
+void *ArenaPageAlloc(size_t size, s32 huge)
+{
+	u8 *p, *aligned;
+	size_t over;
+
+	if (!huge) {
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return p == MAP_FAILED ? NULL : p;
+	}
+
+	// the kernel only backs whole, aligned 2M ranges with a huge page, so we map an extra one, and
+	// trim the ends off to get there
+	size = (size + HUGEPAGE_SIZE - 1) & ~(size_t)(HUGEPAGE_SIZE - 1);
+	over = size + HUGEPAGE_SIZE;
+
+	p = mmap(NULL, over, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+
+	aligned = (u8 *)(((uintptr_t)p + HUGEPAGE_SIZE - 1) & ~(uintptr_t)(HUGEPAGE_SIZE - 1));
+
+	if (aligned != p)
+		munmap(p, aligned - p);
+	if (aligned + size != p + over)
+		munmap(aligned + size, (p + over) - (aligned + size));
+
+	// just advice, with transparent huge pages off this is the same as a normal mapping
+	if (madvise(aligned, size, MADV_HUGEPAGE) < 0) {
+		WRN("The os won't give us huge pages, using normal ones\n");
+	}
+
+	return aligned;
+}
+
+// ArenaPageFree : releases an ArenaPageAlloc, with the same size and huge
+void ArenaPageFree(void *p, size_t size, s32 huge)
+{
+	if (p == NULL)
+		return;
+
+	if (huge)
+		size = (size + HUGEPAGE_SIZE - 1) & ~(size_t)(HUGEPAGE_SIZE - 1);
+
+	munmap(p, size);
+}
+
+#elif defined(_WIN32)
+
+// ArenaPageAlloc : size bytes of zeroed, page aligned memory from the os (huge pages if asked, and we can)
+void *ArenaPageAlloc(size_t size, s32 huge)
+{
+	void *p;
+
+	// NOTE (Brian) large pages on windows need SeLockMemoryPrivilege, so huge is ignored here
+	p = _aligned_malloc(size, 4096);
+	if (p)
+		memset(p, 0, size);
+
+	return p;
+}
+
+// ArenaPageFree : releases an ArenaPageAlloc, with the same size and huge
+void ArenaPageFree(void *p, size_t size, s32 huge)
+{
+	_aligned_free(p);
+}
+
+#else
+
+// ArenaPageAlloc : size bytes of zeroed, page aligned memory from the os (huge pages if asked, and we can)
+void *ArenaPageAlloc(size_t size, s32 huge)
+{
+	void *p;
+
+	if (posix_memalign(&p, 4096, size) != 0)
+		return NULL;
+
+	memset(p, 0, size);
+
+	return p;
+}
+
+// ArenaPageFree : releases an ArenaPageAlloc, with the same size and huge
+void ArenaPageFree(void *p, size_t size, s32 huge)
+{
+	free(p);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-25 19:03:12
+ *
+ * Linear Arena
+ *
+ * A bump allocator, for scratch memory that all dies at the same time. Allocating is a pointer
+ * bump, and freeing everything is setting used back to zero, with ArenaReset.
+ *
+ * The frame arena (and one per job pool worker, see JobScratch) gets reset at the end of every
+ * frame, so per-frame scratch (sort buffers, sampled rows, ...) never touches malloc. If a frame
+ * asks for more than the arena has, the extra comes from malloc ("spills"), and the next reset
+ * grows the arena to fit, so after the first few frames it's always big enough.
+ *
+ * Arenas that live longer than a frame (the level's entity pools) know how big they need to be up
+ * front, and use ArenaReserve right after a reset, so they never spill.
+ *
+ * With ARENA_HUGEPAGES, the arena's block comes straight from the os with ArenaPageAlloc, on huge
+ * pages where the os will give them to us, so a big pool that gets walked every frame costs a
+ * handful of TLB entries instead of one per 4k page. Those (and anything else from ArenaPageAlloc)
+ * aren't heap, so they don't show up in the C_ALLOC tags (see common.h).
+ *
+ * used's high water mark is kept for the current frame (high), the last one (last), and since the
+ * arena was made (peak).
+ *
+ * USAGE
+ *   u32 *row = ARENA_ARRAY(arena, u32, w);
+ */
+
+#include "common.h"
+
+#define ARENA_ALIGN (16)
+
+// flags
+#define ARENA_HUGEPAGES (0x01)
+
+struct arena_t {
+	char *name;
+	s32 tag; // MEM_*, what the block and the spills count against
+	u32 flags;
+
+	u8 *base;
+	size_t size;
+	size_t used;
+
+	// allocations that didn't fit, freed at the next reset
+	void **spills;
+	size_t spills_len, spills_cap;
+	size_t spilled; // bytes
+
+	size_t high; // this frame's high water mark
+	size_t last; // last frame's
+	size_t peak; // every frame's
+	u64 resets;
+	u64 allocs; // every allocation it's made, resets don't clear it
+};
+
+// ArenaInit : sets up an arena with size bytes (0 is fine, it grows on the first reset)
+s32 ArenaInit(struct arena_t *arena, char *name, s32 tag, size_t size, u32 flags);
+
+// ArenaAlloc : bytes of uninitialized memory, good until the next reset
+void *ArenaAlloc(struct arena_t *arena, size_t bytes);
+
+// ArenaAllocZero : ArenaAlloc, zeroed
+void *ArenaAllocZero(struct arena_t *arena, size_t bytes);
+
+// ArenaReset : frees everything at once (and grows the arena, if anything spilled)
+void ArenaReset(struct arena_t *arena);
+
+// ArenaReserve : makes sure an empty arena holds at least size bytes
+s32 ArenaReserve(struct arena_t *arena, size_t size);
+
+// ArenaFree : releases the arena
+void ArenaFree(struct arena_t *arena);
+
+// ArenaPageAlloc : size bytes of zeroed, page aligned memory from the os (huge pages if asked, and we can)
+void *ArenaPageAlloc(size_t size, s32 huge);
+
+// ArenaPageFree : releases an ArenaPageAlloc, with the same size and huge
+void ArenaPageFree(void *p, size_t size, s32 huge);
+
+#define ARENA_ARRAY(arena, T, n) ((T *)ArenaAlloc((arena), sizeof(T) * (n)))
+
+#endif // ARENA_H
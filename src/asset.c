@@ -11,30 +11,352 @@
 
 #include "asset.h"
 
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+
 extern SDL_Renderer *gRenderer;
 
-// AssetLoad : loads a single asset from disk
-s32 AssetLoad(struct asset_container_t *container, char *path)
+static char *asset_state[ASSET_TOTAL] = {
+	"loading",  // ASSET_LOADING
+	"ready",    // ASSET_READY
+	"failed",   // ASSET_FAILED
+	"unloaded", // ASSET_UNLOADED
+};
+
+// NOTE (Brian) the decoded (premultiplied) pixels get cached on disk, so a warm start can map
+// them instead of inflating every png again. A blob is a header, then w * h RGBA pixels, and it's
+// only good while the source's size and stamp (mtime for loose files, a content hash for files in
+// the pak) match what's in the header.
+#define ASSET_CACHE_MAGIC   ("ARGB")
+#define ASSET_CACHE_VERSION (1)
+
+struct assetcachehdr_t {
+	char magic[4];
+	u32 version;
+	s32 w, h, c;
+	u32 reserved[3];
+	u64 srcsize;
+	u64 srcstamp;
+};
+
+// assetjob_t : one decode; async ones are owned by the worker until they're on the upload queue
+struct assetjob_t {
+	struct asset_container_t *container;
+	s32 idx;
+	char *path;
+	void *bytes;
+	s32 w, h, c;
+	u8 *map;         // when bytes came straight out of the cache
+	size_t map_size;
+	s32 cached;
+	u32 flags;
+	struct mask_t *mask;
+	s32 reload;      // replacing an asset that's already loaded
+	u64 queued;      // performance counter, when the reload was noticed
+	f32 decode_ms;
+	u8 *file;        // the whole source file, when it was streamed in (see AssetLoadBatch)
+	size_t file_size;
+	u64 file_stamp;
+};
+
+// assetchange_t : a file the watcher saw change, waiting on the main thread
+struct assetchange_t {
+	char *path;
+	u64 at;
+};
+
+// AssetHashBytes : 64 bit FNV-1a, over a buffer
+static u64 AssetHashBytes(u8 *p, size_t n)
+{
+	u64 hash;
+	size_t i;
+
+	for (i = 0, hash = 0xcbf29ce484222325ull; i < n; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+// AssetFileStamp : a loose file's modification time, as finely as the platform keeps it
+static u64 AssetFileStamp(struct stat *st)
 {
+	// NOTE (Brian) seconds aren't enough, an editor can save twice in one, at the same size
+#if defined(__linux__)
+	return (u64)st->st_mtim.tv_sec * 1000000000ull + (u64)st->st_mtim.tv_nsec;
+#else
+	return (u64)st->st_mtime;
+#endif
+}
+
+// AssetPremultiply : multiplies the color channels by alpha, in place
+static void AssetPremultiply(u8 *p, s32 w, s32 h)
+{
+	s32 i;
+	u32 a;
+
+	for (i = 0; i < w * h; i++, p += 4) {
+		a = p[3];
+		if (a == 255)
+			continue;
+
+		p[0] = (p[0] * a + 127) / 255;
+		p[1] = (p[1] * a + 127) / 255;
+		p[2] = (p[2] * a + 127) / 255;
+	}
+}
+
+// AssetMakeDir : makes a directory, if it isn't already there
+static void AssetMakeDir(char *path)
+{
+#if defined(_WIN32)
+	_mkdir(path);
+#else
+	mkdir(path, 0755);
+#endif
+}
+
+// AssetCachePath : where the cached pixels for path live
+static void AssetCachePath(struct asset_container_t *container, char *path, char *buf, size_t len)
+{
+	snprintf(buf, len, "%s/%016llx.rgba", container->cachedir, PakHash(path));
+}
+
+// AssetCacheRead : maps the cached pixels for the job, if they're still good
+static s32 AssetCacheRead(struct assetjob_t *job, u64 srcsize, u64 srcstamp)
+{
+	struct assetcachehdr_t *hdr;
+	char cachepath[BUFLARGE];
+	u8 *map;
+	size_t size;
+
+	AssetCachePath(job->container, job->path, cachepath, sizeof cachepath);
+
+	map = PakMapFile(cachepath, &size);
+	if (map == NULL)
+		return -1;
+
+	hdr = (struct assetcachehdr_t *)map;
+
+	if (size < sizeof(*hdr) ||
+		memcmp(hdr->magic, ASSET_CACHE_MAGIC, sizeof(hdr->magic)) != 0 ||
+		hdr->version != ASSET_CACHE_VERSION ||
+		hdr->srcsize != srcsize || hdr->srcstamp != srcstamp ||
+		size - sizeof(*hdr) != (size_t)hdr->w * hdr->h * 4) {
+		PakUnmapFile(map, size);
+		return -1;
+	}
+
+	job->bytes = map + sizeof(*hdr);
+	job->w = hdr->w;
+	job->h = hdr->h;
+	job->c = hdr->c;
+	job->map = map;
+	job->map_size = size;
+	job->cached = 1;
+
+	return 0;
+}
+
+// AssetCacheWrite : writes the job's pixels to the cache
+static void AssetCacheWrite(struct assetjob_t *job, u64 srcsize, u64 srcstamp)
+{
+	struct assetcachehdr_t hdr;
+	char cachepath[BUFLARGE], tmppath[BUFLARGE + 8];
+	size_t n;
+	FILE *fp;
+
+	AssetMakeDir(job->container->cachedir);
+
+	AssetCachePath(job->container, job->path, cachepath, sizeof cachepath);
+	snprintf(tmppath, sizeof tmppath, "%s.tmp", cachepath);
+
+	memset(&hdr, 0, sizeof hdr);
+	memcpy(hdr.magic, ASSET_CACHE_MAGIC, sizeof hdr.magic);
+	hdr.version = ASSET_CACHE_VERSION;
+	hdr.w = job->w;
+	hdr.h = job->h;
+	hdr.c = job->c;
+	hdr.srcsize = srcsize;
+	hdr.srcstamp = srcstamp;
+
+	fp = fopen(tmppath, "wb");
+	if (fp == NULL) {
+		WRN("Couldn't write to the asset cache '%s'\n", tmppath);
+		return;
+	}
+
+	n = (size_t)job->w * job->h * 4;
+
+	if (fwrite(&hdr, sizeof hdr, 1, fp) != 1 || fwrite(job->bytes, 1, n, fp) != n) {
+		WRN("Couldn't write to the asset cache '%s'\n", tmppath);
+		fclose(fp);
+		remove(tmppath);
+		return;
+	}
+
+	fclose(fp);
+
+	// write, then rename, so a half written blob never has the real name
+	remove(cachepath);
+	if (rename(tmppath, cachepath) != 0) {
+		remove(tmppath);
+	}
+}
+
+// AssetBuildMask : builds the collision mask, if the job wants one
+static void AssetBuildMask(struct assetjob_t *job)
+{
+	if (!(job->flags & ASSET_MASK) || job->bytes == NULL)
+		return;
+
+	job->mask = C_CALLOC(MEM_ASSET, 1, sizeof(*job->mask));
+
+	if (MaskBuild(job->mask, job->bytes, job->w, job->h) < 0) {
+		C_FREE(job->mask);
+		job->mask = NULL;
+	}
+}
+
+// AssetDecode : fills out the job's pixels, from the cache, the pak, or the filesystem (in that order)
+static void AssetDecode(struct assetjob_t *job)
+{
+	struct asset_container_t *container;
+	struct pakentry_t *entry;
+	struct stat st;
+	u8 *src;
+	u64 srcsize, srcstamp;
+
+	container = job->container;
+
+	src = NULL;
+	srcsize = srcstamp = 0;
+
+	// reloads are for files that changed on disk, so the pak's copy is stale
+	entry = container->pak && !job->reload ? PakFind(container->pak, job->path) : NULL;
+
+	if (entry) {
+		src = PakData(container->pak, entry);
+		srcsize = entry->size;
+		srcstamp = AssetHashBytes(src, entry->size);
+	} else if (job->file) {
+		src = job->file;
+		srcsize = job->file_size;
+		srcstamp = job->file_stamp;
+	} else if (stat(job->path, &st) == 0) {
+		srcsize = st.st_size;
+		srcstamp = AssetFileStamp(&st);
+	}
+
+	// a reload always decodes the file (the stamp can't be trusted to have moved), but still
+	// writes the new blob below
+	if (container->cachedir && !job->reload && AssetCacheRead(job, srcsize, srcstamp) == 0) {
+		AssetBuildMask(job);
+		return;
+	}
+
+	if (src) {
+		// stb reads straight out of the mapping (or the streamed buffer), no copy
+		job->bytes = stbi_load_from_memory(src, (int)srcsize, &job->w, &job->h, &job->c, 4);
+	} else {
+		job->bytes = stbi_load(job->path, &job->w, &job->h, &job->c, 4);
+	}
+
+	if (job->bytes == NULL)
+		return;
+
+	AssetPremultiply(job->bytes, job->w, job->h);
+
+	if (container->cachedir) {
+		AssetCacheWrite(job, srcsize, srcstamp);
+	}
+
+	AssetBuildMask(job);
+}
+
+// AssetCreateSlot : adds an (empty) asset to the container, returns its index
+static s32 AssetCreateSlot(struct asset_container_t *container, char *path, u32 flags)
+{
+	struct asset_t *asset;
+
+	asset = C_PUSH(&container->assets);
+
+	asset->id = asset - container->assets;
+	asset->colormod = 0xffffff; // SDL textures start out unmodulated
+	asset->state = ASSET_LOADING;
+	asset->flags = flags;
+	asset->pivot_x = asset->pivot_y = 0.5f;
+	asset->path = strdup_null(path);
+
+	// asset->name = strdup_null(strrchr(path, '/') + 1);
+	asset->name = strslice(path, strrchr(path, '/') - path + 1, strrchr(path, '.') - path);
+
+	return asset->id;
+}
+
+// AssetFreePixels : releases the cpu copy of the pixels
+static void AssetFreePixels(struct asset_t *asset)
+{
+	if (asset->map) {
+		PakUnmapFile(asset->map, asset->map_size);
+	} else {
+		stbi_image_free(asset->bytes);
+	}
+
+	asset->bytes = NULL;
+	asset->map = NULL;
+	asset->map_size = 0;
+}
+
+// AssetJobFree : releases whatever pixels (and mask) a job is still holding
+static void AssetJobFree(struct assetjob_t *job)
+{
+	if (job->map) {
+		PakUnmapFile(job->map, job->map_size);
+	} else {
+		stbi_image_free(job->bytes);
+	}
+
+	if (job->mask) {
+		MaskFree(job->mask);
+		C_FREE(job->mask);
+	}
+
+	job->bytes = NULL;
+	job->map = NULL;
+	job->mask = NULL;
+}
+
+// AssetUpload : takes ownership of the job's pixels, and makes the texture for them
+static s32 AssetUpload(struct asset_container_t *container, struct assetjob_t *job)
+{
+	struct asset_t *asset;
 	SDL_Surface *surface;
-	s32 x, y, n;
+	SDL_Texture *texture;
+	SDL_BlendMode premultiplied;
 	u32 rmask, gmask, bmask, amask;
-	struct asset_t *asset;
+	u64 start;
 
-	C_RESIZE(&container->assets);
+	start = SDL_GetPerformanceCounter();
 
-	asset = container->assets + container->assets_len++;
+	asset = container->assets + job->idx;
 
-	// get bytes from the image itself off of disk
-	asset->bytes = stbi_load(path, &x, &y, &n, 4);
-	if (!asset->bytes) {
-		ERR("COULDN'T LOAD IMAGE '%s'\n", path);
+	// a reload that doesn't work out just leaves the old asset where it was
+	if (!job->bytes) {
+		ERR("COULDN'T LOAD IMAGE '%s'\n", asset->path);
+		if (!job->reload)
+			asset->state = ASSET_FAILED;
 		return -1;
 	}
 
-	asset->w = x;
-	asset->h = y;
-	asset->c = n;
+	if (job->cached) {
+		container->cache_hits++;
+	} else {
+		container->cache_misses++;
+	}
 
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
     rmask = 0xff000000;
@@ -48,26 +370,708 @@ s32 AssetLoad(struct asset_container_t *container, char *path)
     amask = 0xff000000;
 #endif
 
-	// then make an SDL surface for it
-	surface = SDL_CreateRGBSurfaceFrom(asset->bytes, x, y, 32, 4 * x, rmask, gmask, bmask, amask);
-	if (surface == NULL) {
-		ERR("SDL_CreateRGBSurface failed for '%s': %s\n", path, SDL_GetError());
+	texture = NULL;
+
+	// then create a texture (headless runs don't have a renderer), through a surface that's just a header
+	if (gRenderer) {
+		surface = SDL_CreateRGBSurfaceFrom(job->bytes, job->w, job->h, 32, 4 * job->w, rmask, gmask, bmask, amask);
+		if (surface == NULL) {
+			ERR("SDL_CreateRGBSurface failed for '%s': %s\n", asset->path, SDL_GetError());
+			AssetJobFree(job);
+			if (!job->reload)
+				asset->state = ASSET_FAILED;
+			return -1;
+		}
+
+		texture = SDL_CreateTextureFromSurface(gRenderer, surface);
+		SDL_FreeSurface(surface);
+
+		if (texture == NULL) {
+			ERR("SDL_CreateTextureFromSurface failed for '%s': %s\n", asset->path, SDL_GetError());
+			AssetJobFree(job);
+			if (!job->reload)
+				asset->state = ASSET_FAILED;
+			return -1;
+		}
+
+		// the pixels are premultiplied, so: src + dst * (1 - src alpha)
+		premultiplied = SDL_ComposeCustomBlendMode(
+			SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+			SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+
+		if (SDL_SetTextureBlendMode(texture, premultiplied) < 0) {
+			WRN("Renderer can't do premultiplied alpha, '%s' will have dark edges: %s\n", asset->path, SDL_GetError());
+		}
+	}
+
+	// everything worked, so swap out whatever was there before (for a reload)
+	if (asset->texture)
+		SDL_DestroyTexture(asset->texture);
+
+	AssetFreePixels(asset);
+
+	if (asset->mask) {
+		MaskFree(asset->mask);
+		C_FREE(asset->mask);
+	}
+
+	asset->texture = texture;
+	asset->colormod = 0xffffff; // new textures start out unmodulated
+	asset->bytes = job->bytes;
+	asset->map = job->map;
+	asset->map_size = job->map_size;
+	asset->w = job->w;
+	asset->h = job->h;
+	asset->c = job->c;
+	asset->mask = job->mask;
+
+	if (asset->mask && asset->radius > 0) {
+		asset->mask->radius = asset->radius;
+	}
+
+	// the texture has its own copy, so unless somebody on the cpu wants them, the pixels can go
+	if (asset->texture && !(asset->flags & ASSET_CPU_PIXELS)) {
+		AssetFreePixels(asset);
+	}
+
+	asset->state = ASSET_READY;
+	asset->last_used = container->frame;
+
+	asset->decode_ms = job->decode_ms;
+	asset->upload_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+	if (job->reload) {
+		LOG("reloaded '%s' %.3f ms after it changed\n", asset->name,
+			(SDL_GetPerformanceCounter() - job->queued) * 1000.0 / SDL_GetPerformanceFrequency());
+	}
+
+	return 0;
+}
+
+// AssetLoadSlot : loads an asset that already has a slot, right now
+static s32 AssetLoadSlot(struct asset_container_t *container, s32 idx)
+{
+	struct assetjob_t job;
+	struct asset_t *asset;
+	u64 start;
+
+	asset = container->assets + idx;
+
+	memset(&job, 0, sizeof job);
+
+	job.container = container;
+	job.idx = idx;
+	job.path = asset->path;
+	job.flags = asset->flags;
+
+	asset->state = ASSET_LOADING;
+
+	start = SDL_GetPerformanceCounter();
+	AssetDecode(&job);
+	job.decode_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+	return AssetUpload(container, &job);
+}
+
+// AssetLoad : loads a single asset from disk
+s32 AssetLoad(struct asset_container_t *container, char *path, u32 flags)
+{
+	return AssetLoadSlot(container, AssetCreateSlot(container, path, flags));
+}
+
+// AssetDecodeJob : decodes the png on a worker, then queues it up for the main thread
+static void AssetDecodeJob(void *arg, s32 worker)
+{
+	struct assetjob_t *job;
+	struct asset_container_t *container;
+	u64 start;
+
+	job = arg;
+	container = job->container;
+
+	start = SDL_GetPerformanceCounter();
+	AssetDecode(job);
+	job->decode_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+	// the pixels don't point into the file, so it can go now
+	C_FREE(job->file);
+	job->file = NULL;
+
+	SDL_LockMutex(container->lock);
+	C_RESIZE(&container->uploads);
+	container->uploads[container->uploads_len++] = job;
+	SDL_UnlockMutex(container->lock);
+}
+
+// AssetCreateLock : makes the lock that guards the upload (and change) queues, if we need to
+static s32 AssetCreateLock(struct asset_container_t *container)
+{
+	if (container->lock)
+		return 0;
+
+	container->lock = SDL_CreateMutex();
+	if (container->lock == NULL) {
+		ERR("Couldn't create the asset upload lock: %s\n", SDL_GetError());
 		return -1;
 	}
 
-	// then create a texture from the surface
-	asset->texture = SDL_CreateTextureFromSurface(gRenderer, surface);
-	if (asset->texture == NULL) {
-		ERR("SDL_CreateTextureFromSurface failed for '%s': %s\n", path, SDL_GetError());
+	return 0;
+}
+
+// AssetCreateJob : makes the job for an async load of a slot, the load is in flight from here on
+static struct assetjob_t *AssetCreateJob(struct asset_container_t *container, struct jobpool_t *pool, s32 idx)
+{
+	struct assetjob_t *job;
+	struct asset_t *asset;
+
+	asset = container->assets + idx;
+
+	container->pool = pool;
+
+	job = C_CALLOC(MEM_ASSET, 1, sizeof(*job));
+
+	job->container = container;
+	job->idx = idx;
+	job->path = asset->path;
+	job->flags = asset->flags;
+
+	asset->state = ASSET_LOADING;
+
+	container->inflight++;
+
+	return job;
+}
+
+// AssetStreamDone : a streamed file is in, decode it (a failed read just makes the decode read it)
+static void AssetStreamDone(void *arg, u8 *buf, size_t size, s32 worker)
+{
+	struct assetjob_t *job;
+
+	job = arg;
+
+	job->file = buf;
+	job->file_size = size;
+
+	// a pool worker did the read, so it might as well do the decode too
+	if (worker >= 0) {
+		AssetDecodeJob(job, worker);
+	} else {
+		JobSubmit(job->container->pool, AssetDecodeJob, job);
+	}
+}
+
+// AssetLoadSlotAsync : loads an asset that already has a slot, on the job pool
+static s32 AssetLoadSlotAsync(struct asset_container_t *container, struct jobpool_t *pool, s32 idx)
+{
+	JobSubmit(pool, AssetDecodeJob, AssetCreateJob(container, pool, idx));
+
+	return 0;
+}
+
+// AssetLoadAsync : loads a single asset, decoding it on the job pool
+s32 AssetLoadAsync(struct asset_container_t *container, struct jobpool_t *pool, char *path, u32 flags)
+{
+	assert(container);
+	assert(pool);
+	assert(path);
+
+	if (AssetCreateLock(container) < 0) {
+		return AssetLoad(container, path, flags);
+	}
+
+	return AssetLoadSlotAsync(container, pool, AssetCreateSlot(container, path, flags));
+}
+
+// AssetQueueReload : decodes the asset's file again, on the pool (the container's lock is held)
+static void AssetQueueReload(struct asset_container_t *container, struct asset_t *asset, u64 at)
+{
+	struct assetjob_t *job;
+
+	job = C_CALLOC(MEM_ASSET, 1, sizeof(*job));
+
+	job->container = container;
+	job->idx = asset->id;
+	job->path = asset->path;
+	job->flags = asset->flags;
+	job->reload = 1;
+	job->queued = at;
+
+	asset->reloading = 1;
+	asset->reload_again = 0;
+
+	container->inflight++;
+
+	JobSubmit(container->pool, AssetDecodeJob, job);
+}
+
+// AssetUploadPump : creates textures for decoded assets (main thread), returns loads still in flight
+s32 AssetUploadPump(struct asset_container_t *container)
+{
+	struct assetjob_t *job;
+	struct assetchange_t *change;
+	struct asset_t *asset;
+	size_t i, j;
+
+	assert(container);
+
+	if (container->lock == NULL)
+		return 0;
+
+	// NOTE (Brian) the workers only ever hold the lock long enough to push a pointer, so doing the
+	// uploads while we hold it doesn't really hold anybody up
+	SDL_LockMutex(container->lock);
+
+	// files the watcher saw change get decoded again, on the pool, just like the first time
+	for (i = 0; i < container->changes_len; i++) {
+		change = container->changes + i;
+
+		for (j = 0; j < container->assets_len; j++) {
+			asset = container->assets + j;
+
+			if (!streq(asset->path, change->path))
+				continue;
+
+			// an evicted asset reads the new file whenever it's loaded again (reloading it here would
+			// skip the budget), and one that's still loading would end up with two decodes racing
+			if (asset->state != ASSET_READY)
+				continue;
+
+			// NOTE (Brian) same goes for a reload that's already going, it might have read the old
+			// file, so there's one more after it's done, but never two at once (uploads can finish
+			// in any order, and the older one could win)
+			if (asset->reloading) {
+				if (!asset->reload_again) {
+					asset->reload_again = 1;
+					asset->reload_at = change->at;
+				}
+				continue;
+			}
+
+			AssetQueueReload(container, asset, change->at);
+		}
+
+		C_FREE(change->path);
+	}
+
+	container->changes_len = 0;
+
+	for (i = 0; i < container->uploads_len; i++) {
+		job = container->uploads[i];
+		asset = container->assets + job->idx;
+
+		AssetUpload(container, job);
+
+		container->inflight--;
+
+		if (job->reload) {
+			asset->reloading = 0;
+			if (asset->reload_again) {
+				AssetQueueReload(container, asset, asset->reload_at);
+			}
+		}
+
+		C_FREE(job);
+	}
+
+	container->uploads_len = 0;
+
+	SDL_UnlockMutex(container->lock);
+
+	return container->inflight;
+}
+
+// AssetWatchChanged : (watcher thread) queues up a changed file for the main thread
+static void AssetWatchChanged(void *arg, char *path)
+{
+	struct asset_container_t *container;
+	struct assetchange_t *change;
+	size_t i;
+
+	container = arg;
+
+	SDL_LockMutex(container->lock);
+
+	// editors like to write a file a couple of times in a row, only reload it once
+	for (i = 0; i < container->changes_len; i++) {
+		if (streq(container->changes[i].path, path))
+			break;
+	}
+
+	if (i == container->changes_len) {
+		C_RESIZE(&container->changes);
+
+		change = container->changes + container->changes_len++;
+		change->path = strdup_null(path);
+		change->at = SDL_GetPerformanceCounter();
+	}
+
+	SDL_UnlockMutex(container->lock);
+}
+
+// AssetWatch : reloads assets in dir when they change on disk (see AssetUploadPump)
+s32 AssetWatch(struct asset_container_t *container, struct jobpool_t *pool, char *dir)
+{
+	assert(container);
+	assert(pool);
+	assert(dir);
+
+	if (AssetCreateLock(container) < 0)
+		return -1;
+
+	container->pool = pool;
+
+	if (WatchStart(&container->watch, dir, AssetWatchChanged, container) < 0) {
 		return -1;
 	}
 
-	// asset->name = strdup_null(strrchr(path, '/') + 1);
-	asset->name = strslice(path, strrchr(path, '/') - path + 1, strrchr(path, '.') - path);
+	LOG("watching '%s' for changes\n", dir);
 
 	return 0;
 }
 
+// AssetRegister : adds an asset to the container without loading it, groups is a bitmask
+s32 AssetRegister(struct asset_container_t *container, char *path, u32 flags, u32 groups)
+{
+	struct asset_t *asset;
+	s32 idx;
+
+	assert(container);
+	assert(path);
+
+	idx = AssetCreateSlot(container, path, flags);
+
+	asset = container->assets + idx;
+	asset->state = ASSET_UNLOADED;
+	asset->groups = groups;
+
+	return idx;
+}
+
+// assetorder_t : where an asset lives on disk, for sorting a batch of loads
+struct assetorder_t {
+	s32 idx;
+	u64 key;
+	struct pakentry_t *entry;
+	s32 stream; // read it with StreamRead, instead of in the decode
+	u64 size, stamp;
+};
+
+// AssetOrderCmp : sorts by on-disk location, then by the order they were asked for
+static int AssetOrderCmp(const void *a, const void *b)
+{
+	const struct assetorder_t *x, *y;
+
+	x = a;
+	y = b;
+
+	if (x->key != y->key)
+		return x->key < y->key ? -1 : 1;
+
+	return x->idx - y->idx;
+}
+
+// AssetLoadBatch : loads a batch of assets on the pool, in the order they are on disk
+static void AssetLoadBatch(struct asset_container_t *container, struct jobpool_t *pool, struct assetorder_t *order, s32 n)
+{
+	struct streamreq_t *reqs;
+	struct assetjob_t *job;
+	struct asset_t *asset;
+	char cachepath[BUFLARGE];
+	struct stat st;
+	s32 i, nreqs;
+
+	// things in the pak sort by offset, and come first (it's one file we've already got open), then
+	// loose files by inode, which is about as close as we can get to where they are on the disk
+	for (i = 0; i < n; i++) {
+		asset = container->assets + order[i].idx;
+
+		order[i].entry = container->pak ? PakFind(container->pak, asset->path) : NULL;
+
+		if (order[i].entry) {
+			order[i].key = order[i].entry->offset;
+		} else if (stat(asset->path, &st) == 0) {
+			order[i].key = (1ull << 63) | (u64)st.st_ino;
+			order[i].size = st.st_size;
+			order[i].stamp = AssetFileStamp(&st);
+
+			// a cached sprite never touches its png, so there's no point reading it in
+			order[i].stream = container->stream != STREAM_NONE && st.st_size > 0;
+			if (order[i].stream && container->cachedir) {
+				AssetCachePath(container, asset->path, cachepath, sizeof cachepath);
+				order[i].stream = stat(cachepath, &st) != 0;
+			}
+		} else {
+			order[i].key = ~0ull;
+		}
+	}
+
+	qsort(order, n, sizeof(*order), AssetOrderCmp);
+
+	// get the reads going now, so the workers are decoding one thing while the next is coming in
+	for (i = 0; i < n; i++) {
+		if (order[i].entry) {
+			PakPrefetch(container->pak, order[i].entry);
+		}
+	}
+
+	// the pool is first in, first out, so this is the order they get decoded in
+	reqs = C_CALLOC(MEM_ASSET, n, sizeof(*reqs));
+
+	for (i = 0, nreqs = 0; i < n; i++) {
+		if (!order[i].stream) {
+			AssetLoadSlotAsync(container, pool, order[i].idx);
+			continue;
+		}
+
+		job = AssetCreateJob(container, pool, order[i].idx);
+		job->file_stamp = order[i].stamp;
+
+		reqs[nreqs].path = job->path;
+		reqs[nreqs].size = order[i].size;
+		reqs[nreqs].arg = job;
+		nreqs++;
+	}
+
+	// and the loose pngs all get read in one go, each one decoded as soon as it's in
+	if (nreqs > 0) {
+		container->streamed = StreamRead(reqs, nreqs, pool, AssetStreamDone, container->stream);
+	}
+
+	C_FREE(reqs);
+}
+
+// AssetLoadGroup : starts loading every unloaded asset in groups, returns how many loads it started
+s32 AssetLoadGroup(struct asset_container_t *container, struct jobpool_t *pool, u32 groups)
+{
+	struct assetorder_t *order;
+	struct asset_t *asset;
+	size_t i;
+	s32 n;
+
+	assert(container);
+	assert(pool);
+
+	// these are wanted, so they don't get evicted (until somebody wants something else)
+	container->wanted = groups;
+
+	for (i = 0, n = 0; i < container->assets_len; i++) {
+		asset = container->assets + i;
+		if (asset->state == ASSET_UNLOADED && (asset->groups & groups)) {
+			n++;
+		}
+	}
+
+	if (n == 0 || AssetCreateLock(container) < 0)
+		return 0;
+
+	order = C_CALLOC(MEM_ASSET, n, sizeof(*order));
+
+	for (i = 0, n = 0; i < container->assets_len; i++) {
+		asset = container->assets + i;
+		if (asset->state == ASSET_UNLOADED && (asset->groups & groups)) {
+			order[n++].idx = asset->id;
+		}
+	}
+
+	AssetLoadBatch(container, pool, order, n);
+
+	C_FREE(order);
+
+	return n;
+}
+
+// AssetManifestFlags : parses a '|' separated list of flags
+static s32 AssetManifestFlags(char *s, u32 *flags)
+{
+	char *arr[8];
+	size_t n, i;
+
+	*flags = 0;
+
+	if (streq(s, "-"))
+		return 0;
+
+	n = strsplit(NULL, 0, s, '|') + 1;
+	if (n > ARRSIZE(arr))
+		return -1;
+
+	strsplit(arr, n, s, '|');
+
+	for (i = 0; i < n; i++) {
+		s = rtrim(ltrim(arr[i]));
+
+		if (streq(s, "mask")) {
+			*flags |= ASSET_MASK;
+		} else if (streq(s, "cpu")) {
+			*flags |= ASSET_CPU_PIXELS;
+		} else {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+// AssetManifestGroup : looks up a group by name, -1 if it isn't one
+static s32 AssetManifestGroup(char *s, char **groups, s32 groups_len)
+{
+	s32 i;
+
+	for (i = 0; i < groups_len; i++) {
+		if (groups[i] && streq(groups[i], s))
+			return i;
+	}
+
+	return -1;
+}
+
+// AssetManifestLoad : registers everything in the manifest, returns how many (-1 if we can't read it)
+s32 AssetManifestLoad(struct asset_container_t *container, char *path, char **groups, s32 groups_len, u32 flags)
+{
+	struct assetdesc_t *descs, *desc;
+	size_t descs_len, descs_cap;
+	struct asset_t *asset;
+	char *buf, *s, *line;
+	char *fields[6];
+	s32 lineno, group, i, idx;
+
+	assert(container);
+	assert(path);
+
+	buf = sys_readfile(path);
+	if (buf == NULL) {
+		ERR("Couldn't read the asset manifest '%s'\n", path);
+		return -1;
+	}
+
+	descs = NULL;
+	descs_len = descs_cap = 0;
+
+	// first, into a flat table
+	for (s = buf, lineno = 1; s; lineno++) {
+		line = rtrim(ltrim(bstrtok(&s, "\n")));
+
+		if (line[0] == '#' || line[0] == '\0')
+			continue;
+
+		if (strsplit(NULL, 0, line, ',') + 1 != ARRSIZE(fields)) {
+			ERR("%s:%d: expected 'path, group, flags, pivot x, pivot y, radius'\n", path, lineno);
+			continue;
+		}
+
+		strsplit(fields, ARRSIZE(fields), line, ',');
+
+		for (i = 0; i < ARRSIZE(fields); i++) {
+			fields[i] = rtrim(ltrim(fields[i]));
+		}
+
+		group = AssetManifestGroup(fields[1], groups, groups_len);
+		if (group < 0) {
+			ERR("%s:%d: unknown group '%s'\n", path, lineno, fields[1]);
+			continue;
+		}
+
+		desc = C_PUSH(&descs);
+
+		desc->path = fields[0];
+		desc->groups = 1u << group;
+
+		if (AssetManifestFlags(fields[2], &desc->flags) < 0) {
+			ERR("%s:%d: bad flags '%s' (mask, cpu, or -)\n", path, lineno, fields[2]);
+			descs_len--;
+			continue;
+		}
+
+		desc->pivot_x = (f32)atof(fields[3]);
+		desc->pivot_y = (f32)atof(fields[4]);
+		desc->radius = (f32)atof(fields[5]);
+	}
+
+	// then, into the container
+	C_RESERVE(&container->assets, container->assets_len + descs_len);
+
+	for (i = 0; i < descs_len; i++) {
+		desc = descs + i;
+
+		idx = AssetRegister(container, desc->path, desc->flags | flags, desc->groups);
+
+		asset = container->assets + idx;
+		asset->pivot_x = desc->pivot_x;
+		asset->pivot_y = desc->pivot_y;
+		asset->radius = desc->radius;
+	}
+
+	C_FREE(descs);
+	C_FREE(buf);
+
+	return (s32)descs_len;
+}
+
+// AssetEvict : unloads an asset, it'll get loaded again if anybody asks for it
+static void AssetEvict(struct asset_t *asset)
+{
+	if (asset->texture)
+		SDL_DestroyTexture(asset->texture);
+
+	AssetFreePixels(asset);
+
+	if (asset->mask) {
+		MaskFree(asset->mask);
+		C_FREE(asset->mask);
+	}
+
+	asset->texture = NULL;
+	asset->mask = NULL;
+	asset->colormod = 0xffffff;
+	asset->state = ASSET_UNLOADED;
+}
+
+// AssetsFrame : call once a frame (before anything fetches), uploads, evicts, and ages the assets
+void AssetsFrame(struct asset_container_t *container)
+{
+	struct asset_t *asset, *lru;
+	struct assetmem_t mem;
+	size_t i, used;
+
+	assert(container);
+
+	AssetUploadPump(container);
+
+	container->frame++;
+
+	if (container->budget == 0)
+		return;
+
+	mem = AssetsMemory(container);
+	used = mem.cpu + mem.gpu;
+
+	// evict the least recently used assets that aren't wanted, until we're under the budget
+	while (used > container->budget) {
+		for (i = 0, lru = NULL; i < container->assets_len; i++) {
+			asset = container->assets + i;
+
+			// a reload's upload would just bring it right back
+			if (asset->state != ASSET_READY || asset->reloading || (asset->groups & container->wanted))
+				continue;
+
+			if (lru == NULL || asset->last_used < lru->last_used)
+				lru = asset;
+		}
+
+		// everything left is wanted, the budget is just too small for this screen
+		if (lru == NULL)
+			break;
+
+		mem = AssetMemory(lru);
+		used -= mem.cpu + mem.gpu;
+
+		LOG("evicting '%s' (%zu bytes, last used %llu frames ago)\n", lru->name, mem.cpu + mem.gpu,
+			container->frame - lru->last_used);
+
+		AssetEvict(lru);
+	}
+}
+
 // AssetFetchByName : fetches an asset by name
 struct asset_t *AssetFetchByName(struct asset_container_t *container, char *name)
 {
@@ -79,11 +1083,109 @@ struct asset_t *AssetFetchByName(struct asset_container_t *container, char *name
 	for (i = 0, asset = NULL; i < container->assets_len; i++) {
 		asset = container->assets + i;
 		if (streq(name, asset->name)) {
-			return asset;
+			break;
+		}
+	}
+
+	if (i == container->assets_len)
+		return NULL;
+
+	// nobody asked for it ahead of time, so it's loaded right now (which is a hitch)
+	if (asset->state == ASSET_UNLOADED) {
+		LOG("'%s' wasn't loaded, loading it now\n", asset->name);
+		AssetLoadSlot(container, asset->id);
+	}
+
+	// it was asked for, it just isn't here yet
+	if (asset->state == ASSET_LOADING) {
+		LOG("waiting on '%s'\n", asset->name);
+		while (asset->state == ASSET_LOADING && AssetUploadPump(container) > 0) {
+			SDL_Delay(1);
 		}
 	}
 
-	return NULL;
+	asset->last_used = container->frame;
+
+	return asset;
+}
+
+// AssetMemory : how many bytes the asset is holding onto, on the cpu and the gpu
+struct assetmem_t AssetMemory(struct asset_t *asset)
+{
+	struct assetmem_t mem;
+	u32 format;
+	s32 w, h;
+
+	assert(asset);
+
+	memset(&mem, 0, sizeof mem);
+
+	if (asset->map) {
+		mem.cpu = asset->map_size;
+	} else if (asset->bytes) {
+		mem.cpu = (size_t)asset->w * asset->h * 4;
+	}
+
+	if (asset->mask) {
+		mem.cpu += MaskBytes(asset->mask);
+	}
+
+	// NOTE (Brian) this is what we asked for, the driver is free to pad it out (or keep a copy)
+	if (asset->texture && SDL_QueryTexture(asset->texture, &format, NULL, &w, &h) == 0) {
+		mem.gpu = (size_t)w * h * SDL_BYTESPERPIXEL(format);
+	}
+
+	return mem;
+}
+
+// AssetsMemory : AssetMemory, added up over the whole container
+struct assetmem_t AssetsMemory(struct asset_container_t *container)
+{
+	struct assetmem_t mem, total;
+	size_t i;
+
+	assert(container);
+
+	memset(&total, 0, sizeof total);
+
+	for (i = 0; i < container->assets_len; i++) {
+		mem = AssetMemory(container->assets + i);
+		total.cpu += mem.cpu;
+		total.gpu += mem.gpu;
+	}
+
+	return total;
+}
+
+// AssetsReport : prints every asset's residency to fp, returns the totals
+struct assetmem_t AssetsReport(struct asset_container_t *container, FILE *fp)
+{
+	struct asset_t *asset;
+	struct assetmem_t mem, total;
+	size_t i;
+
+	assert(container);
+	assert(fp);
+
+	memset(&total, 0, sizeof total);
+
+	fprintf(fp, "%-16s %5s %5s %10s %10s %s\n", "asset", "w", "h", "cpu bytes", "gpu bytes", "state");
+
+	for (i = 0; i < container->assets_len; i++) {
+		asset = container->assets + i;
+
+		mem = AssetMemory(asset);
+
+		fprintf(fp, "%-16s %5d %5d %10zu %10zu %s\n", asset->name, asset->w, asset->h, mem.cpu, mem.gpu,
+			asset_state[asset->state]);
+
+		total.cpu += mem.cpu;
+		total.gpu += mem.gpu;
+	}
+
+	fprintf(fp, "%-16s %5s %5s %10zu %10zu\n", "total", "", "", total.cpu, total.gpu);
+
+	return total;
 }
 
 // AssetsFree : releases all of the resources associated with the asset
@@ -92,13 +1194,40 @@ s32 AssetsFree(struct asset_container_t *container)
 	struct asset_t *asset;
 	s32 i;
 
+	// the watcher can't queue anything else up once it's stopped
+	WatchStop(&container->watch);
+
+	// anything still decoding is about to write into the container, so wait it out
+	while (AssetUploadPump(container) > 0) {
+		SDL_Delay(1);
+	}
+
 	for (i = 0; i < container->assets_len; i++) {
 		asset = container->assets + i;
-		SDL_DestroyTexture(asset->texture);
-		stbi_image_free(asset->bytes);
-		free(asset->name);
+		if (asset->texture)
+			SDL_DestroyTexture(asset->texture);
+		AssetFreePixels(asset);
+		if (asset->mask) {
+			MaskFree(asset->mask);
+			C_FREE(asset->mask);
+		}
+		C_FREE(asset->name);
+		C_FREE(asset->path);
 	}
 
+	C_FREE(container->assets);
+
+	if (container->lock)
+		SDL_DestroyMutex(container->lock);
+
+	C_FREE(container->uploads);
+
+	for (i = 0; i < container->changes_len; i++) {
+		C_FREE(container->changes[i].path);
+	}
+
+	C_FREE(container->changes);
+
 	return 0;
 }
 
@@ -2,33 +2,183 @@
 #define ASSET_H
 
 /*
+ * Asset Handling System
  *
+ * Assets can get loaded two ways. AssetLoad does everything right now, on the calling thread.
+ * AssetLoadAsync hands the png decode off to the job pool, and the decoded pixels land on an
+ * upload queue; the main thread calls AssetUploadPump (every frame, or in a loading loop) to turn
+ * them into textures, since the SDL renderer is only safe to use from the main thread.
+ *
+ * The asset's slot (and its name) exists as soon as the load is issued, so AssetFetchByName works
+ * right away; check asset->state before drawing with it.
+ *
+ * If the container has a pak (see pak.h), images get decoded straight out of the mapped archive,
+ * and anything that isn't in it gets read off of disk like always.
+ *
+ * Pixels are always RGBA8 with premultiplied alpha, and the textures get a matching blend mode.
+ * If the container has a cache directory, the decoded pixels get written there, and the next run
+ * maps them straight back in, instead of decoding the png again.
+ *
+ * Once the texture is made, the cpu copy of the pixels gets thrown away, unless the asset was
+ * loaded with ASSET_CPU_PIXELS (the software renderer and collision masks read them), or there's
+ * no renderer to make a texture with. AssetMemory / AssetsReport say what's actually resident.
+ *
+ * AssetWatch starts a thread watching a directory. When a file in it changes, the next
+ * AssetUploadPump sends the matching assets back to the job pool to be decoded again (always off of
+ * disk, never the pak), and swaps the new texture, pixels and mask in when they come back. So as
+ * long as the pump gets called once a frame, the swap always lands between frames.
+ *
+ * Assets can also be registered up front, in groups, without being loaded. AssetLoadGroup starts
+ * loading a set of groups (the screen we're on, and the one we'll probably go to next), and
+ * AssetFetchByName loads anything that nobody asked for ahead of time, right then. When the
+ * container has a budget, AssetsFrame evicts the least recently used assets that aren't in the
+ * wanted groups, until the cpu + gpu bytes fit.
+ *
+ * Usually, that's done with a manifest (assets/manifest.txt), one asset per line:
+ *
+ *   path, group, flags, pivot x, pivot y, collision radius
+ *
+ * Groups are named by the caller. A group's loads go out as one batch, sorted by where they are on
+ * disk (pak offset, then inode), with the pak pages prefetched, so the reads overlap the decodes.
+ * Loose files without a cached copy are read in one StreamRead batch (io_uring, or preads on the
+ * pool), and each one is decoded as soon as it's in.
+ *
+ * ASSET_MASK builds the collision masks on the decoding thread, while the pixels are still there,
+ * so they don't need ASSET_CPU_PIXELS.
  */
 
 #include "common.h"
 
 #include <SDL.h>
 
+#include "job.h"
+#include "pak.h"
+#include "mask.h"
+#include "watch.h"
+#include "stream.h"
+
+// asset flags
+#define ASSET_CPU_PIXELS (0x01) // keep bytes around after the texture is made
+#define ASSET_MASK       (0x02) // build a collision mask (see mask.h) from the alpha channel
+
+enum {
+	ASSET_LOADING,  // the decode is queued up, or running
+	ASSET_READY,    // pixels (and a texture, if we have a renderer) are good to go
+	ASSET_FAILED,
+	ASSET_UNLOADED, // registered (or evicted), gets loaded when it's wanted
+	ASSET_TOTAL
+};
+
 struct asset_t {
-	void *bytes;
+	void *bytes; // premultiplied RGBA8
 	SDL_Texture *texture;
 	char *name;
+	char *path;
 	s32 w, h, c;
+	s32 id; // index into the container, used for render sort keys
+	u32 colormod; // last color mod set on the texture (0xRRGGBB)
+	s32 state; // ASSET_*
+	u32 flags; // ASSET_CPU_PIXELS, etc
+	u8 *map; // when bytes point into a mapped cache blob
+	size_t map_size;
+	struct mask_t *mask; // ASSET_MASK
+	u32 groups; // bitmask, see AssetLoadGroup
+	u64 last_used; // container frame it was last fetched
+	f32 pivot_x, pivot_y; // the point (fraction of w and h) the sprite is positioned and spun by
+	f32 radius; // collision radius, 0 means it comes from the mask
+	f32 decode_ms, upload_ms; // how long the last load took, on the worker and on the main thread
+	s32 reloading; // a hot reload is decoding, the asset can't be evicted until it's uploaded
+	s32 reload_again; // the file changed again while it was, reload_at is when
+	u64 reload_at;
+};
+
+// assetdesc_t : one line of the manifest
+struct assetdesc_t {
+	char *path;
+	u32 groups;
+	u32 flags;
+	f32 pivot_x, pivot_y;
+	f32 radius;
+};
+
+struct assetjob_t;
+struct assetchange_t;
+
+struct assetmem_t {
+	size_t cpu;
+	size_t gpu;
 };
 
 struct asset_container_t {
 	struct asset_t *assets;
 	size_t assets_len, assets_cap;
+
+	// decoded on a worker, waiting on the main thread for a texture
+	SDL_mutex *lock;
+	struct assetjob_t **uploads;
+	size_t uploads_len, uploads_cap;
+
+	s32 inflight; // async loads that haven't been uploaded yet
+
+	struct jobpool_t *pool; // where async loads (and reloads) get decoded
+
+	// hot reload, the watcher thread queues up changed files for the next pump
+	struct watch_t watch;
+	struct assetchange_t *changes;
+	size_t changes_len, changes_cap;
+
+	// residency, assets outside the wanted groups get evicted (LRU) to stay under the budget
+	size_t budget; // cpu + gpu bytes, 0 means no limit
+	u32 wanted;
+	u64 frame;
+
+	struct pak_t *pak; // optional, checked before the filesystem
+
+	char *cachedir; // optional, decoded pixels get cached here
+	s32 cache_hits, cache_misses;
+
+	s32 stream;   // STREAM_*, how a batch's loose files get read (STREAM_NONE reads in the decode)
+	s32 streamed; // STREAM_*, the backend the last batch actually got
 };
 
 // function definition
 
 // AssetLoad : loads a single asset from disk
-s32 AssetLoad(struct asset_container_t *container, char *path);
+s32 AssetLoad(struct asset_container_t *container, char *path, u32 flags);
+
+// AssetLoadAsync : loads a single asset, decoding it on the job pool
+s32 AssetLoadAsync(struct asset_container_t *container, struct jobpool_t *pool, char *path, u32 flags);
+
+// AssetUploadPump : creates textures for decoded assets (main thread), returns loads still in flight
+s32 AssetUploadPump(struct asset_container_t *container);
+
+// AssetWatch : reloads assets in dir when they change on disk (see AssetUploadPump)
+s32 AssetWatch(struct asset_container_t *container, struct jobpool_t *pool, char *dir);
+
+// AssetRegister : adds an asset to the container without loading it, groups is a bitmask
+s32 AssetRegister(struct asset_container_t *container, char *path, u32 flags, u32 groups);
+
+// AssetManifestLoad : registers everything in the manifest, returns how many (-1 if we can't read it)
+s32 AssetManifestLoad(struct asset_container_t *container, char *path, char **groups, s32 groups_len, u32 flags);
+
+// AssetLoadGroup : starts loading every unloaded asset in groups, returns how many loads it started
+s32 AssetLoadGroup(struct asset_container_t *container, struct jobpool_t *pool, u32 groups);
+
+// AssetsFrame : call once a frame (before anything fetches), uploads, evicts, and ages the assets
+void AssetsFrame(struct asset_container_t *container);
 
 // AssetFetchByName : fetches an asset by name
 struct asset_t *AssetFetchByName(struct asset_container_t *container, char *name);
 
+// AssetMemory : how many bytes the asset is holding onto, on the cpu and the gpu
+struct assetmem_t AssetMemory(struct asset_t *asset);
+
+// AssetsMemory : AssetMemory, added up over the whole container
+struct assetmem_t AssetsMemory(struct asset_container_t *container);
+
+// AssetsReport : prints every asset's residency to fp, returns the totals
+struct assetmem_t AssetsReport(struct asset_container_t *container, FILE *fp);
+
 // AssetsFree : releases all of the resources associated with the asset
 s32 AssetsFree(struct asset_container_t *container);
 
@@ -36,6 +36,11 @@
 
 #include <assert.h>
 
+// NOTE (brian) the windows crt calls it _strdup, everyone else just calls it strdup
+#if !defined(_WIN32)
+#define _strdup strdup
+#endif
+
 #define SWAP(x, y, T) do { T SWAP = x; x = y; y = SWAP; } while (0)
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
@@ -43,6 +48,10 @@
 
 #define ARRSIZE(x)   (sizeof((x))/sizeof((x)[0]))
 
+// NOTE (Brian) 64 everywhere we care about (x86_64, most arm64), a guess is fine, it's just padding
+#define CACHELINE (64)
+#define CACHE_ALIGNED __attribute__((aligned(CACHELINE)))
+
 // some fun macros for variadic functions :^)
 #define PP_ARG_N( \
           _1,  _2,  _3,  _4,  _5,  _6,  _7,  _8,  _9, _10, \
@@ -81,11 +90,80 @@ typedef double             f64;
 #define BUFLARGE (4096)
 #define BUFGIANT (1 << 20 << 1)
 
-/* c_resize : resizes the ptr should length and capacity be the same */
-void c_resize(void *ptr, size_t *len, size_t *cap, size_t bytes);
-// USAGE: C_RESIZE(foo->bar);
+// NOTE (brian) every heap allocation goes through C_ALLOC and friends, with a tag for what it's
+// for. Each one carries a small header (the tag, the size, and where it came from) and sits on a
+// list, so there are live bytes, peaks and counts per tag, and whatever's still on the list at
+// exit is a leak (c_memleaks). Anything from C_ALLOC has to go back through C_FREE, never free.
+// The C_* array macros below use MEM_ARRAY, and stb_image is pointed at MEM_ASSET.
+enum {
+	  MEM_MISC
+	, MEM_ARRAY   // C_RESIZE and friends
+	, MEM_STRING
+	, MEM_ASSET
+	, MEM_ENTITY
+	, MEM_SCRATCH // arena blocks and spills
+	, MEM_RENDER
+	, MEM_IO
+	, MEM_DEBUG   // profiling, metrics, traces, golden images, benchmarks
+	, MEM_TOTAL
+};
+
+struct c_memtag_t {
+	u64 allocs, frees; // ever, a realloc counts as one of each
+	u64 bytes;         // live
+	u64 peak;          // the most that was ever live
+};
+
+// c_memtags : every tag's numbers, read them with __atomic_load_n, the allocators write them
+extern struct c_memtag_t c_memtags[MEM_TOTAL];
+
+#define C_ALLOC(tag, bytes)      (c_alloc((tag), (bytes), __FILE__, __LINE__))
+#define C_CALLOC(tag, n, size)   (c_calloc((tag), (n), (size), __FILE__, __LINE__))
+#define C_REALLOC(tag, p, bytes) (c_realloc((tag), (p), (bytes), __FILE__, __LINE__))
+#define C_FREE(p)                (c_free(p))
+
+/* c_alloc : malloc, counted against tag (use C_ALLOC) */
+void *c_alloc(s32 tag, size_t bytes, char *file, s32 line);
+/* c_calloc : calloc, counted against tag (use C_CALLOC) */
+void *c_calloc(s32 tag, size_t n, size_t size, char *file, s32 line);
+/* c_realloc : realloc, counted against tag (use C_REALLOC) */
+void *c_realloc(s32 tag, void *p, size_t bytes, char *file, s32 line);
+/* c_free : frees anything from c_alloc, c_calloc or c_realloc */
+void c_free(void *p);
+/* c_memallocs : allocations ever made, out of every tag */
+u64 c_memallocs(void);
+/* c_memtagname : returns a printable name for a MEM_* value */
+char *c_memtagname(s32 tag);
+/* c_memreport : logs every tag's numbers */
+void c_memreport(void);
+/* c_memleaks : logs up to max of the allocations that are still live, returns how many there are */
+s32 c_memleaks(s32 max);
+
+/* c_resize : makes room for one more element, and zeroes it */
+void c_resize(void *ptr, size_t *len, size_t *cap, size_t bytes, char *file, s32 line);
+/* c_reserve : makes room for at least n elements (the new ones aren't zeroed) */
+void c_reserve(void *ptr, size_t *len, size_t *cap, size_t bytes, size_t n, char *file, s32 line);
+/* c_shrink : gives back the capacity past len */
+void c_shrink(void *ptr, size_t *len, size_t *cap, size_t bytes, char *file, s32 line);
+/* c_remove_swap : removes element i, by moving the last one into its place */
+void c_remove_swap(void *arr, size_t *len, size_t bytes, size_t i);
+/* c_remove_stable : removes element i, by sliding everything after it down one */
+void c_remove_stable(void *arr, size_t *len, size_t bytes, size_t i);
+// USAGE: C_RESIZE(&foo->bar);
 //   Make sure the corresponding len and cap variables are set to 0.
-#define C_RESIZE(x) (c_resize(x,x##_len,x##_cap,sizeof(**x)))
+//   Capacity doubles, so n appends copy O(n) elements in total. Only the element at len gets
+//   zeroed (the one you're about to use), not the whole new tail.
+#define C_RESIZE(x) (c_resize(x,x##_len,x##_cap,sizeof(**x),__FILE__,__LINE__))
+// C_PUSH(&foo->bar) : appends a zeroed element, and evaluates to a pointer to it
+#define C_PUSH(x) (c_resize(x,x##_len,x##_cap,sizeof(**x),__FILE__,__LINE__), (*(x)) + (*(x##_len))++)
+// C_RESERVE(&foo->bar, n) : room for at least n elements, so n appends won't realloc
+#define C_RESERVE(x,n) (c_reserve(x,x##_len,x##_cap,sizeof(**x),(n),__FILE__,__LINE__))
+// C_SHRINK(&foo->bar) : capacity down to length
+#define C_SHRINK(x) (c_shrink(x,x##_len,x##_cap,sizeof(**x),__FILE__,__LINE__))
+// C_REMOVE_SWAP(&foo->bar, i) : O(1), but the last element ends up at i
+#define C_REMOVE_SWAP(x,i) (c_remove_swap(*(x),x##_len,sizeof(**x),(i)))
+// C_REMOVE_STABLE(&foo->bar, i) : O(n), keeps everything in order
+#define C_REMOVE_STABLE(x,i) (c_remove_stable(*(x),x##_len,sizeof(**x),(i)))
 
 // NOTE (brian) the regular expression functions were stolen from Rob Pike
 /* regex : function to help save some typing */
@@ -153,6 +231,12 @@ char *strslice(char *s, s32 n, s32 j);
 /* c_fprintf : common printf logging routine, with some extra pizzaz */
 int c_fprintf(char *file, int line, const char *func, int level, FILE *fp, char *fmt, ...);
 
+// c_logsink_t : somewhere else for c_fprintf to send messages (the async logger, see log.h)
+typedef int (*c_logsink_t)(char *file, int line, const char *func, int level, FILE *fp, char *fmt, va_list args);
+
+// c_logsink : when it's set, c_fprintf hands everything to it, instead of writing it out
+extern c_logsink_t c_logsink;
+
 enum {
 	  LOG_NON
 	, LOG_ERR
@@ -163,41 +247,308 @@ enum {
 	, LOG_TOTAL
 };
 
-// TODO (brian): see if we can use a base macro to make this cleaner/nicer
+// NOTE (brian) anything above LOG_LEVEL compiles out, arguments and all (-DLOG_LEVEL=LOG_WRN)
+#if !defined(LOG_LEVEL)
+#define LOG_LEVEL LOG_DBG
+#endif
+
+#define C_LOG(level, fmt, ...) ((level) <= LOG_LEVEL ? c_fprintf(__FILE__, __LINE__, __FUNCTION__, (level), stderr, fmt, ##__VA_ARGS__) : 0)
+
 // TODO (brian): should all of these log to stderr? Yes, if stdout is really output... (should it be?)
-#define LOG(fmt, ...) (c_fprintf(__FILE__, __LINE__, __FUNCTION__, LOG_LOG, stderr, fmt, ##__VA_ARGS__)) // basic log message
-#define MSG(fmt, ...) (c_fprintf(__FILE__, __LINE__, __FUNCTION__, LOG_MSG, stderr, fmt, ##__VA_ARGS__)) // basic log message
-#define WRN(fmt, ...) (c_fprintf(__FILE__, __LINE__, __FUNCTION__, LOG_WRN, stderr, fmt, ##__VA_ARGS__)) // warning message
-#define ERR(fmt, ...) (c_fprintf(__FILE__, __LINE__, __FUNCTION__, LOG_ERR, stderr, fmt, ##__VA_ARGS__)) // error message
-#define DBG(fmt, ...) (c_fprintf(__FILE__, __LINE__, __FUNCTION__, LOG_DBG, stderr, fmt, ##__VA_ARGS__)) // verbose message
+#define LOG(fmt, ...) C_LOG(LOG_LOG, fmt, ##__VA_ARGS__) // basic log message
+#define MSG(fmt, ...) C_LOG(LOG_MSG, fmt, ##__VA_ARGS__) // basic log message
+#define WRN(fmt, ...) C_LOG(LOG_WRN, fmt, ##__VA_ARGS__) // warning message
+#define ERR(fmt, ...) C_LOG(LOG_ERR, fmt, ##__VA_ARGS__) // error message
+#define DBG(fmt, ...) C_LOG(LOG_DBG, fmt, ##__VA_ARGS__) // verbose message
 
 #if defined(COMMON_IMPLEMENTATION)
 
-/* c_resize : resizes the ptr should length and capacity be the same */
-void c_resize(void *ptr, size_t *len, size_t *cap, size_t bytes)
+c_logsink_t c_logsink;
+
+struct c_memtag_t c_memtags[MEM_TOTAL];
+
+#define C_MEM_MAGIC (0xa110)
+
+// c_memhdr_t : sits in front of every allocation, 16 byte aligned so what's after it is too
+struct c_memhdr_t {
+	struct c_memhdr_t *prev, *next;
+	char *file;
+	size_t bytes;
+	s32 line;
+	u16 tag;
+	u16 magic;
+} __attribute__((aligned(16)));
+
+static struct c_memhdr_t c_memlive = { &c_memlive, &c_memlive }; // the list of live ones
+static int c_memlock;
+
+static void c_memlock_take(void)
 {
-	void **p;
+	while (__atomic_exchange_n(&c_memlock, 1, __ATOMIC_ACQUIRE))
+		;
+}
 
-	if (*len == *cap) {
-		p = (void **)ptr;
+static void c_memlock_give(void)
+{
+	__atomic_store_n(&c_memlock, 0, __ATOMIC_RELEASE);
+}
 
-		if (*cap) {
-			if (BUFLARGE < *cap) {
-				*cap += BUFLARGE;
-			} else {
-				*cap *= 2;
-			}
-		} else {
-			*cap = BUFSMALL;
+// c_memtrack : puts a fresh block on the live list, and counts it
+static void *c_memtrack(struct c_memhdr_t *hdr, s32 tag, size_t bytes, char *file, s32 line)
+{
+	struct c_memtag_t *t;
+
+	assert(0 <= tag && tag < MEM_TOTAL);
+
+	hdr->file = file;
+	hdr->line = line;
+	hdr->bytes = bytes;
+	hdr->tag = tag;
+	hdr->magic = C_MEM_MAGIC;
+
+	t = c_memtags + tag;
+
+	c_memlock_take();
+
+	hdr->prev = &c_memlive;
+	hdr->next = c_memlive.next;
+	c_memlive.next->prev = hdr;
+	c_memlive.next = hdr;
+
+	__atomic_store_n(&t->allocs, t->allocs + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&t->bytes, t->bytes + bytes, __ATOMIC_RELAXED);
+	__atomic_store_n(&t->peak, MAX(t->peak, t->bytes), __ATOMIC_RELAXED);
+
+	c_memlock_give();
+
+	return hdr + 1;
+}
+
+// c_memuntrack : takes a block off of the live list, and counts it
+static struct c_memhdr_t *c_memuntrack(void *p)
+{
+	struct c_memhdr_t *hdr;
+	struct c_memtag_t *t;
+
+	hdr = (struct c_memhdr_t *)p - 1;
+
+	// it didn't come from c_alloc, or it's already been freed
+	assert(hdr->magic == C_MEM_MAGIC);
+
+	t = c_memtags + hdr->tag;
+
+	c_memlock_take();
+
+	hdr->prev->next = hdr->next;
+	hdr->next->prev = hdr->prev;
+
+	__atomic_store_n(&t->frees, t->frees + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&t->bytes, t->bytes - hdr->bytes, __ATOMIC_RELAXED);
+
+	c_memlock_give();
+
+	return hdr;
+}
+
+/* c_alloc : malloc, counted against tag (use C_ALLOC) */
+void *c_alloc(s32 tag, size_t bytes, char *file, s32 line)
+{
+	struct c_memhdr_t *hdr;
+
+	hdr = malloc(sizeof(*hdr) + bytes);
+	if (hdr == NULL)
+		return NULL;
+
+	return c_memtrack(hdr, tag, bytes, file, line);
+}
+
+/* c_calloc : calloc, counted against tag (use C_CALLOC) */
+void *c_calloc(s32 tag, size_t n, size_t size, char *file, s32 line)
+{
+	struct c_memhdr_t *hdr;
+
+	if (size && n > (SIZE_MAX - sizeof(*hdr)) / size)
+		return NULL;
+
+	hdr = calloc(1, sizeof(*hdr) + n * size);
+	if (hdr == NULL)
+		return NULL;
+
+	return c_memtrack(hdr, tag, n * size, file, line);
+}
+
+/* c_realloc : realloc, counted against tag (use C_REALLOC) */
+void *c_realloc(s32 tag, void *p, size_t bytes, char *file, s32 line)
+{
+	struct c_memhdr_t *hdr, *q;
+
+	if (p == NULL)
+		return c_alloc(tag, bytes, file, line);
+
+	hdr = c_memuntrack(p);
+
+	q = realloc(hdr, sizeof(*hdr) + bytes);
+	if (q == NULL) { // the old block's still good, so it goes back on the list
+		c_memtrack(hdr, hdr->tag, hdr->bytes, hdr->file, hdr->line);
+		return NULL;
+	}
+
+	return c_memtrack(q, tag, bytes, file, line);
+}
+
+/* c_free : frees anything from c_alloc, c_calloc or c_realloc */
+void c_free(void *p)
+{
+	struct c_memhdr_t *hdr;
+
+	if (p == NULL)
+		return;
+
+	hdr = c_memuntrack(p);
+	hdr->magic = 0;
+
+	free(hdr);
+}
+
+/* c_memallocs : allocations ever made, out of every tag */
+u64 c_memallocs(void)
+{
+	u64 allocs;
+	s32 i;
+
+	for (i = 0, allocs = 0; i < MEM_TOTAL; i++) {
+		allocs += __atomic_load_n(&c_memtags[i].allocs, __ATOMIC_RELAXED);
+	}
+
+	return allocs;
+}
+
+/* c_memtagname : returns a printable name for a MEM_* value */
+char *c_memtagname(s32 tag)
+{
+	static char *names[] = {
+		"misc", "array", "string", "asset", "entity", "scratch", "render", "io", "debug"
+	};
+
+	return 0 <= tag && tag < MEM_TOTAL ? names[tag] : "unknown";
+}
+
+/* c_memreport : logs every tag's numbers */
+void c_memreport(void)
+{
+	struct c_memtag_t *t;
+	s32 i;
+
+	for (i = 0; i < MEM_TOTAL; i++) {
+		t = c_memtags + i;
+
+		if (t->allocs == 0)
+			continue;
+
+		LOG("heap %-8s %8llu allocs %8llu frees %10llu bytes live %10llu bytes peak\n",
+			c_memtagname(i), t->allocs, t->frees, t->bytes, t->peak);
+	}
+}
+
+/* c_memleaks : logs up to max of the allocations that are still live, returns how many there are */
+s32 c_memleaks(s32 max)
+{
+	struct c_memhdr_t *hdr;
+	s32 n;
+
+	c_memlock_take();
+
+	for (hdr = c_memlive.next, n = 0; hdr != &c_memlive; hdr = hdr->next, n++) {
+		if (n < max) {
+			WRN("leak: %zu bytes of %s, from %s:%d\n", hdr->bytes, c_memtagname(hdr->tag), hdr->file, hdr->line);
 		}
+	}
+
+	c_memlock_give();
+
+	return n;
+}
+
+/* c_reserve : makes room for at least n elements (the new ones aren't zeroed) */
+void c_reserve(void *ptr, size_t *len, size_t *cap, size_t bytes, size_t n, char *file, s32 line)
+{
+	void **p, *q;
+	size_t newcap;
+
+	if (n <= *cap)
+		return;
+
+	p = (void **)ptr;
+
+	// NOTE (brian) always double, adding a constant makes n appends O(n^2) copying
+	newcap = *cap ? *cap : BUFSMALL;
+	while (newcap < n)
+		newcap *= 2;
+
+	q = c_realloc(MEM_ARRAY, *p, bytes * newcap, file, line);
+	if (q == NULL) {
+		ERR("out of memory, growing an array to %zu elements\n", newcap);
+		abort();
+	}
+
+	*p = q;
+	*cap = newcap;
+}
 
-		*p = realloc(*p, bytes * *cap);
+/* c_resize : makes room for one more element, and zeroes it */
+void c_resize(void *ptr, size_t *len, size_t *cap, size_t bytes, char *file, s32 line)
+{
+	c_reserve(ptr, len, cap, bytes, *len + 1, file, line);
+
+	// only the element that's about to get used, the rest get zeroed when it's their turn
+	memset(*(u8 **)ptr + *len * bytes, 0, bytes);
+}
+
+/* c_shrink : gives back the capacity past len */
+void c_shrink(void *ptr, size_t *len, size_t *cap, size_t bytes, char *file, s32 line)
+{
+	void **p, *q;
+
+	if (*len == *cap)
+		return;
+
+	p = (void **)ptr;
+
+	if (*len == 0) {
+		c_free(*p);
+		*p = NULL;
+		*cap = 0;
+		return;
+	}
 
-		// set the rest of the elements to zero
-		memset(((u8 *)*p) + *len * bytes, 0, (*cap - *len) * bytes);
+	q = c_realloc(MEM_ARRAY, *p, bytes * *len, file, line);
+	if (q) {
+		*p = q;
+		*cap = *len;
 	}
 }
 
+/* c_remove_swap : removes element i, by moving the last one into its place */
+void c_remove_swap(void *arr, size_t *len, size_t bytes, size_t i)
+{
+	assert(i < *len);
+
+	(*len)--;
+
+	if (i != *len)
+		memcpy((u8 *)arr + i * bytes, (u8 *)arr + *len * bytes, bytes);
+}
+
+/* c_remove_stable : removes element i, by sliding everything after it down one */
+void c_remove_stable(void *arr, size_t *len, size_t bytes, size_t i)
+{
+	assert(i < *len);
+
+	(*len)--;
+
+	memmove((u8 *)arr + i * bytes, (u8 *)arr + (i + 1) * bytes, (*len - i) * bytes);
+}
+
 /* ltrim : removes whitespace on the "left" (start) of the string */
 char *ltrim(char *s)
 {
@@ -398,8 +749,11 @@ char *sys_readfile(char *path)
 	size = ftell(fp);
 	fseek(fp, 0, SEEK_SET);
 
-	buf = malloc(size + 1);
-	memset(buf, 0, size + 1);
+	buf = C_CALLOC(MEM_IO, 1, size + 1);
+	if (buf == NULL) {
+		fclose(fp);
+		return NULL;
+	}
 
 	fread(buf, 1, size, fp);
 	fclose(fp);
@@ -489,7 +843,7 @@ char *strdup(char *s)
 	if (!s)
 		return NULL;
 
-	t = (char *)calloc(1, strlen(s));
+	t = (char *)C_CALLOC(MEM_STRING, 1, strlen(s));
 	strcpy(t, s);
 
 	return t;
@@ -499,7 +853,16 @@ char *strdup(char *s)
 /* strdup_null : duplicates the string if non-null, returns NULL otherwise */
 char *strdup_null(char *s)
 {
-	return s ? _strdup(s) : NULL;
+	char *t;
+
+	if (s == NULL)
+		return NULL;
+
+	t = C_ALLOC(MEM_STRING, strlen(s) + 1);
+	if (t)
+		strcpy(t, s);
+
+	return t;
 }
 
 // strslice : returns a copy of the string starting at s + n chars, and going for at most j
@@ -509,7 +872,7 @@ char *strslice(char *s, s32 n, s32 j)
 
 	assert(s);
 
-	t = calloc(1, j - n + 1);
+	t = C_CALLOC(MEM_STRING, 1, j - n + 1);
 	strncpy(t, s + n, j - n);
 
 	return t;
@@ -519,8 +882,8 @@ char *strslice(char *s, s32 n, s32 j)
 int c_fprintf(char *file, int line, const char *func, int level, FILE *fp, char *fmt, ...)
 {
 	va_list args;
-	int rc;
-	char bigbuf[BUFLARGE];
+	int rc, n;
+	char buf[BUFLARGE];
 
 	// NOTE (Brian): I hate how the compiler thinks const is useful.
 
@@ -547,29 +910,39 @@ int c_fprintf(char *file, int line, const char *func, int level, FILE *fp, char
 		level = LOG_NON;
 	}
 
-	rc = 0;
-
 	if (strlen(fmt) == 0)
-		return rc;
-
-	memset(bigbuf, 0, sizeof(bigbuf));
+		return 0;
 
 	va_start(args, fmt); /* get the arguments from the stack */
 
+	// the async logger (log.h) copies it off, and formats it on its own thread
+	if (c_logsink) {
+		rc = c_logsink(file, line, func, level, fp, fmt, args);
+		va_end(args);
+		return rc;
+	}
+
 	if (level == LOG_DBG) {
 		// Format:
 		//   __FUNC__:__LINE__ LEVELSTR MESSAGE
-		rc += fprintf(fp, "%16s:%04d %s ", func, line, logstr[level]);
+		n = snprintf(buf, sizeof buf, "%16s:%04d %s ", func, line, logstr[level]);
 	} else {
 		// Format:
 		//   __LEVELSTR__ MESSAGE
-		rc += fprintf(fp, "%s ", logstr[level]);
+		n = snprintf(buf, sizeof buf, "%s ", logstr[level]);
 	}
 
-	rc += vfprintf(fp, fmt, args);
+	rc = vsnprintf(buf + n, sizeof buf - n, fmt, args);
 
 	va_end(args); /* cleanup stack arguments */
 
+	if (rc < 0)
+		rc = 0;
+
+	// one write, so messages from different threads don't get interleaved
+	rc = MIN(n + rc, (int)sizeof buf - 1);
+	fwrite(buf, 1, rc, fp);
+
 	return rc;
 }
 
@@ -0,0 +1,177 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-10 11:02:15
+ *
+ * Debug Drawing
+ */
+
+#include "common.h"
+
+#include "debugdraw.h"
+#include "render.h"
+
+#if defined(DEBUG_DRAW)
+
+#include <math.h>
+
+#define DD_CIRCLE_SEGMENTS (16)
+
+struct ddcircle_t {
+	f32 x, y, r;
+};
+
+struct ddqueue_t {
+	SDL_Rect *rects;
+	size_t rects_len, rects_cap;
+
+	// line segments are stored as pairs of points
+	SDL_Point *lines;
+	size_t lines_len, lines_cap;
+
+	struct ddcircle_t *circles;
+	size_t circles_len, circles_cap;
+};
+
+static struct ddqueue_t gDebugQueues[DDCOLOR_TOTAL];
+
+static s32 gDebugEnabled = 1;
+
+static struct color_t gDebugColors[DDCOLOR_TOTAL] = {
+	{ 0xff, 0x00, 0x00, 0xff }, // DDCOLOR_RED
+	{ 0x00, 0xff, 0x00, 0xff }, // DDCOLOR_GREEN
+	{ 0x00, 0x00, 0xff, 0xff }, // DDCOLOR_BLUE
+	{ 0xff, 0xff, 0x00, 0xff }, // DDCOLOR_YELLOW
+	{ 0xff, 0xff, 0xff, 0xff }, // DDCOLOR_WHITE
+};
+
+// DebugDrawToggle : flips debug drawing on and off at runtime
+void DebugDrawToggle(void)
+{
+	gDebugEnabled = !gDebugEnabled;
+}
+
+// DebugDrawIsEnabled : returns true if debug drawing is on
+s32 DebugDrawIsEnabled(void)
+{
+	return gDebugEnabled;
+}
+
+// DebugDrawRect : queues a rect outline
+void DebugDrawRect(SDL_Rect *rect, s32 color)
+{
+	struct ddqueue_t *q;
+
+	assert(0 <= color && color < DDCOLOR_TOTAL);
+
+	if (!gDebugEnabled)
+		return;
+
+	q = gDebugQueues + color;
+
+	C_RESIZE(&q->rects);
+	q->rects[q->rects_len++] = *rect;
+}
+
+// DebugDrawCircle : queues a circle outline
+void DebugDrawCircle(f32 x, f32 y, f32 r, s32 color)
+{
+	struct ddqueue_t *q;
+	struct ddcircle_t *c;
+
+	assert(0 <= color && color < DDCOLOR_TOTAL);
+
+	if (!gDebugEnabled)
+		return;
+
+	q = gDebugQueues + color;
+
+	C_RESIZE(&q->circles);
+	c = q->circles + q->circles_len++;
+
+	c->x = x;
+	c->y = y;
+	c->r = r;
+}
+
+// DebugDrawLine : queues a line segment
+void DebugDrawLine(f32 x1, f32 y1, f32 x2, f32 y2, s32 color)
+{
+	struct ddqueue_t *q;
+
+	assert(0 <= color && color < DDCOLOR_TOTAL);
+
+	if (!gDebugEnabled)
+		return;
+
+	q = gDebugQueues + color;
+
+	C_RESIZE(&q->lines);
+	q->lines[q->lines_len].x = x1;
+	q->lines[q->lines_len].y = y1;
+	q->lines_len++;
+
+	C_RESIZE(&q->lines);
+	q->lines[q->lines_len].x = x2;
+	q->lines[q->lines_len].y = y2;
+	q->lines_len++;
+}
+
+// DebugDrawFlush : draws everything that's queued up, then empties the queues
+void DebugDrawFlush(void)
+{
+	struct ddqueue_t *q;
+	SDL_Point points[DD_CIRCLE_SEGMENTS + 1];
+	s32 i, j;
+	size_t k;
+	f32 theta;
+
+	for (i = 0; i < DDCOLOR_TOTAL; i++) {
+		q = gDebugQueues + i;
+
+		if (q->rects_len == 0 && q->lines_len == 0 && q->circles_len == 0)
+			continue;
+
+		// all of the rects in a queue share a color, so they go out in one call
+		if (q->rects_len) {
+			RenderDrawRects(q->rects, q->rects_len, gDebugColors[i]);
+		}
+
+		// NOTE (Brian) RenderDrawLines only does connected strips, so the segments and the
+		// circles still cost one call a piece. That's fine for now, it's debug stuff.
+		for (k = 0; k < q->lines_len; k += 2) {
+			RenderDrawLines(q->lines + k, 2, gDebugColors[i]);
+		}
+
+		for (k = 0; k < q->circles_len; k++) {
+			for (j = 0; j <= DD_CIRCLE_SEGMENTS; j++) {
+				theta = (f32)j / DD_CIRCLE_SEGMENTS * 2 * M_PI;
+				points[j].x = q->circles[k].x + cos(theta) * q->circles[k].r;
+				points[j].y = q->circles[k].y + sin(theta) * q->circles[k].r;
+			}
+
+			RenderDrawLines(points, ARRSIZE(points), gDebugColors[i]);
+		}
+
+		q->rects_len = q->lines_len = q->circles_len = 0;
+	}
+}
+
+// DebugDrawFree : releases the queues
+void DebugDrawFree(void)
+{
+	struct ddqueue_t *q;
+	s32 i;
+
+	for (i = 0; i < DDCOLOR_TOTAL; i++) {
+		q = gDebugQueues + i;
+
+		C_FREE(q->rects);
+		C_FREE(q->lines);
+		C_FREE(q->circles);
+
+		memset(q, 0, sizeof(*q));
+	}
+}
+
+#endif // DEBUG_DRAW
+
@@ -0,0 +1,81 @@
+#ifndef DEBUGDRAW_H
+#define DEBUGDRAW_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-10 11:02:15
+ *
+ * Debug Drawing
+ *
+ * Collision bounds, radii, and velocity vectors get collected into per-color arrays while the
+ * frame is being built, and then get flushed in one go after everything else is drawn. That's one
+ * SDL_RenderDrawRects per color, instead of a color change + draw call per entity.
+ *
+ * Everything here is behind DEBUG_DRAW. Without it, the DD_* macros expand to nothing, and none of
+ * the arguments are even evaluated, so release builds don't pay anything for it.
+ *
+ * USAGE
+ *   DD_RECT(&rect, DDCOLOR_RED);
+ *   DD_CIRCLE(x, y, radius, DDCOLOR_RED);
+ *   DD_LINE(x1, y1, x2, y2, DDCOLOR_YELLOW);
+ *   DD_FLUSH();
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+enum {
+	DDCOLOR_RED,
+	DDCOLOR_GREEN,
+	DDCOLOR_BLUE,
+	DDCOLOR_YELLOW,
+	DDCOLOR_WHITE,
+	DDCOLOR_TOTAL
+};
+
+#if defined(DEBUG_DRAW)
+
+// DebugDrawToggle : flips debug drawing on and off at runtime
+void DebugDrawToggle(void);
+
+// DebugDrawIsEnabled : returns true if debug drawing is on
+s32 DebugDrawIsEnabled(void);
+
+// DebugDrawRect : queues a rect outline
+void DebugDrawRect(SDL_Rect *rect, s32 color);
+
+// DebugDrawCircle : queues a circle outline
+void DebugDrawCircle(f32 x, f32 y, f32 r, s32 color);
+
+// DebugDrawLine : queues a line segment
+void DebugDrawLine(f32 x1, f32 y1, f32 x2, f32 y2, s32 color);
+
+// DebugDrawFlush : draws everything that's queued up, then empties the queues
+void DebugDrawFlush(void);
+
+// DebugDrawFree : releases the queues
+void DebugDrawFree(void);
+
+#define DD_TOGGLE()                   (DebugDrawToggle())
+#define DD_ENABLED()                  (DebugDrawIsEnabled())
+#define DD_RECT(rect, color)          (DebugDrawRect((rect), (color)))
+#define DD_CIRCLE(x, y, r, color)     (DebugDrawCircle((x), (y), (r), (color)))
+#define DD_LINE(x1, y1, x2, y2, color) (DebugDrawLine((x1), (y1), (x2), (y2), (color)))
+#define DD_FLUSH()                    (DebugDrawFlush())
+#define DD_FREE()                     (DebugDrawFree())
+
+#else
+
+#define DD_TOGGLE()
+#define DD_ENABLED()                  (0)
+#define DD_RECT(rect, color)
+#define DD_CIRCLE(x, y, r, color)
+#define DD_LINE(x1, y1, x2, y2, color)
+#define DD_FLUSH()
+#define DD_FREE()
+
+#endif // DEBUG_DRAW
+
+#endif // DEBUGDRAW_H
+
@@ -0,0 +1,262 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-13 22:47:51
+ *
+ * Golden Image Checks
+ */
+
+#include "common.h"
+
+#include "golden.h"
+
+static char *golden_status[GOLDEN_TOTAL] = {
+	"PASS",    // GOLDEN_PASS
+	"FAIL",    // GOLDEN_FAIL
+	"MISSING", // GOLDEN_MISSING
+	"WRITTEN", // GOLDEN_WRITTEN
+};
+
+// GoldenReadPPM : reads a binary ppm, returns the rgb bytes (w * h * 3) or NULL
+static u8 *GoldenReadPPM(char *path, s32 *w, s32 *h)
+{
+	FILE *fp;
+	u8 *rgb;
+	s32 maxval;
+	size_t n;
+
+	fp = fopen(path, "rb");
+	if (fp == NULL)
+		return NULL;
+
+	if (fscanf(fp, "P6 %d %d %d", w, h, &maxval) != 3 || maxval != 255) {
+		ERR("'%s' isn't a ppm we can read\n", path);
+		fclose(fp);
+		return NULL;
+	}
+
+	fgetc(fp); // the single whitespace after maxval
+
+	n = (size_t)*w * *h * 3;
+
+	rgb = C_ALLOC(MEM_DEBUG, n);
+	if (fread(rgb, 1, n, fp) != n) {
+		ERR("'%s' is truncated\n", path);
+		C_FREE(rgb);
+		rgb = NULL;
+	}
+
+	fclose(fp);
+
+	return rgb;
+}
+
+// GoldenWriteDiff : writes the diff image, bad pixels in red over a dimmed reference
+static void GoldenWriteDiff(char *path, u8 *ref, u8 *bad, s32 w, s32 h)
+{
+	FILE *fp;
+	u8 rgb[3];
+	s32 i;
+
+	fp = fopen(path, "wb");
+	if (fp == NULL) {
+		ERR("Couldn't open '%s' for writing\n", path);
+		return;
+	}
+
+	fprintf(fp, "P6\n%d %d\n255\n", w, h);
+
+	for (i = 0; i < w * h; i++) {
+		if (bad[i]) {
+			rgb[0] = 0xff;
+			rgb[1] = rgb[2] = 0;
+		} else {
+			rgb[0] = ref[i * 3 + 0] / 4;
+			rgb[1] = ref[i * 3 + 1] / 4;
+			rgb[2] = ref[i * 3 + 2] / 4;
+		}
+
+		fwrite(rgb, 1, sizeof rgb, fp);
+	}
+
+	fclose(fp);
+}
+
+// GoldenCompare : compares the framebuffer against the reference
+static void GoldenCompare(struct golden_t *golden, struct goldenframe_t *frame, char *refpath, char *diffpath, struct swrender_t *sw)
+{
+	u8 *ref, *px, *bad;
+	s32 w, h, i, c, diff;
+
+	ref = GoldenReadPPM(refpath, &w, &h);
+	if (ref == NULL) {
+		frame->status = GOLDEN_MISSING;
+		return;
+	}
+
+	if (w != sw->w || h != sw->h) {
+		ERR("'%s' is %dx%d, the framebuffer is %dx%d\n", refpath, w, h, sw->w, sw->h);
+		frame->status = GOLDEN_FAIL;
+		frame->bad_pixels = (s64)sw->w * sw->h;
+		C_FREE(ref);
+		return;
+	}
+
+	bad = C_CALLOC(MEM_DEBUG, w * h, 1);
+
+	px = (u8 *)sw->pixels;
+
+	for (i = 0; i < w * h; i++) {
+		for (c = 0; c < 3; c++) {
+			diff = abs((s32)px[i * 4 + c] - (s32)ref[i * 3 + c]);
+
+			frame->max_diff = MAX(frame->max_diff, diff);
+
+			if (diff > golden->tolerance) {
+				bad[i] = 1;
+			}
+		}
+
+		frame->bad_pixels += bad[i];
+	}
+
+	if (frame->bad_pixels) {
+		frame->status = GOLDEN_FAIL;
+		GoldenWriteDiff(diffpath, ref, bad, w, h);
+	} else {
+		frame->status = GOLDEN_PASS;
+	}
+
+	C_FREE(bad);
+	C_FREE(ref);
+}
+
+// GoldenInit : sets up the harness, ticks is a comma separated list ("10,45,130")
+s32 GoldenInit(struct golden_t *golden, char *dir, char *ticks, s32 tolerance, s32 update)
+{
+	struct goldenframe_t *frame;
+	char **arr;
+	char *buf;
+	size_t i, n;
+
+	assert(golden);
+	assert(dir);
+	assert(ticks);
+
+	memset(golden, 0, sizeof(*golden));
+
+	golden->dir = dir;
+	golden->tolerance = tolerance;
+	golden->update = update;
+
+	buf = strdup_null(ticks);
+
+	n = strsplit(NULL, 0, buf, ',') + 1;
+	arr = C_CALLOC(MEM_DEBUG, n, sizeof(*arr));
+	strsplit(arr, n, buf, ',');
+
+	for (i = 0; i < n; i++) {
+		if (arr[i] == NULL || arr[i][0] == '\0')
+			continue;
+
+		C_RESIZE(&golden->frames);
+
+		frame = golden->frames + golden->frames_len++;
+		frame->tick = c_atoi(arr[i]);
+	}
+
+	C_FREE(arr);
+	C_FREE(buf);
+
+	if (golden->frames_len == 0) {
+		ERR("No golden ticks in '%s'\n", ticks);
+		return -1;
+	}
+
+	return 0;
+}
+
+// GoldenLastTick : returns the largest tick the harness cares about
+u32 GoldenLastTick(struct golden_t *golden)
+{
+	size_t i;
+	u32 tick;
+
+	for (i = 0, tick = 0; i < golden->frames_len; i++) {
+		tick = MAX(tick, golden->frames[i].tick);
+	}
+
+	return tick;
+}
+
+// GoldenCheck : if tick is one we want, checks (or writes) the framebuffer
+void GoldenCheck(struct golden_t *golden, u32 tick, char *screen, struct swrender_t *sw)
+{
+	struct goldenframe_t *frame;
+	char refpath[BUFLARGE], diffpath[BUFLARGE];
+	size_t i;
+
+	assert(golden);
+	assert(sw);
+
+	for (i = 0; i < golden->frames_len; i++) {
+		frame = golden->frames + i;
+
+		if (frame->tick != tick)
+			continue;
+
+		frame->screen = screen;
+		frame->render_ms = sw->execute_ms;
+
+		snprintf(refpath, sizeof refpath, "%s/%s_%u.ppm", golden->dir, screen, tick);
+		snprintf(diffpath, sizeof diffpath, "%s/%s_%u_diff.ppm", golden->dir, screen, tick);
+
+		if (golden->update) {
+			frame->status = SWRenderDump(sw, refpath) < 0 ? GOLDEN_FAIL : GOLDEN_WRITTEN;
+		} else {
+			GoldenCompare(golden, frame, refpath, diffpath, sw);
+		}
+	}
+}
+
+// GoldenReport : prints out the results, returns the number of frames that didn't pass
+s32 GoldenReport(struct golden_t *golden)
+{
+	struct goldenframe_t *frame;
+	s32 failures;
+	size_t i;
+
+	assert(golden);
+
+	fprintf(stderr, "%-8s %-10s %-8s %10s %8s %10s\n", "tick", "screen", "status", "bad px", "max diff", "render ms");
+
+	for (i = 0, failures = 0; i < golden->frames_len; i++) {
+		frame = golden->frames + i;
+
+		// a tick we never got to counts as missing
+		if (frame->screen == NULL) {
+			frame->screen = "?";
+			frame->status = GOLDEN_MISSING;
+		}
+
+		fprintf(stderr, "%-8u %-10s %-8s %10lld %8d %10.3f\n",
+			frame->tick, frame->screen, golden_status[frame->status],
+			(long long)frame->bad_pixels, frame->max_diff, frame->render_ms);
+
+		if (frame->status == GOLDEN_FAIL || frame->status == GOLDEN_MISSING) {
+			failures++;
+		}
+	}
+
+	return failures;
+}
+
+// GoldenFree : releases the harness
+void GoldenFree(struct golden_t *golden)
+{
+	assert(golden);
+
+	C_FREE(golden->frames);
+
+	memset(golden, 0, sizeof(*golden));
+}
+
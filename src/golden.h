@@ -0,0 +1,71 @@
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-13 22:47:51
+ *
+ * Golden Image Checks
+ *
+ * With a fixed seed, a replayed input stream, and the software renderer, every frame comes out
+ * the same every time. So, we can grab a handful of them, compare them against reference images
+ * we've saved, and find out right away when some rendering change (batching, atlasing, whatever)
+ * breaks the picture.
+ *
+ * For each tick we care about, the framebuffer gets compared to DIR/SCREEN_TICK.ppm. A pixel is
+ * "different" if any channel is off by more than the tolerance. When a frame doesn't match, a diff
+ * image gets written next to it (DIR/SCREEN_TICK_diff.ppm), with the bad pixels in red on top of a
+ * dimmed copy of the reference.
+ *
+ * Running in update mode writes the references instead of checking them.
+ *
+ * NOTE (Brian) the references depend on the C library's rand(), so they're per-platform.
+ */
+
+#include "common.h"
+
+#include "swrender.h"
+
+enum {
+	GOLDEN_PASS,
+	GOLDEN_FAIL,
+	GOLDEN_MISSING,
+	GOLDEN_WRITTEN,
+	GOLDEN_TOTAL
+};
+
+struct goldenframe_t {
+	u32 tick;
+	char *screen;
+	s32 status;      // GOLDEN_*
+	s64 bad_pixels;  // pixels outside the tolerance
+	s32 max_diff;    // largest channel difference
+	f64 render_ms;   // software render time for the frame
+};
+
+struct golden_t {
+	char *dir;
+	s32 update;    // write the references, instead of checking them
+	s32 tolerance; // per channel, per pixel
+
+	struct goldenframe_t *frames;
+	size_t frames_len, frames_cap;
+};
+
+// GoldenInit : sets up the harness, ticks is a comma separated list ("10,45,130")
+s32 GoldenInit(struct golden_t *golden, char *dir, char *ticks, s32 tolerance, s32 update);
+
+// GoldenLastTick : returns the largest tick the harness cares about
+u32 GoldenLastTick(struct golden_t *golden);
+
+// GoldenCheck : if tick is one we want, checks (or writes) the framebuffer
+void GoldenCheck(struct golden_t *golden, u32 tick, char *screen, struct swrender_t *sw);
+
+// GoldenReport : prints out the results, returns the number of frames that didn't pass
+s32 GoldenReport(struct golden_t *golden);
+
+// GoldenFree : releases the harness
+void GoldenFree(struct golden_t *golden);
+
+#endif // GOLDEN_H
+
@@ -0,0 +1,282 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-31 11:40:52
+ *
+ * Performance HUD
+ */
+
+#include "common.h"
+
+#include <stdarg.h>
+
+#include "hud.h"
+#include "render.h"
+
+#define HUD_X       (4)
+#define HUD_Y       (4)
+#define HUD_LINE    (10) // the glyphs are 8 tall
+#define HUD_ADVANCE (6)  // and 5 wide
+
+// 5x8 glyphs for ' ' through '~', a byte a column, the top row in the low bit
+static const u8 gHudFont[95][5] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+	{ 0x00, 0x00, 0x5F, 0x00, 0x00 }, // '!'
+	{ 0x00, 0x07, 0x00, 0x07, 0x00 }, // '"'
+	{ 0x14, 0x7F, 0x14, 0x7F, 0x14 }, // '#'
+	{ 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, // '$'
+	{ 0x23, 0x13, 0x08, 0x64, 0x62 }, // '%'
+	{ 0x36, 0x49, 0x56, 0x20, 0x50 }, // '&'
+	{ 0x00, 0x08, 0x07, 0x03, 0x00 }, // '\''
+	{ 0x00, 0x1C, 0x22, 0x41, 0x00 }, // '('
+	{ 0x00, 0x41, 0x22, 0x1C, 0x00 }, // ')'
+	{ 0x2A, 0x1C, 0x7F, 0x1C, 0x2A }, // '*'
+	{ 0x08, 0x08, 0x3E, 0x08, 0x08 }, // '+'
+	{ 0x00, 0x80, 0x70, 0x30, 0x00 }, // ','
+	{ 0x08, 0x08, 0x08, 0x08, 0x08 }, // '-'
+	{ 0x00, 0x00, 0x60, 0x60, 0x00 }, // '.'
+	{ 0x20, 0x10, 0x08, 0x04, 0x02 }, // '/'
+	{ 0x3E, 0x51, 0x49, 0x45, 0x3E }, // '0'
+	{ 0x00, 0x42, 0x7F, 0x40, 0x00 }, // '1'
+	{ 0x72, 0x49, 0x49, 0x49, 0x46 }, // '2'
+	{ 0x21, 0x41, 0x49, 0x4D, 0x33 }, // '3'
+	{ 0x18, 0x14, 0x12, 0x7F, 0x10 }, // '4'
+	{ 0x27, 0x45, 0x45, 0x45, 0x39 }, // '5'
+	{ 0x3C, 0x4A, 0x49, 0x49, 0x31 }, // '6'
+	{ 0x41, 0x21, 0x11, 0x09, 0x07 }, // '7'
+	{ 0x36, 0x49, 0x49, 0x49, 0x36 }, // '8'
+	{ 0x46, 0x49, 0x49, 0x29, 0x1E }, // '9'
+	{ 0x00, 0x00, 0x14, 0x00, 0x00 }, // ':'
+	{ 0x00, 0x40, 0x34, 0x00, 0x00 }, // ';'
+	{ 0x00, 0x08, 0x14, 0x22, 0x41 }, // '<'
+	{ 0x14, 0x14, 0x14, 0x14, 0x14 }, // '='
+	{ 0x00, 0x41, 0x22, 0x14, 0x08 }, // '>'
+	{ 0x02, 0x01, 0x59, 0x09, 0x06 }, // '?'
+	{ 0x3E, 0x41, 0x5D, 0x59, 0x4E }, // '@'
+	{ 0x7C, 0x12, 0x11, 0x12, 0x7C }, // 'A'
+	{ 0x7F, 0x49, 0x49, 0x49, 0x36 }, // 'B'
+	{ 0x3E, 0x41, 0x41, 0x41, 0x22 }, // 'C'
+	{ 0x7F, 0x41, 0x41, 0x41, 0x3E }, // 'D'
+	{ 0x7F, 0x49, 0x49, 0x49, 0x41 }, // 'E'
+	{ 0x7F, 0x09, 0x09, 0x09, 0x01 }, // 'F'
+	{ 0x3E, 0x41, 0x41, 0x51, 0x73 }, // 'G'
+	{ 0x7F, 0x08, 0x08, 0x08, 0x7F }, // 'H'
+	{ 0x00, 0x41, 0x7F, 0x41, 0x00 }, // 'I'
+	{ 0x20, 0x40, 0x41, 0x3F, 0x01 }, // 'J'
+	{ 0x7F, 0x08, 0x14, 0x22, 0x41 }, // 'K'
+	{ 0x7F, 0x40, 0x40, 0x40, 0x40 }, // 'L'
+	{ 0x7F, 0x02, 0x1C, 0x02, 0x7F }, // 'M'
+	{ 0x7F, 0x04, 0x08, 0x10, 0x7F }, // 'N'
+	{ 0x3E, 0x41, 0x41, 0x41, 0x3E }, // 'O'
+	{ 0x7F, 0x09, 0x09, 0x09, 0x06 }, // 'P'
+	{ 0x3E, 0x41, 0x51, 0x21, 0x5E }, // 'Q'
+	{ 0x7F, 0x09, 0x19, 0x29, 0x46 }, // 'R'
+	{ 0x26, 0x49, 0x49, 0x49, 0x32 }, // 'S'
+	{ 0x03, 0x01, 0x7F, 0x01, 0x03 }, // 'T'
+	{ 0x3F, 0x40, 0x40, 0x40, 0x3F }, // 'U'
+	{ 0x1F, 0x20, 0x40, 0x20, 0x1F }, // 'V'
+	{ 0x3F, 0x40, 0x38, 0x40, 0x3F }, // 'W'
+	{ 0x63, 0x14, 0x08, 0x14, 0x63 }, // 'X'
+	{ 0x03, 0x04, 0x78, 0x04, 0x03 }, // 'Y'
+	{ 0x61, 0x59, 0x49, 0x4D, 0x43 }, // 'Z'
+	{ 0x00, 0x7F, 0x41, 0x41, 0x41 }, // '['
+	{ 0x02, 0x04, 0x08, 0x10, 0x20 }, // '\\'
+	{ 0x00, 0x41, 0x41, 0x41, 0x7F }, // ']'
+	{ 0x04, 0x02, 0x01, 0x02, 0x04 }, // '^'
+	{ 0x40, 0x40, 0x40, 0x40, 0x40 }, // '_'
+	{ 0x00, 0x03, 0x07, 0x08, 0x00 }, // '`'
+	{ 0x20, 0x54, 0x54, 0x78, 0x40 }, // 'a'
+	{ 0x7F, 0x28, 0x44, 0x44, 0x38 }, // 'b'
+	{ 0x38, 0x44, 0x44, 0x44, 0x28 }, // 'c'
+	{ 0x38, 0x44, 0x44, 0x28, 0x7F }, // 'd'
+	{ 0x38, 0x54, 0x54, 0x54, 0x18 }, // 'e'
+	{ 0x00, 0x08, 0x7E, 0x09, 0x02 }, // 'f'
+	{ 0x18, 0xA4, 0xA4, 0x9C, 0x78 }, // 'g'
+	{ 0x7F, 0x08, 0x04, 0x04, 0x78 }, // 'h'
+	{ 0x00, 0x44, 0x7D, 0x40, 0x00 }, // 'i'
+	{ 0x20, 0x40, 0x40, 0x3D, 0x00 }, // 'j'
+	{ 0x7F, 0x10, 0x28, 0x44, 0x00 }, // 'k'
+	{ 0x00, 0x41, 0x7F, 0x40, 0x00 }, // 'l'
+	{ 0x7C, 0x04, 0x78, 0x04, 0x78 }, // 'm'
+	{ 0x7C, 0x08, 0x04, 0x04, 0x78 }, // 'n'
+	{ 0x38, 0x44, 0x44, 0x44, 0x38 }, // 'o'
+	{ 0xFC, 0x18, 0x24, 0x24, 0x18 }, // 'p'
+	{ 0x18, 0x24, 0x24, 0x18, 0xFC }, // 'q'
+	{ 0x7C, 0x08, 0x04, 0x04, 0x08 }, // 'r'
+	{ 0x48, 0x54, 0x54, 0x54, 0x24 }, // 's'
+	{ 0x04, 0x04, 0x3F, 0x44, 0x24 }, // 't'
+	{ 0x3C, 0x40, 0x40, 0x20, 0x7C }, // 'u'
+	{ 0x1C, 0x20, 0x40, 0x20, 0x1C }, // 'v'
+	{ 0x3C, 0x40, 0x30, 0x40, 0x3C }, // 'w'
+	{ 0x44, 0x28, 0x10, 0x28, 0x44 }, // 'x'
+	{ 0x4C, 0x90, 0x90, 0x90, 0x7C }, // 'y'
+	{ 0x44, 0x64, 0x54, 0x4C, 0x44 }, // 'z'
+	{ 0x00, 0x08, 0x36, 0x41, 0x00 }, // '{'
+	{ 0x00, 0x00, 0x77, 0x00, 0x00 }, // '|'
+	{ 0x00, 0x41, 0x36, 0x08, 0x00 }, // '}'
+	{ 0x02, 0x01, 0x02, 0x04, 0x02 }, // '~'
+};
+
+static struct color_t gHudColors[HUDCOLOR_TOTAL] = {
+	{ 0xff, 0xff, 0xff, 0xff }, // HUDCOLOR_TEXT
+	{ 0x00, 0xff, 0x00, 0xff }, // HUDCOLOR_FAST
+	{ 0xff, 0x00, 0x00, 0xff }, // HUDCOLOR_SLOW
+	{ 0xff, 0xff, 0x00, 0xff }, // HUDCOLOR_BUDGET
+};
+
+// HudRect : queues a rect, in the color's batch
+static void HudRect(struct hud_t *hud, s32 color, s32 x, s32 y, s32 w, s32 h)
+{
+	struct hudbatch_t *batch;
+	SDL_Rect *rect;
+
+	batch = hud->batches + color;
+
+	C_RESIZE(&batch->rects);
+	rect = batch->rects + batch->rects_len++;
+
+	rect->x = x;
+	rect->y = y;
+	rect->w = w;
+	rect->h = h;
+}
+
+// HudGlyph : queues a glyph's pixels, a rect for every run of them in a row
+static void HudGlyph(struct hud_t *hud, s32 color, s32 x, s32 y, char c)
+{
+	const u8 *glyph;
+	s32 row, col, start;
+
+	if (c < ' ' || '~' < c)
+		c = '?';
+
+	glyph = gHudFont[c - ' '];
+
+	for (row = 0; row < 8; row++) {
+		for (col = 0; col < 5;) {
+			if (!(glyph[col] & (1 << row))) {
+				col++;
+				continue;
+			}
+
+			for (start = col; col < 5 && (glyph[col] & (1 << row)); col++)
+				;
+
+			HudRect(hud, color, x + start, y + row, col - start, 1);
+		}
+	}
+}
+
+// HudText : queues a printf style line of text, returns the next line's y
+static s32 HudText(struct hud_t *hud, s32 x, s32 y, char *fmt, ...)
+{
+	char buf[BUFSMALL];
+	va_list args;
+	char *s;
+
+	va_start(args, fmt);
+	vsnprintf(buf, sizeof buf, fmt, args);
+	va_end(args);
+
+	for (s = buf; *s; s++, x += HUD_ADVANCE) {
+		if (*s != ' ')
+			HudGlyph(hud, HUDCOLOR_TEXT, x, y, *s);
+	}
+
+	return y + HUD_LINE;
+}
+
+// HudGraph : queues the frame time graph, oldest frame on the left
+static void HudGraph(struct hud_t *hud, s32 x, s32 y)
+{
+	s32 i, n, h;
+	f32 ms;
+
+	n = MIN(hud->frames, HUD_HISTORY);
+
+	for (i = 0; i < n; i++) {
+		ms = hud->frame_ms[(hud->frames - n + i) % HUD_HISTORY];
+
+		h = (s32)(ms / HUD_GRAPH_MS * HUD_GRAPH_H);
+		h = MAX(1, MIN(h, HUD_GRAPH_H));
+
+		HudRect(hud, ms > HUD_BUDGET_MS ? HUDCOLOR_SLOW : HUDCOLOR_FAST,
+			x + HUD_HISTORY - n + i, y + HUD_GRAPH_H - h, 1, h);
+	}
+
+	h = (s32)(HUD_BUDGET_MS / HUD_GRAPH_MS * HUD_GRAPH_H);
+	HudRect(hud, HUDCOLOR_BUDGET, x, y + HUD_GRAPH_H - h, HUD_HISTORY, 1);
+}
+
+// HudToggle : turns the overlay on and off
+void HudToggle(struct hud_t *hud)
+{
+	assert(hud);
+
+	hud->enabled = !hud->enabled;
+}
+
+// HudFrame : pushes a finished frame's numbers
+void HudFrame(struct hud_t *hud, struct hudstats_t *stats)
+{
+	assert(hud);
+	assert(stats);
+
+	hud->frame_ms[hud->frames++ % HUD_HISTORY] = stats->frame_ns / 1e6;
+
+	// the very first frame's totals are everything that happened before it, so that's what it shows
+	hud->pairs = stats->pairs - hud->last.pairs;
+	hud->allocs = stats->allocs - hud->last.allocs;
+	hud->heap = stats->heap - hud->last.heap;
+
+	hud->last = *stats;
+}
+
+// HudDraw : draws the overlay, right now
+void HudDraw(struct hud_t *hud)
+{
+	struct hudstats_t *last;
+	u64 start;
+	s32 i, y;
+
+	assert(hud);
+
+	start = SDL_GetPerformanceCounter();
+
+	last = &hud->last;
+
+	y = HUD_Y;
+	y = HudText(hud, HUD_X, y, "FRAME %6.2f MS  UPDATE %6.2f  RENDER %6.2f  HUD %5.3f",
+		last->frame_ns / 1e6, last->update_ns / 1e6, last->render_ns / 1e6, hud->draw_ms);
+	y = HudText(hud, HUD_X, y, "ASTEROIDS %d  BULLETS %d/%d",
+		last->asteroids, last->bullets, last->bullets_pool);
+	y = HudText(hud, HUD_X, y, "DRAWS %d  PAIRS TESTED %llu  ARENA ALLOCS %llu  HEAP ALLOCS %llu",
+		last->draws, (unsigned long long)hud->pairs, (unsigned long long)hud->allocs,
+		(unsigned long long)hud->heap);
+
+	HudGraph(hud, HUD_X, y + 2);
+
+	// one call a color, for everything
+	for (i = 0; i < HUDCOLOR_TOTAL; i++) {
+		if (hud->batches[i].rects_len) {
+			RenderDrawRects(hud->batches[i].rects, hud->batches[i].rects_len, gHudColors[i]);
+		}
+
+		hud->batches[i].rects_len = 0;
+	}
+
+	hud->draw_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// HudFree : releases the batches
+void HudFree(struct hud_t *hud)
+{
+	s32 i;
+
+	assert(hud);
+
+	for (i = 0; i < HUDCOLOR_TOTAL; i++) {
+		C_FREE(hud->batches[i].rects);
+	}
+
+	memset(hud, 0, sizeof(*hud));
+}
@@ -0,0 +1,91 @@
+#ifndef HUD_H
+#define HUD_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-31 11:40:52
+ *
+ * Performance HUD
+ *
+ * An overlay (F3, or -hud) with a graph of the last HUD_HISTORY frame times, the update / render
+ * split, the entity counts, and what the last frame did: draw calls, collision pairs tested, and
+ * arena and heap allocations.
+ *
+ * Every frame gets pushed with HudFrame, whether the overlay is up or not, so the graph is already
+ * full when it's turned on. HudDraw goes after everything else, like the debug drawing.
+ *
+ * The text is a 5x8 bitmap font baked into hud.c (the classic 5x7 lcd font, with a row for
+ * descenders), not the ttf in assets/fonts, there's no ttf rasterizer in here. Glyphs turn into
+ * one pixel tall rects, one per horizontal run, and the graph is one pixel wide rects, so the whole
+ * overlay goes out as one RenderDrawRects per color, through whichever backend is active.
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+// frames in the graph
+#define HUD_HISTORY  (240)
+
+// the graph's height, and the frame time that fills it
+#define HUD_GRAPH_H  (48)
+#define HUD_GRAPH_MS (1000.0f / 30)
+
+// over this, a frame's bar turns red
+#define HUD_BUDGET_MS (1000.0f / 60)
+
+enum {
+	HUDCOLOR_TEXT,
+	HUDCOLOR_FAST,
+	HUDCOLOR_SLOW,
+	HUDCOLOR_BUDGET,
+	HUDCOLOR_TOTAL
+};
+
+// hudstats_t : one frame, as HudFrame gets it
+struct hudstats_t {
+	u64 frame_ns, update_ns, render_ns;
+
+	s32 asteroids;
+	s32 bullets, bullets_pool;
+	s32 draws;
+
+	// running totals, the hud shows what each frame added
+	u64 pairs;  // tested (before the circle check)
+	u64 allocs; // out of the arenas
+	u64 heap;   // C_ALLOC and friends
+};
+
+struct hudbatch_t {
+	SDL_Rect *rects;
+	size_t rects_len, rects_cap;
+};
+
+struct hud_t {
+	s32 enabled;
+
+	f32 frame_ms[HUD_HISTORY]; // the newest is at (frames - 1) % HUD_HISTORY
+	u32 frames;
+
+	struct hudstats_t last; // the newest frame
+	u64 pairs, allocs, heap; // what the newest frame added to the running totals
+
+	f64 draw_ms; // what the overlay itself cost, the last time it was drawn
+
+	// kept around between frames, so drawing doesn't allocate once they've grown
+	struct hudbatch_t batches[HUDCOLOR_TOTAL];
+};
+
+// HudToggle : turns the overlay on and off
+void HudToggle(struct hud_t *hud);
+
+// HudFrame : pushes a finished frame's numbers
+void HudFrame(struct hud_t *hud, struct hudstats_t *stats);
+
+// HudDraw : draws the overlay, right now
+void HudDraw(struct hud_t *hud);
+
+// HudFree : releases the batches
+void HudFree(struct hud_t *hud);
+
+#endif // HUD_H
@@ -72,6 +72,12 @@ static struct intmap_t sdlkey_to_inputkey[] = {
 	{ SDLK_END,    INPUT_KEY_END },
 	{ SDLK_LCTRL,  INPUT_KEY_CTRL },
 
+	// function keys
+	{ SDLK_F1, INPUT_KEY_F1 },
+	{ SDLK_F2, INPUT_KEY_F2 },
+	{ SDLK_F3, INPUT_KEY_F3 },
+	{ SDLK_F4, INPUT_KEY_F4 },
+
 	// mouse
 	{ SDL_BUTTON_LEFT, INPUT_MOUSE_LEFT },
 	{ SDL_BUTTON_MIDDLE, INPUT_MOUSE_CENTER },
@@ -94,6 +100,30 @@ static struct intmap_t sdlkey_to_inputkey[] = {
 	{ SDL_CONTROLLER_BUTTON_DPAD_RIGHT, INPUT_CTRLLR_DPAD_R },
 };
 
+static char *inputkey_names[INPUT_KEY_TOTAL] = {
+	[INPUT_KEY_0] = "0", [INPUT_KEY_1] = "1", [INPUT_KEY_2] = "2", [INPUT_KEY_3] = "3",
+	[INPUT_KEY_4] = "4", [INPUT_KEY_5] = "5", [INPUT_KEY_6] = "6", [INPUT_KEY_7] = "7",
+	[INPUT_KEY_8] = "8", [INPUT_KEY_9] = "9",
+
+	[INPUT_KEY_Q] = "Q", [INPUT_KEY_W] = "W", [INPUT_KEY_E] = "E", [INPUT_KEY_R] = "R",
+	[INPUT_KEY_T] = "T", [INPUT_KEY_Y] = "Y", [INPUT_KEY_U] = "U", [INPUT_KEY_I] = "I",
+	[INPUT_KEY_O] = "O", [INPUT_KEY_P] = "P", [INPUT_KEY_A] = "A", [INPUT_KEY_S] = "S",
+	[INPUT_KEY_D] = "D", [INPUT_KEY_F] = "F", [INPUT_KEY_G] = "G", [INPUT_KEY_H] = "H",
+	[INPUT_KEY_J] = "J", [INPUT_KEY_K] = "K", [INPUT_KEY_L] = "L", [INPUT_KEY_Z] = "Z",
+	[INPUT_KEY_X] = "X", [INPUT_KEY_C] = "C", [INPUT_KEY_V] = "V", [INPUT_KEY_B] = "B",
+	[INPUT_KEY_N] = "N", [INPUT_KEY_M] = "M",
+
+	[INPUT_KEY_UARROW] = "UP", [INPUT_KEY_RARROW] = "RIGHT",
+	[INPUT_KEY_DARROW] = "DOWN", [INPUT_KEY_LARROW] = "LEFT",
+
+	[INPUT_KEY_SHIFT] = "SHIFT", [INPUT_KEY_TAB] = "TAB",
+
+	[INPUT_KEY_ESC] = "ESC", [INPUT_KEY_SPACE] = "SPACE", [INPUT_KEY_HOME] = "HOME",
+	[INPUT_KEY_END] = "END", [INPUT_KEY_CTRL] = "CTRL",
+
+	[INPUT_KEY_F1] = "F1", [INPUT_KEY_F2] = "F2", [INPUT_KEY_F3] = "F3", [INPUT_KEY_F4] = "F4",
+};
+
 /* InputReadKeys : Handles the Keyboard */
 s32 InputReadKeys(SDL_Event *event, struct io_t *input);
 
@@ -106,6 +136,12 @@ s32 InputReadWindow(SDL_Event *event, struct io_t *input);
 // InputCycleKeyState : cycles the key state to give rising / falling edges
 void InputCycleKeyState(struct io_t *io);
 
+// InputReplay : applies this tick's recorded key edges
+void InputReplay(struct io_t *io);
+
+// InputRecord : writes this tick's key edges to the recording
+void InputRecord(struct io_t *io);
+
 // InputRead : handles input from SDL
 s32 InputRead(struct io_t *io)
 {
@@ -139,6 +175,11 @@ s32 InputRead(struct io_t *io)
 		}
 	}
 
+	InputReplay(io);
+	InputRecord(io);
+
+	io->tick++;
+
 	return 0;
 }
 
@@ -268,3 +309,138 @@ s32 InputReadWindow(SDL_Event *event, struct io_t *io)
 	return 0;
 }
 
+
+// InputKeyFromName : returns the INPUT_KEY_* for the name, or -1
+static s32 InputKeyFromName(char *name)
+{
+	s32 i;
+
+	for (i = 0; i < INPUT_KEY_TOTAL; i++) {
+		if (inputkey_names[i] && streq(inputkey_names[i], name)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// InputRecordOpen : starts writing every key edge to the file at path
+s32 InputRecordOpen(struct io_t *io, char *path)
+{
+	assert(io);
+	assert(path);
+
+	io->record_fp = fopen(path, "w");
+	if (io->record_fp == NULL) {
+		ERR("Couldn't open '%s' to record input\n", path);
+		return -1;
+	}
+
+	fprintf(io->record_fp, "# tick key state\n");
+
+	return 0;
+}
+
+// InputReplayOpen : loads a recorded input stream, to be played back by InputRead
+s32 InputReplayOpen(struct io_t *io, char *path)
+{
+	struct inputevent_t *event;
+	char *buf, *s, *line;
+	char name[BUFSMALL], state[BUFSMALL];
+	u32 tick;
+	s32 key, lineno;
+
+	assert(io);
+	assert(path);
+
+	buf = sys_readfile(path);
+	if (buf == NULL) {
+		ERR("Couldn't read input replay '%s'\n", path);
+		return -1;
+	}
+
+	for (s = buf, lineno = 1; s; lineno++) {
+		line = ltrim(bstrtok(&s, "\n"));
+
+		if (line[0] == '#' || line[0] == '\0')
+			continue;
+
+		if (sscanf(line, "%u %255s %255s", &tick, name, state) != 3) {
+			ERR("%s:%d: expected 'tick key down|up'\n", path, lineno);
+			continue;
+		}
+
+		key = InputKeyFromName(name);
+		if (key < 0) {
+			ERR("%s:%d: unknown key '%s'\n", path, lineno, name);
+			continue;
+		}
+
+		C_RESIZE(&io->replay);
+
+		event = io->replay + io->replay_len++;
+
+		event->tick = tick;
+		event->key = key;
+		event->state = streq(state, "down") ? INSTATE_PRESSED : INSTATE_RELEASED;
+	}
+
+	C_FREE(buf);
+
+	io->replay_next = 0;
+
+	return 0;
+}
+
+// InputReplay : applies this tick's recorded key edges
+void InputReplay(struct io_t *io)
+{
+	struct inputevent_t *event;
+
+	// NOTE (Brian) the events are assumed to be in tick order, which is how we write them
+	while (io->replay_next < io->replay_len) {
+		event = io->replay + io->replay_next;
+
+		if (event->tick > io->tick)
+			break;
+
+		io->keys[event->key] = event->state;
+		io->replay_next++;
+	}
+}
+
+// InputRecord : writes this tick's key edges to the recording
+void InputRecord(struct io_t *io)
+{
+	s32 i;
+
+	if (io->record_fp == NULL)
+		return;
+
+	for (i = 0; i < INPUT_KEY_TOTAL; i++) {
+		if (inputkey_names[i] == NULL)
+			continue;
+
+		if (io->keys[i] == INSTATE_PRESSED) {
+			fprintf(io->record_fp, "%u %s down\n", io->tick, inputkey_names[i]);
+		} else if (io->keys[i] == INSTATE_RELEASED) {
+			fprintf(io->record_fp, "%u %s up\n", io->tick, inputkey_names[i]);
+		}
+	}
+}
+
+// InputClose : closes the recording, and frees the replay
+void InputClose(struct io_t *io)
+{
+	assert(io);
+
+	if (io->record_fp) {
+		fclose(io->record_fp);
+		io->record_fp = NULL;
+	}
+
+	C_FREE(io->replay);
+
+	io->replay = NULL;
+	io->replay_len = io->replay_cap = io->replay_next = 0;
+}
@@ -99,6 +99,12 @@ enum {
 	INPUT_KEY_HOME,
 	INPUT_KEY_END,
 	INPUT_KEY_CTRL,
+
+	// function keys (debug toggles)
+	INPUT_KEY_F1,
+	INPUT_KEY_F2,
+	INPUT_KEY_F3,
+	INPUT_KEY_F4,
 	INPUT_KEY__END,
 
 	// mouse "keys"
@@ -129,6 +135,22 @@ enum {
 	INPUT_KEY_TOTAL
 };
 
+// INPUT RECORDING
+//
+// Every key edge can get written out to a text file, one per line, as
+//
+//   TICK KEYNAME down|up
+//
+// and a file like that can get played back later in place of (well, on top of) the real keyboard.
+// With a fixed seed, that makes a run completely repeatable. The files are meant to be easy to
+// write by hand, too. Lines starting with '#' are comments.
+
+struct inputevent_t {
+	u32 tick;
+	s32 key;
+	s32 state; // INSTATE_PRESSED or INSTATE_RELEASED
+};
+
 struct io_t {
 	s32 sig_quit;
 	s32 __placeholder__;
@@ -136,12 +158,29 @@ struct io_t {
 	s8 keys[INPUT_KEY_TOTAL];
 
 	s32 win_w, win_h;
+
+	u32 tick; // number of times InputRead has been called
+
+	FILE *record_fp;
+
+	struct inputevent_t *replay;
+	size_t replay_len, replay_cap;
+	size_t replay_next;
 };
 
 // INPUT FUNCTIONS
 // InputRead : handles input from SDL
 s32 InputRead(struct io_t *input);
 
+// InputRecordOpen : starts writing every key edge to the file at path
+s32 InputRecordOpen(struct io_t *io, char *path);
+
+// InputReplayOpen : loads a recorded input stream, to be played back by InputRead
+s32 InputReplayOpen(struct io_t *io, char *path);
+
+// InputClose : closes the recording, and frees the replay
+void InputClose(struct io_t *io);
+
 /* InputReadKeys : Handles the Keyboard */
 // s32 InputReadKeys(SDL_Event *event, struct io_t *input);
 
@@ -0,0 +1,319 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-11 20:41:09
+ *
+ * Job Pool
+ */
+
+#include "common.h"
+
+#include "job.h"
+#include "prof.h"
+
+// JobWorker : the worker thread's main loop
+static int JobWorker(void *arg)
+{
+	struct jobworker_t *worker;
+	struct jobpool_t *pool;
+	struct job_t job;
+	char name[32];
+
+	worker = arg;
+	pool = worker->pool;
+
+	snprintf(name, sizeof name, "worker %d", worker->idx);
+	ProfThreadName(name);
+
+	for (;;) {
+		SDL_LockMutex(pool->lock);
+
+		while (!pool->quit && pool->jobs_head == pool->jobs_len) {
+			SDL_CondWait(pool->work, pool->lock);
+		}
+
+		if (pool->jobs_head == pool->jobs_len) { // quitting, and there's nothing left
+			SDL_UnlockMutex(pool->lock);
+			break;
+		}
+
+		job = pool->jobs[pool->jobs_head++];
+
+		// once everything's been picked up, rewind the queue so it doesn't grow forever
+		if (pool->jobs_head == pool->jobs_len) {
+			pool->jobs_head = pool->jobs_len = 0;
+		}
+
+		SDL_UnlockMutex(pool->lock);
+
+		job.func(job.arg, worker->idx);
+
+		SDL_LockMutex(pool->lock);
+		if (job.group && --job.group->pending == 0) {
+			SDL_CondBroadcast(job.group->done);
+		}
+		if (--pool->pending == 0) {
+			SDL_CondBroadcast(pool->done);
+		}
+		SDL_UnlockMutex(pool->lock);
+	}
+
+	return 0;
+}
+
+// JobPoolInit : starts up the pool, nthreads <= 0 means one per core (minus the main thread)
+s32 JobPoolInit(struct jobpool_t *pool, s32 nthreads)
+{
+	struct jobworker_t *worker;
+	s32 i;
+
+	assert(pool);
+
+	memset(pool, 0, sizeof(*pool));
+
+	if (nthreads <= 0) {
+		nthreads = SDL_GetCPUCount() - 1;
+	}
+
+	nthreads = MAX(1, MIN(nthreads, JOB_MAX_WORKERS));
+
+	// these start empty, and grow to whatever a frame needs
+	for (i = 0; i < JOB_MAX_WORKERS; i++) {
+		ArenaInit(pool->scratch + i, "worker", MEM_SCRATCH, 0, 0);
+	}
+
+	pool->lock = SDL_CreateMutex();
+	pool->work = SDL_CreateCond();
+	pool->done = SDL_CreateCond();
+
+	if (!pool->lock || !pool->work || !pool->done) {
+		ERR("Couldn't create job pool primitives: %s\n", SDL_GetError());
+		return -1;
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		worker = pool->workers + i;
+
+		worker->pool = pool;
+		worker->idx = i;
+
+		pool->threads[i] = SDL_CreateThread(JobWorker, "worker", worker);
+		if (pool->threads[i] == NULL) {
+			ERR("Couldn't create worker thread %d: %s\n", i, SDL_GetError());
+			break;
+		}
+
+		pool->threads_len++;
+	}
+
+	return pool->threads_len ? 0 : -1;
+}
+
+// JobSubmit : queues up a job
+void JobSubmit(struct jobpool_t *pool, jobfunc_t func, void *arg)
+{
+	assert(pool);
+	assert(func);
+
+	// without any workers, just do the work right here
+	if (pool->threads_len == 0) {
+		func(arg, 0);
+		return;
+	}
+
+	SDL_LockMutex(pool->lock);
+
+	C_RESIZE(&pool->jobs);
+
+	pool->jobs[pool->jobs_len].func = func;
+	pool->jobs[pool->jobs_len].arg = arg;
+	pool->jobs[pool->jobs_len].group = NULL;
+	pool->jobs_len++;
+
+	pool->pending++;
+
+	SDL_CondSignal(pool->work);
+	SDL_UnlockMutex(pool->lock);
+}
+
+// JobWait : blocks until every submitted job has finished
+void JobWait(struct jobpool_t *pool)
+{
+	assert(pool);
+
+	if (pool->threads_len == 0)
+		return;
+
+	SDL_LockMutex(pool->lock);
+	while (pool->pending) {
+		SDL_CondWait(pool->done, pool->lock);
+	}
+	SDL_UnlockMutex(pool->lock);
+}
+
+// JobGroupInit : sets up an empty group
+s32 JobGroupInit(struct jobgroup_t *group)
+{
+	assert(group);
+
+	memset(group, 0, sizeof(*group));
+
+	group->done = SDL_CreateCond();
+	if (group->done == NULL) {
+		ERR("Couldn't create a job group: %s\n", SDL_GetError());
+		return -1;
+	}
+
+	return 0;
+}
+
+// JobGroupFree : releases the group (nothing in it can still be running)
+void JobGroupFree(struct jobgroup_t *group)
+{
+	assert(group);
+	assert(group->pending == 0);
+
+	if (group->done)
+		SDL_DestroyCond(group->done);
+
+	memset(group, 0, sizeof(*group));
+}
+
+// JobSubmitGroup : queues up a job in the group, ahead of every ungrouped job
+void JobSubmitGroup(struct jobpool_t *pool, struct jobgroup_t *group, jobfunc_t func, void *arg)
+{
+	size_t i;
+
+	assert(pool);
+	assert(group);
+	assert(func);
+
+	if (pool->threads_len == 0) {
+		func(arg, 0);
+		return;
+	}
+
+	SDL_LockMutex(pool->lock);
+
+	C_RESIZE(&pool->jobs);
+
+	// NOTE (Brian) behind the other grouped jobs that are still waiting, but in front of the decodes
+	// and reads, which can take a lot longer than a frame to drain
+	for (i = pool->jobs_head; i < pool->jobs_len && pool->jobs[i].group; i++)
+		;
+
+	memmove(pool->jobs + i + 1, pool->jobs + i, (pool->jobs_len - i) * sizeof(*pool->jobs));
+
+	pool->jobs[i].func = func;
+	pool->jobs[i].arg = arg;
+	pool->jobs[i].group = group;
+	pool->jobs_len++;
+
+	group->pending++;
+	pool->pending++;
+
+	SDL_CondSignal(pool->work);
+	SDL_UnlockMutex(pool->lock);
+}
+
+// JobWaitGroup : blocks until every job in the group has finished
+void JobWaitGroup(struct jobpool_t *pool, struct jobgroup_t *group)
+{
+	assert(pool);
+	assert(group);
+
+	if (pool->threads_len == 0)
+		return;
+
+	SDL_LockMutex(pool->lock);
+	while (group->pending) {
+		SDL_CondWait(group->done, pool->lock);
+	}
+	SDL_UnlockMutex(pool->lock);
+}
+
+// JobPoolFree : stops the workers and releases the pool
+void JobPoolFree(struct jobpool_t *pool)
+{
+	s32 i;
+
+	assert(pool);
+
+	if (pool->lock) {
+		SDL_LockMutex(pool->lock);
+		pool->quit = 1;
+		SDL_CondBroadcast(pool->work);
+		SDL_UnlockMutex(pool->lock);
+	}
+
+	for (i = 0; i < pool->threads_len; i++) {
+		SDL_WaitThread(pool->threads[i], NULL);
+	}
+
+	if (pool->done)
+		SDL_DestroyCond(pool->done);
+	if (pool->work)
+		SDL_DestroyCond(pool->work);
+	if (pool->lock)
+		SDL_DestroyMutex(pool->lock);
+
+	C_FREE(pool->jobs);
+
+	for (i = 0; i < JOB_MAX_WORKERS; i++) {
+		ArenaFree(pool->scratch + i);
+	}
+
+	memset(pool, 0, sizeof(*pool));
+}
+
+// JobScratch : the worker's scratch arena, good until the next JobScratchReset
+struct arena_t *JobScratch(struct jobpool_t *pool, s32 worker)
+{
+	assert(pool);
+	assert(0 <= worker && worker < JOB_MAX_WORKERS);
+
+	return pool->scratch + worker;
+}
+
+// JobScratchReset : resets every worker's scratch (nothing that's using it can be running)
+void JobScratchReset(struct jobpool_t *pool)
+{
+	s32 i;
+
+	assert(pool);
+
+	// NOTE (Brian) without any threads, jobs run on the caller as worker 0
+	for (i = 0; i < MAX(1, pool->threads_len); i++) {
+		ArenaReset(pool->scratch + i);
+	}
+}
+
+// JobScratchPeak : the biggest last frame high water mark, out of all of the workers
+size_t JobScratchPeak(struct jobpool_t *pool)
+{
+	size_t peak;
+	s32 i;
+
+	assert(pool);
+
+	for (i = 0, peak = 0; i < MAX(1, pool->threads_len); i++) {
+		peak = MAX(peak, pool->scratch[i].last);
+	}
+
+	return peak;
+}
+
+// JobScratchAllocs : every allocation out of the workers' arenas, added up
+u64 JobScratchAllocs(struct jobpool_t *pool)
+{
+	u64 allocs;
+	s32 i;
+
+	assert(pool);
+
+	for (i = 0, allocs = 0; i < MAX(1, pool->threads_len); i++) {
+		allocs += pool->scratch[i].allocs;
+	}
+
+	return allocs;
+}
+
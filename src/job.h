@@ -0,0 +1,107 @@
+#ifndef JOB_H
+#define JOB_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-11 20:41:09
+ *
+ * Job Pool
+ *
+ * A fixed number of SDL threads pull work items off of a single queue. There's nothing clever
+ * going on here, the jobs we hand it are big (a band of the framebuffer, a whole png), so a
+ * mutex around the queue is more than good enough.
+ *
+ * Each job gets the index of the worker running it, so callers can keep per-worker scratch
+ * space without any locking. The pool keeps one scratch arena per worker for that (JobScratch),
+ * reset every frame, so it's only for jobs that are done before the frame is (not asset decodes).
+ *
+ * JobWait waits on everything in the pool, decodes and stream reads included. Work that has to be
+ * done this frame (the software renderer's bands) goes in a jobgroup_t instead: JobSubmitGroup
+ * puts it ahead of every ungrouped job in the queue, and JobWaitGroup only waits on that group.
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+#include "arena.h"
+
+#define JOB_MAX_WORKERS (32)
+
+typedef void (*jobfunc_t)(void *arg, s32 worker);
+
+struct jobgroup_t {
+	SDL_cond *done; // signaled when the group runs out of work
+	s32 pending;    // submitted, but not yet finished (under the pool's lock)
+};
+
+struct job_t {
+	jobfunc_t func;
+	void *arg;
+	struct jobgroup_t *group; // NULL for plain JobSubmit jobs
+};
+
+struct jobpool_t;
+
+struct jobworker_t {
+	struct jobpool_t *pool;
+	s32 idx;
+};
+
+struct jobpool_t {
+	SDL_Thread *threads[JOB_MAX_WORKERS];
+	struct jobworker_t workers[JOB_MAX_WORKERS];
+	s32 threads_len;
+
+	SDL_mutex *lock;
+	SDL_cond *work;  // signaled when a job is added (or we're shutting down)
+	SDL_cond *done;  // signaled when the pool runs out of work
+
+	struct job_t *jobs;
+	size_t jobs_len, jobs_cap;
+	size_t jobs_head;
+
+	s32 pending; // submitted, but not yet finished
+	s32 quit;
+
+	struct arena_t scratch[JOB_MAX_WORKERS]; // per worker, reset by JobScratchReset
+};
+
+// JobPoolInit : starts up the pool, nthreads <= 0 means one per core (minus the main thread)
+s32 JobPoolInit(struct jobpool_t *pool, s32 nthreads);
+
+// JobSubmit : queues up a job
+void JobSubmit(struct jobpool_t *pool, jobfunc_t func, void *arg);
+
+// JobWait : blocks until every submitted job has finished
+void JobWait(struct jobpool_t *pool);
+
+// JobGroupInit : sets up an empty group
+s32 JobGroupInit(struct jobgroup_t *group);
+
+// JobGroupFree : releases the group (nothing in it can still be running)
+void JobGroupFree(struct jobgroup_t *group);
+
+// JobSubmitGroup : queues up a job in the group, ahead of every ungrouped job
+void JobSubmitGroup(struct jobpool_t *pool, struct jobgroup_t *group, jobfunc_t func, void *arg);
+
+// JobWaitGroup : blocks until every job in the group has finished
+void JobWaitGroup(struct jobpool_t *pool, struct jobgroup_t *group);
+
+// JobScratch : the worker's scratch arena, good until the next JobScratchReset
+struct arena_t *JobScratch(struct jobpool_t *pool, s32 worker);
+
+// JobScratchReset : resets every worker's scratch (nothing that's using it can be running)
+void JobScratchReset(struct jobpool_t *pool);
+
+// JobScratchPeak : the biggest last frame high water mark, out of all of the workers
+size_t JobScratchPeak(struct jobpool_t *pool);
+
+// JobScratchAllocs : every allocation out of the workers' arenas, added up
+u64 JobScratchAllocs(struct jobpool_t *pool);
+
+// JobPoolFree : stops the workers and releases the pool
+void JobPoolFree(struct jobpool_t *pool);
+
+#endif // JOB_H
+
@@ -0,0 +1,587 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-27 20:14:52
+ *
+ * Asynchronous Logger
+ */
+
+#include "common.h"
+
+#include "log.h"
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+
+// how long the logger sleeps when there's nothing to do, if nobody wakes it up first
+#define LOG_SLEEP_MS (100)
+
+// what the logger writes out in one go
+#define LOG_BATCH (BUFLARGE * 4)
+
+enum {
+	LOGLEN_NONE,
+	LOGLEN_HH,
+	LOGLEN_H,
+	LOGLEN_L,
+	LOGLEN_LL,
+	LOGLEN_J,
+	LOGLEN_Z,
+	LOGLEN_T,
+	LOGLEN_BIGL
+};
+
+// logspec_t : one conversion in a format string
+struct logspec_t {
+	char *start;  // the '%'
+	char *dot;    // where the precision starts (or the length modifier, if there isn't one)
+	char *length; // where the length modifier starts (or the conversion, if there isn't one)
+	char *end;    // one past the conversion
+	s32 stars;    // '*' width and precision, which are int arguments ahead of the value
+	s32 precision; // -1 for none, -2 for '*'
+	s32 len;      // LOGLEN_*
+	char conv;
+};
+
+struct log_t {
+	struct logrecord_t *ring;
+
+	SDL_atomic_t head CACHE_ALIGNED; // the next slot a producer claims
+	SDL_atomic_t dropped;
+
+	u32 tail CACHE_ALIGNED; // the next slot the logger reads (logger thread only)
+	SDL_atomic_t done;      // tail, as of the last batch, for LogFlush
+	u32 reported;           // dropped, as of the last time we said so
+
+	SDL_atomic_t sleeping;
+	SDL_atomic_t quit;
+	SDL_sem *wake;
+	SDL_Thread *thread;
+
+	u64 start;
+	f64 freq;
+	s32 running;
+};
+
+static struct log_t gLog;
+
+static char *gLogLevels[] = {
+	"   ", "ERR", "WRN", "MSG", "LOG", "DBG"
+};
+
+// LogSpec : parses the conversion at p (a '%'), returns 0 if we can't copy its argument
+static s32 LogSpec(char *p, struct logspec_t *spec)
+{
+	memset(spec, 0, sizeof(*spec));
+
+	spec->start = p++;
+	spec->precision = -1;
+
+	while (*p && strchr("-+ #0", *p))
+		p++;
+
+	if (*p == '*') {
+		spec->stars++;
+		p++;
+	} else {
+		while (isdigit(*p))
+			p++;
+	}
+
+	spec->dot = p;
+
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->stars++;
+			spec->precision = -2;
+			p++;
+		} else {
+			for (spec->precision = 0; isdigit(*p); p++) {
+				spec->precision = spec->precision * 10 + (*p - '0');
+			}
+		}
+	}
+
+	spec->length = p;
+
+	switch (*p) {
+		case 'h': spec->len = p[1] == 'h' ? LOGLEN_HH : LOGLEN_H; break;
+		case 'l': spec->len = p[1] == 'l' ? LOGLEN_LL : LOGLEN_L; break;
+		case 'j': spec->len = LOGLEN_J; break;
+		case 'z': spec->len = LOGLEN_Z; break;
+		case 't': spec->len = LOGLEN_T; break;
+		case 'L': spec->len = LOGLEN_BIGL; break;
+	}
+
+	if (spec->len == LOGLEN_HH || spec->len == LOGLEN_LL) {
+		p += 2;
+	} else if (spec->len != LOGLEN_NONE) {
+		p += 1;
+	}
+
+	spec->conv = *p;
+	spec->end = *p ? p + 1 : p;
+
+	switch (spec->conv) {
+		case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+		case 'p': case '%':
+			return 1;
+
+		case 'c': case 's':
+			return spec->len == LOGLEN_NONE; // no wide characters
+
+		default: // %n, or something we don't know
+			return 0;
+	}
+}
+
+// LogPut : appends bytes to a record's arguments, 0 if they don't fit
+static s32 LogPut(struct logrecord_t *rec, void *p, size_t n)
+{
+	if (rec->argslen + n > LOG_ARGBYTES)
+		return 0;
+
+	memcpy(rec->args + rec->argslen, p, n);
+	rec->argslen += n;
+
+	return 1;
+}
+
+// LogArgsCopy : copies fmt's arguments into the record, returns 0 if they don't fit
+static s32 LogArgsCopy(struct logrecord_t *rec, char *fmt, va_list args)
+{
+	struct logspec_t spec;
+	union { s64 i; u64 u; f64 f; void *p; } v;
+	char *p, *s;
+	s32 i, star;
+	u32 n;
+
+	rec->argslen = 0;
+
+	for (p = strchr(fmt, '%'); p; p = strchr(spec.end, '%')) {
+		if (!LogSpec(p, &spec))
+			return 0;
+
+		if (spec.conv == '%')
+			continue;
+
+		for (i = 0, star = 0; i < spec.stars; i++) {
+			star = va_arg(args, int);
+			v.i = star;
+			if (!LogPut(rec, &v, sizeof v))
+				return 0;
+		}
+
+		switch (spec.conv) {
+			case 'd': case 'i':
+				switch (spec.len) {
+					case LOGLEN_HH: v.i = (signed char)va_arg(args, int); break;
+					case LOGLEN_H:  v.i = (short)va_arg(args, int); break;
+					case LOGLEN_L:  v.i = va_arg(args, long); break;
+					case LOGLEN_LL: v.i = va_arg(args, long long); break;
+					case LOGLEN_J:  v.i = va_arg(args, intmax_t); break;
+					case LOGLEN_Z:  v.i = (s64)va_arg(args, size_t); break;
+					case LOGLEN_T:  v.i = va_arg(args, ptrdiff_t); break;
+					default:        v.i = va_arg(args, int); break;
+				}
+				break;
+
+			case 'u': case 'o': case 'x': case 'X':
+				switch (spec.len) {
+					case LOGLEN_HH: v.u = (unsigned char)va_arg(args, unsigned int); break;
+					case LOGLEN_H:  v.u = (unsigned short)va_arg(args, unsigned int); break;
+					case LOGLEN_L:  v.u = va_arg(args, unsigned long); break;
+					case LOGLEN_LL: v.u = va_arg(args, unsigned long long); break;
+					case LOGLEN_J:  v.u = va_arg(args, uintmax_t); break;
+					case LOGLEN_Z:  v.u = va_arg(args, size_t); break;
+					case LOGLEN_T:  v.u = (u64)va_arg(args, ptrdiff_t); break;
+					default:        v.u = va_arg(args, unsigned int); break;
+				}
+				break;
+
+			case 'c':
+				v.i = va_arg(args, int);
+				break;
+
+			case 'p':
+				v.p = va_arg(args, void *);
+				break;
+
+			case 's':
+				// the string itself goes in, the caller's buffer is gone by the time we format
+				s = va_arg(args, char *);
+				if (s == NULL)
+					s = "(null)";
+
+				// %.*s (and %.4s) doesn't have to be terminated
+				if (spec.precision == -2) {
+					n = star < 0 ? strlen(s) : strnlen(s, star);
+				} else if (spec.precision >= 0) {
+					n = strnlen(s, spec.precision);
+				} else {
+					n = strlen(s);
+				}
+
+				if (!LogPut(rec, &n, sizeof n) || !LogPut(rec, s, n))
+					return 0;
+				continue;
+
+			default: // floats
+				if (spec.len == LOGLEN_BIGL) {
+					v.f = va_arg(args, long double);
+				} else {
+					v.f = va_arg(args, double);
+				}
+				break;
+		}
+
+		if (!LogPut(rec, &v, sizeof v))
+			return 0;
+	}
+
+	return 1;
+}
+
+// LogPrefix : writes the level (and for DBG, where it came from) and the time, returns the length
+static s32 LogPrefix(char *out, size_t size, s32 level, const char *func, s32 line, u64 time)
+{
+	f64 t;
+
+	t = (f64)(time - gLog.start) / gLog.freq;
+
+	if (level == LOG_DBG)
+		return snprintf(out, size, "%16s:%04d %s %8.3f ", func, line, gLogLevels[level], t);
+	return snprintf(out, size, "%s %8.3f ", gLogLevels[level], t);
+}
+
+// LogFormat : formats a record into out, returns the length
+static size_t LogFormat(struct logrecord_t *rec, char *out, size_t size)
+{
+	struct logspec_t spec;
+	union { s64 i; u64 u; f64 f; void *p; } v;
+	char conv[BUFSMALL], *p, *q, *arg;
+	s32 star[2], i, rc;
+	size_t n;
+	u32 slen;
+
+	n = MIN((size_t)LogPrefix(out, size, rec->level, rec->func, rec->line, rec->time), size - 1);
+
+	arg = (char *)rec->args;
+
+#define LOG_OUT(...) (rc = snprintf(out + n, size - n, __VA_ARGS__), n += rc < 0 ? 0 : MIN((size_t)rc, size - n - 1))
+#define LOG_CONV(val) \
+	(spec.stars == 0 ? LOG_OUT(conv, val) : \
+	 spec.stars == 1 ? LOG_OUT(conv, star[0], val) : LOG_OUT(conv, star[0], star[1], val))
+
+	for (p = rec->fmt; *p && n < size - 1; p = spec.end) {
+		q = strchr(p, '%');
+
+		if (q == NULL) {
+			LOG_OUT("%s", p);
+			break;
+		}
+
+		LOG_OUT("%.*s", (int)(q - p), p);
+
+		LogSpec(q, &spec);
+
+		if (spec.conv == '%') {
+			LOG_OUT("%%");
+			continue;
+		}
+
+		for (i = 0; i < spec.stars; i++) {
+			memcpy(&v, arg, sizeof v);
+			arg += sizeof v;
+			star[i] = (s32)v.i;
+		}
+
+		// the flags, width and precision as they were, but every integer was widened to 64 bits
+		snprintf(conv, sizeof conv, "%.*s%s%c", (int)(spec.length - spec.start), spec.start,
+			strchr("diuoxX", spec.conv) ? "ll" : "", spec.conv);
+
+		if (spec.conv == 's') {
+			memcpy(&slen, arg, sizeof slen);
+			arg += sizeof slen;
+
+			// the string in the slot isn't terminated, and the precision was already applied when
+			// it got copied, so its length goes where the precision was
+			snprintf(conv, sizeof conv, "%.*s.*s", (int)(spec.dot - spec.start), spec.start);
+
+			if (spec.stars == 2 || (spec.stars == 1 && spec.precision != -2)) {
+				LOG_OUT(conv, star[0], (int)slen, arg);
+			} else {
+				LOG_OUT(conv, (int)slen, arg);
+			}
+
+			arg += slen;
+			continue;
+		}
+
+		memcpy(&v, arg, sizeof v);
+		arg += sizeof v;
+
+		switch (spec.conv) {
+			case 'd': case 'i': LOG_CONV((long long)v.i); break;
+			case 'u': case 'o': case 'x': case 'X': LOG_CONV((unsigned long long)v.u); break;
+			case 'c': LOG_CONV((int)v.i); break;
+			case 'p': LOG_CONV(v.p); break;
+			default: LOG_CONV(v.f); break;
+		}
+	}
+
+#undef LOG_CONV
+#undef LOG_OUT
+
+	return n;
+}
+
+// LogWriteNow : formats and writes a message on the calling thread, the way c_fprintf used to
+static int LogWriteNow(char *file, int line, const char *func, int level, FILE *fp, char *fmt, va_list args)
+{
+	char buf[BUFLARGE];
+	s32 n, rc;
+
+	n = LogPrefix(buf, sizeof buf, level, func, line, SDL_GetPerformanceCounter());
+
+	rc = vsnprintf(buf + n, sizeof buf - n, fmt, args);
+	if (rc < 0)
+		rc = 0;
+
+	rc = MIN(n + rc, (s32)sizeof buf - 1);
+	fwrite(buf, 1, rc, fp);
+
+	return rc;
+}
+
+// LogSink : c_fprintf's sink, puts the message in the ring
+static int LogSink(char *file, int line, const char *func, int level, FILE *fp, char *fmt, va_list args)
+{
+	struct logrecord_t *rec;
+	va_list copy;
+	u32 pos, seq;
+	u64 time;
+	s32 fits;
+
+	time = SDL_GetPerformanceCounter();
+
+	// claim a slot: its seq is pos when it's free on this lap, anything behind that means the ring
+	// is full (the logger hasn't gotten to it yet), and anything ahead means somebody beat us to it
+	for (pos = SDL_AtomicGet(&gLog.head);;) {
+		rec = gLog.ring + (pos & LOG_RING_MASK);
+		seq = SDL_AtomicGet(&rec->seq);
+
+		if ((s32)(seq - pos) == 0) {
+			if (SDL_AtomicCAS(&gLog.head, pos, pos + 1))
+				break;
+		} else if ((s32)(seq - pos) < 0) {
+			SDL_AtomicAdd(&gLog.dropped, 1);
+			return 0;
+		} else {
+			pos = SDL_AtomicGet(&gLog.head);
+		}
+	}
+
+	rec->level = level;
+	rec->line = line;
+	rec->file = file;
+	rec->func = func;
+	rec->fmt = fmt;
+	rec->fp = fp;
+	rec->time = time;
+
+	va_copy(copy, args);
+	fits = LogArgsCopy(rec, fmt, copy);
+	va_end(copy);
+
+	// it didn't fit (or has a %n), so the slot goes by empty, and the caller writes it out itself,
+	// behind everything that's already queued
+	if (!fits) {
+		rec->fmt = NULL;
+	}
+
+	SDL_AtomicSet(&rec->seq, pos + 1);
+
+	if (SDL_AtomicGet(&gLog.sleeping)) {
+		SDL_SemPost(gLog.wake);
+	}
+
+	if (!fits) {
+		LogFlush();
+		return LogWriteNow(file, line, func, level, fp, fmt, args);
+	}
+
+	// what comes after an ERR is often an abort()
+	if (level == LOG_ERR) {
+		LogFlush();
+	}
+
+	return 0;
+}
+
+// LogDrain : writes out everything that's ready, returns how many messages that was
+static s32 LogDrain(void)
+{
+	struct logrecord_t *rec;
+	char batch[LOG_BATCH], line[BUFLARGE];
+	size_t batchlen, n;
+	FILE *fp;
+	s32 count;
+	u32 dropped;
+
+	batchlen = 0;
+	fp = NULL;
+
+	for (count = 0;; count++) {
+		rec = gLog.ring + (gLog.tail & LOG_RING_MASK);
+
+		if ((s32)(SDL_AtomicGet(&rec->seq) - (gLog.tail + 1)) != 0)
+			break;
+
+		n = rec->fmt ? LogFormat(rec, line, sizeof line) : 0;
+
+		if (batchlen && (rec->fp != fp || batchlen + n > sizeof batch)) {
+			fwrite(batch, 1, batchlen, fp);
+			batchlen = 0;
+		}
+
+		memcpy(batch + batchlen, line, n);
+		batchlen += n;
+		fp = rec->fp;
+
+		// free for the next lap
+		SDL_AtomicSet(&rec->seq, gLog.tail + LOG_RING_SIZE);
+		gLog.tail++;
+	}
+
+	if (batchlen) {
+		fwrite(batch, 1, batchlen, fp);
+	}
+
+	dropped = SDL_AtomicGet(&gLog.dropped);
+	if (dropped != gLog.reported) {
+		fprintf(stderr, "WRN %8.3f dropped %u log messages, the ring was full\n",
+			(f64)(SDL_GetPerformanceCounter() - gLog.start) / gLog.freq, dropped - gLog.reported);
+		gLog.reported = dropped;
+	}
+
+	SDL_AtomicSet(&gLog.done, gLog.tail);
+
+	return count;
+}
+
+// LogThread : the logger thread
+static int LogThread(void *arg)
+{
+	while (1) {
+		if (LogDrain() > 0)
+			continue;
+
+		if (SDL_AtomicGet(&gLog.quit))
+			break;
+
+		// producers only post the semaphore while we're asleep, so a busy logger costs them nothing
+		SDL_AtomicSet(&gLog.sleeping, 1);
+
+		if ((s32)(SDL_AtomicGet(&gLog.ring[gLog.tail & LOG_RING_MASK].seq) - (gLog.tail + 1)) != 0) {
+			SDL_SemWaitTimeout(gLog.wake, LOG_SLEEP_MS);
+		}
+
+		SDL_AtomicSet(&gLog.sleeping, 0);
+	}
+
+	return 0;
+}
+
+// LogStart : starts the logger thread, and points c_fprintf at the ring
+s32 LogStart(void)
+{
+	u32 i;
+
+	if (gLog.running)
+		return 0;
+
+	memset(&gLog, 0, sizeof gLog);
+
+	gLog.start = SDL_GetPerformanceCounter();
+	gLog.freq = (f64)SDL_GetPerformanceFrequency();
+
+	// NOTE (Brian) plain calloc, not C_CALLOC, the ring outlives the leak check at exit (see common.h)
+	gLog.ring = calloc(LOG_RING_SIZE, sizeof(*gLog.ring));
+	if (gLog.ring == NULL) {
+		ERR("Couldn't allocate the log ring\n");
+		return -1;
+	}
+
+	for (i = 0; i < LOG_RING_SIZE; i++) {
+		SDL_AtomicSet(&gLog.ring[i].seq, i);
+	}
+
+	gLog.wake = SDL_CreateSemaphore(0);
+	if (gLog.wake == NULL) {
+		ERR("Couldn't create the log semaphore: %s\n", SDL_GetError());
+		free(gLog.ring);
+		return -1;
+	}
+
+	gLog.thread = SDL_CreateThread(LogThread, "log", NULL);
+	if (gLog.thread == NULL) {
+		ERR("Couldn't create the logger thread: %s\n", SDL_GetError());
+		SDL_DestroySemaphore(gLog.wake);
+		free(gLog.ring);
+		return -1;
+	}
+
+	gLog.running = 1;
+
+	c_logsink = LogSink;
+
+	// so nothing that's queued gets lost, however main returns
+	atexit(LogStop);
+
+	return 0;
+}
+
+// LogStop : writes out whatever's left, and stops the logger thread (LogStart registers it with atexit)
+void LogStop(void)
+{
+	if (!gLog.running)
+		return;
+
+	// new messages get written on the spot, and the logger finishes off the old ones
+	c_logsink = NULL;
+
+	SDL_AtomicSet(&gLog.quit, 1);
+	SDL_SemPost(gLog.wake);
+	SDL_WaitThread(gLog.thread, NULL);
+
+	// anybody who was already in LogSink when the sink went away
+	LogDrain();
+
+	SDL_DestroySemaphore(gLog.wake);
+	free(gLog.ring);
+
+	gLog.running = 0;
+}
+
+// LogFlush : waits until everything logged so far has been written
+void LogFlush(void)
+{
+	u32 target;
+
+	if (!gLog.running)
+		return;
+
+	target = SDL_AtomicGet(&gLog.head);
+
+	while ((s32)(SDL_AtomicGet(&gLog.done) - target) < 0) {
+		SDL_SemPost(gLog.wake);
+		SDL_Delay(0);
+	}
+}
+
+// LogDropped : how many messages didn't fit in the ring
+u32 LogDropped(void)
+{
+	return SDL_AtomicGet(&gLog.dropped);
+}
@@ -0,0 +1,67 @@
+#ifndef LOG_H
+#define LOG_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-27 20:14:52
+ *
+ * Asynchronous Logger
+ *
+ * Once LogStart has run, LOG / WRN / ERR / ... (common.h) don't format or write anything on the
+ * calling thread. They copy the format pointer, the arguments, and a timestamp into a slot in a
+ * fixed size ring, and a logger thread does the formatting and the writing, in batches.
+ *
+ * The ring is a bounded multi producer queue (every slot has a sequence number, and producers claim
+ * one with a CAS on the head), so any thread can log without a lock. When it's full, the message
+ * is dropped and counted, instead of waiting on the logger; the logger says how many it lost.
+ *
+ * The format string has to outlive the message (every LOG uses a literal, so it does). Arguments are
+ * copied by walking the format: numbers by value, and %s strings into the slot, so a caller's stack
+ * buffer is fine. A message that doesn't fit in a slot gets formatted by the caller instead.
+ *
+ * ERR waits for the logger to write everything up to and including it, since what comes after an
+ * ERR is often an abort(). LogFlush does the same for anybody else about to write to stderr
+ * directly (the reports), so their output doesn't jump ahead of the log.
+ *
+ * Levels are filtered at compile time, see LOG_LEVEL in common.h. Before LogStart and after LogStop,
+ * c_fprintf writes synchronously, like it always has.
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+// slots in the ring, a power of two
+#define LOG_RING_SIZE (1024)
+
+// bytes of arguments (or, for a message that's too big, preformatted text) a slot holds
+#define LOG_ARGBYTES (224)
+
+struct logrecord_t {
+	SDL_atomic_t seq; // which lap of the ring this slot is on, see LogSink
+
+	s32 level;
+	s32 line;
+	char *file;
+	const char *func;
+	char *fmt; // NULL if the message is already formatted, in args
+	FILE *fp;
+	u64 time; // performance counter
+
+	u32 argslen;
+	u8 args[LOG_ARGBYTES];
+};
+
+// LogStart : starts the logger thread, and points c_fprintf at the ring
+s32 LogStart(void);
+
+// LogStop : writes out whatever's left, and stops the logger thread (LogStart registers it with atexit)
+void LogStop(void);
+
+// LogFlush : waits until everything logged so far has been written
+void LogFlush(void);
+
+// LogDropped : how many messages didn't fit in the ring
+u32 LogDropped(void);
+
+#endif // LOG_H
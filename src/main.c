@@ -10,18 +10,42 @@
  * actually be detected. I've tried several things (point in rect check, rect overlap check, ray
  * line intersection check) none of which actually worked.
  *
- * For now, the thing that _seems_ to work well enough is computing the distance between the center
- * of the bullet and the asteroid, and if it's less than a constant (TBD what this should be) it
- * seems to be "good enough".
+ * For a while, the thing that _seemed_ to work well enough was computing the distance between the
+ * center of the bullet and the asteroid, and if it was less than a constant, calling it a hit.
+ *
+ * Now, the ship, asteroid and bullet sprites get collision masks (mask.h) when they're loaded. The
+ * check is a circle test first (each mask knows the radius of its solid pixels), and if the circles
+ * touch, an exact test of the masks, at the rotation each sprite is drawn at.
  *
  * NOTE ENTITIES
  *
- * We're probably going to want to have some logic to like, remove items from an array. Something
- * similar to C_RESIZE, where you give it the array, len, and cap arguments, with size info and
- * whatever, and it removes the item, and memmoves the entire array to fill the gap. I guess if
- * you're passing everything you'd also want to subtract one from the length.
+ * The asteroid and bullet pools are carved out of one arena that lives as long as the level does
+ * (level_arena), sized from the wave (see wave_t). Starting the level over rewinds the arena and
+ * carves them out again, so a restart never touches the heap, no matter how many asteroids there
+ * are. The pools never grow: the wave says how many asteroids there can be, and past the wave's
+ * bullets, the oldest one gets reused.
+ *
+ * The asteroids still look like a C_RESIZE array (see common.h), with _cap as the pool size, and
+ * dead ones get taken out with C_REMOVE_SWAP, which moves the last one into the hole. Nothing holds
+ * on to an asteroid's index across frames, so the order doesn't matter, and it's O(1) instead of a
+ * memmove of the whole array. Nothing that could grow them (C_PUSH, C_RESIZE) is allowed on them.
+ *
+ * NOTE STATE
+ *
+ * There's one state_t, and it's big (the asset container, the job pool with its per-worker arenas,
+ * the software renderer, the startup profiler, ...), so it comes from StateAlloc, page aligned, and
+ * on huge pages with -hugepages, instead of the stack. The fields are in the order they get used:
+ * what Update reads and writes every tick (the screen, the pool pointers, the player, the input)
+ * is packed into the first few cache lines, and everything that's only touched at startup,
+ * shutdown, or by the renderer comes after. New fields go with the ones they get used with.
+ * -counters measures Update, with the cpu's performance counters.
  *
- * Maybe we should just be using stb's stretchy buffers. I'm not sure.
+ * NOTE HEAP
+ *
+ * Every heap allocation is tagged (C_ALLOC, see common.h), and EndFrame counts how many each frame
+ * made. Once the assets are in and the pools are carved out, playing shouldn't touch the heap at
+ * all, everything per-frame comes from the arenas. -alloc-budget 0 warns about every play frame
+ * that does, and which tags it was. Anything still allocated after Close gets reported as a leak.
  */
 
 #define SDL_MAIN_HANDLED
@@ -34,7 +58,10 @@
 #include "common.h"
 #undef COMMON_IMPLEMENTATION
 
-// include all of the libraries first
+// include all of the libraries first, decoded pixels count against MEM_ASSET (see common.h)
+#define STBI_MALLOC(sz)        C_ALLOC(MEM_ASSET, (sz))
+#define STBI_REALLOC(p, newsz) C_REALLOC(MEM_ASSET, (p), (newsz))
+#define STBI_FREE(p)           C_FREE(p)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #undef STB_IMAGE_IMPLEMENTATION
@@ -54,14 +81,53 @@
 
 #define MENU_ITEMS (3)
 
+// how far past the edge of the screen things go before wrapping around (fraction of the screen)
+#define WRAP_OVERHANG (0.02)
+
 #define WINDOW_NAME ("Asteroids")
 
+// ticks checked by -golden, lines up with assets/golden/input.txt
+#define GOLDEN_DEFAULT_TICKS ("10,25,45,100,130")
+
+// and the seed they get rendered with, when there's no -seed
+#define GOLDEN_DEFAULT_SEED (1)
+
+// the packed assets (tools/pak.c), we fall back to the loose files without it
+#define PAK_DEFAULT_PATH ("assets.pak")
+
+// every asset the game uses, and how (see asset.h)
+#define MANIFEST_DEFAULT_PATH ("assets/manifest.txt")
+
+// starting size of the per-frame scratch arena, it grows if a frame needs more
+#define FRAME_ARENA_BYTES (1 << 18)
+
+// leaks listed one by one at exit, past this they're just counted
+#define MEM_LEAKS_SHOWN (32)
+
+// decoded sprites get cached here, so warm starts skip the png decode
+#define CACHE_DEFAULT_DIR (".cache")
+
+// asteroids one job records commands for, RenderAsteroids only splits up a field bigger than this
+#define RENDER_CHUNK (4096)
+#define RENDER_CHUNKS_MAX (64)
+
 #include "io.h"
 #include "asset.h"
-
-struct color_t {
-	u8 r, g, b, a;
-};
+#include "render.h"
+#include "debugdraw.h"
+#include "job.h"
+#include "swrender.h"
+#include "golden.h"
+#include "pak.h"
+#include "mask.h"
+#include "startup.h"
+#include "arena.h"
+#include "perfctr.h"
+#include "log.h"
+#include "trace.h"
+#include "prof.h"
+#include "metrics.h"
+#include "hud.h"
 
 typedef struct vec2f {
 	f32 x, y;
@@ -76,9 +142,13 @@ typedef struct line {
 enum {
 	GAMESCREEN_TITLE,
 	GAMESCREEN_PLAY,
-	GAMESCREEN_CREDITS
+	GAMESCREEN_CREDITS,
+	GAMESCREEN_TOTAL
 };
 
+// each screen's assets are a group (see AssetLoadGroup)
+#define ASSET_GROUP(screen) (1u << (screen))
+
 enum {
 	TITLEENTRY_PLAY,
 	TITLEENTRY_CREDITS,
@@ -99,8 +169,17 @@ struct movement_t {
 	f32 pa;
 };
 
+// entity_t.type, these end up in traces too (see trace.h)
+enum {
+	ENTITY_NONE,
+	ENTITY_PLAYER,
+	ENTITY_ASTEROID,
+	ENTITY_BULLET
+};
+
 struct entity_t {
 	s32 type;
+	u32 id; // unique for the run, the player is always 0
 };
 
 struct player_t {
@@ -123,38 +202,164 @@ struct bullet_t {
 	s32 is_used;
 };
 
+// wave_t : what a level starts with, which is also the most it can ever have (see NOTE ENTITIES)
+struct wave_t {
+	s32 asteroids;
+	s32 bullets; // in flight at once
+};
+
+// rchunk_t : a run of asteroids that one worker records into its own command buffer
+struct rchunk_t {
+	struct state_t *state;
+	struct asset_t *asset;
+	s32 i0, i1; // [i0, i1)
+	struct rcmdbuf_t cmds;
+};
+
+// gamemetrics_t : the handles for every metric the game keeps (see InitMetrics)
+struct gamemetrics_t {
+	struct metric_t *asteroids;        // live
+	struct metric_t *bullets;          // live
+	struct metric_t *bullets_pool;     // how many bullets the wave's pool holds
+	struct metric_t *bullets_overflow; // new bullets that took a live one's slot
+	struct metric_t *collide_pairs;    // pairs tested (before the circle check)
+	struct metric_t *collide_hits;
+	struct metric_t *frame_ns, *update_ns, *render_ns;
+};
+
 struct state_t {
+	// HOT, everything Update touches every tick, from the first cache line on (see NOTE STATE)
 	s32 run;
-	s32 rows, cols;
-
 	u32 ticks;
-
 	s32 screen; // tied to GAMESCREEN_* above
-
 	s32 title_selection; // 0 - 4
-
 	s32 return_from_credits;
+	s32 wave; // into gWaves
+	s32 bullets_len;
+	s32 bullet_next;
+	u32 next_id; // for entity_t.id
 
-	struct player_t player;
-
+	// the entity pools, all out of level_arena (see NOTE ENTITIES)
 	struct asteroid_t *asteroids;
 	size_t asteroids_len, asteroids_cap;
+	struct bullet_t *bullets;
 
-	struct bullet_t bullets[4096];
-	s32 bullet_next;
+	struct player_t player;
 
+	struct io_t io;
+
+	// WARM, the collision checks look their sprites up in here every tick
 	struct asset_container_t asset_container;
 
-	struct io_t io;
+	struct trace_t trace; // with -trace, every Trace* call checks it
+
+	struct gamemetrics_t metrics;
+
+	// COLD, startup, shutdown, the renderer's own state, and the options
+	s32 rows, cols;
+
+	struct arena_t level_arena CACHE_ALIGNED;
+
+	struct pak_t pak;
+
+	struct rcmdbuf_t rcmds;
+
+	struct jobpool_t jobs;
+
+	struct jobgroup_t rgroup; // RenderAsteroids' chunks
+	struct rchunk_t rchunks[RENDER_CHUNKS_MAX];
+
+	struct swrender_t swrender;
+
+	struct startup_t startup;
+
+	struct perfctr_t update_ctr; // around Update, with -counters
+
+	struct hud_t hud;
+
+	// per-frame scratch, reset at the end of every frame (the workers' is in the job pool)
+	struct arena_t frame_arena;
+	size_t scratch_peak; // the most any one frame used, main + workers
+	f64 scratch_sum;     // every frame's, added up, for the mean
+
+	// heap allocations, see NOTE HEAP
+	u64 heap_tags[MEM_TOTAL]; // every tag's running total, at the end of the last frame
+	u64 heap_peak;            // the most any one frame made
+
+	// with -metrics, where the snapshots go, and when (performance counter) the last one was
+	FILE *metrics_fp;
+	u64 metrics_start, metrics_last;
+
+	// command line options
+	s32 headless;   // no window, render on the cpu
+	s32 software;   // render on the cpu, but still show it
+	s32 filter;     // SWFILTER_*
+	s32 max_frames; // quit after this many frames, 0 runs forever
+	char *dumpdir;  // write every software frame here
+	u32 seed;       // for srand, defaults to the time
+	char *record;   // write the input stream here
+	char *replay;   // play the input stream back from here
+	char *tracepath; // write a binary event trace here
+	char *profpath; // write the last profile_seconds of zones here, at exit
+	f64 profile_seconds;
+	char *metricspath; // snapshot the metrics here, every metrics_interval seconds
+	f64 metrics_interval;
+	char *pakpath;  // packed assets
+	s32 nopak;      // always use the loose files
+	char *cachedir; // decoded asset cache
+	s32 nocache;    // always decode
+	s32 memreport;  // print every asset's residency at startup
+	s32 startupreport; // print how long every phase of startup took
+	s32 scratchreport; // print every frame's scratch high water mark
+	s32 counters;      // count cycles, cache and tlb misses in Update, and report them at exit
+	s32 showhud;       // start with the performance hud up
+	s32 heapreport;    // print every heap tag's numbers at exit
+	s32 alloc_budget;  // warn about play frames with more heap allocations than this, -1 is off
+	s32 hugepages;     // the state and the entity pools go on huge pages
+	s32 bench_collide; // run this many collision tests, report, and quit
+	s32 bench_load; // time this many cold loads of every sprite, with every stream backend, and quit
+	s32 bench_restart; // restart the level this many times, report, and quit
+	s32 wave_asteroids; // start every wave with this many asteroids instead, 0 uses the wave's
+	s32 stream;     // STREAM_*, how loose sprites get read in
+	s32 hotreload;  // reload sprites when they change on disk
+	size_t asset_budget; // evict assets past this many bytes, 0 means never
+
+	// golden image checks
+	struct golden_t golden;
+	char *golden_dir;
+	char *golden_ticks;
+	s32 golden_tolerance;
+	s32 golden_update;
 };
 
 // STARTUP / SHUTDOWN FUNCTIONS
+// StateAlloc : allocates the (zeroed) state, see NOTE STATE
+struct state_t *StateAlloc(s32 huge);
+
+// StateFree : frees the state
+void StateFree(struct state_t *state);
+
+// ParseArgs : reads the command line into the state
+s32 ParseArgs(struct state_t *state, int argc, char **argv);
+
 // Init : Initializes the Game State
 s32 Init();
 
 // InitAssets : loads assets
 s32 InitAssets(struct state_t *state);
 
+// PreloadAssets : loads the current screen's assets, and starts on the next likely screen's
+void PreloadAssets(struct state_t *state);
+
+// InitLevel : starts the level over (the pools, the player, and the asteroids)
+s32 InitLevel(struct state_t *state);
+
+// ResetLevel : rewinds the level arena, and carves the current wave's entity pools out of it
+s32 ResetLevel(struct state_t *state);
+
+// LevelWave : the current wave, with any overrides from the command line
+struct wave_t LevelWave(struct state_t *state);
+
 // InitPlayer : initializes the player
 s32 InitPlayer(struct state_t *state);
 
@@ -167,6 +372,24 @@ s32 Close(struct state_t *state);
 // Run : runs the app
 s32 Run(struct state_t *state);
 
+// EndFrame : throws away the frame's scratch, all at once
+void EndFrame(struct state_t *state);
+
+// HeapFrame : counts the frame's heap allocations, and checks them against the budget
+void HeapFrame(struct state_t *state);
+
+// InitMetrics : registers the game's metrics, and opens the -metrics file
+s32 InitMetrics(struct state_t *state);
+
+// SnapshotMetrics : writes a metrics snapshot, if it's been long enough since the last one
+void SnapshotMetrics(struct state_t *state, s32 force);
+
+// FrameStats : fills in the rest of the frame's numbers (the timings are there), for the hud
+void FrameStats(struct state_t *state, struct hudstats_t *stats);
+
+// TraceInput : traces this tick's key edges
+void TraceInput(struct state_t *state);
+
 // Update : the game update function
 void Update(struct state_t *state);
 
@@ -194,6 +417,21 @@ void UpdateMovement(struct movement_t *movement);
 // CheckBulletAsteroidCollision : what it sounds like
 s32 CheckBulletAsteroidCollision(struct state_t *state, s32 aidx, s32 bidx);
 
+// BenchCollisions : times n circle only collision tests against n circle + mask tests
+void BenchCollisions(struct state_t *state, s32 n);
+
+// BenchRestart : times n level restarts
+void BenchRestart(struct state_t *state, s32 n);
+
+// BenchLoad : times n cold page cache loads of every sprite, with each stream backend
+void BenchLoad(struct state_t *state, s32 n);
+
+// SpriteAngle : the rotation (radians) sprites get drawn with, for a movement
+f32 SpriteAngle(struct movement_t *movement);
+
+// SpriteCenter : where the middle of the sprite ends up, once its pivot is put on the movement
+point SpriteCenter(struct asset_t *asset, struct movement_t *movement);
+
 // RENDER FUNCTIONS
 // Render : the game render function
 void Render(struct state_t *state);
@@ -201,6 +439,9 @@ void Render(struct state_t *state);
 // RenderCredits : just draws the credits screen
 void RenderCredits(struct state_t *state);
 
+// RenderLoading : draws (and presents) the loading bar
+void RenderLoading(struct state_t *state, s32 done, s32 total);
+
 // RenderTitle : draws the title screen
 void RenderTitle(struct state_t *state);
 
@@ -210,6 +451,12 @@ void RenderPlayer(struct state_t *state);
 // RenderAsteroids : renders all of the asteroids
 void RenderAsteroids(struct state_t *state);
 
+// RenderAsteroidRange : records the asteroids in [i0, i1) into cmds
+void RenderAsteroidRange(struct state_t *state, struct rcmdbuf_t *cmds, struct asset_t *a_asteroid, s32 i0, s32 i1);
+
+// RenderAsteroidJob : (worker) records one rchunk_t
+void RenderAsteroidJob(void *arg, s32 worker);
+
 // RenderBullets : renders all of the bullets
 void RenderBullets(struct state_t *state);
 
@@ -225,9 +472,6 @@ f32 Distance(point p1, point p2);
 // Delay : conditional delay, as needed
 void Delay(struct state_t *state);
 
-// UtilMakeColor : returns a color
-struct color_t UtilMakeColor(u8 r, u8 g, u8 b, u8 a);
-
 // RandInt : returns a random int in [min, max]
 s32 RandInt(s32 min, s32 max);
 
@@ -240,43 +484,368 @@ void WrapCoord(f32 *coord, f32 min, f32 max);
 // IsOOB : is out of bounds?
 s32 IsOOB(f32 cx, f32 cy, f32 w, f32 h);
 
+// WrapVisible : culls a w x h sprite centered at (px, py), returns where to draw it (0 - 4 places)
+s32 WrapVisible(f32 px, f32 py, f32 w, f32 h, s32 wraps, point *out);
+
+// WrapVisibleAxis : WrapVisible, for just one axis
+s32 WrapVisibleAxis(f32 c, f32 r, f32 max, s32 wraps, f32 *out);
+
 // ClampInt : clamps an integer on the closed interval [min, max]
 s32 ClampInt(s32 curr, s32 min, s32 max);
 
+// ScreenName : returns a printable name for a GAMESCREEN_* value
+char *ScreenName(s32 screen);
+
 // NOTE (Brian) globals are fine if they aren't in a library
 SDL_Window *gWindow;
 SDL_Renderer *gRenderer;
 
+// every wave, in order (there's only the one, for now)
+static struct wave_t gWaves[] = {
+	{ 4, 4096 },
+};
+
 int main(int argc, char **argv)
 {
-	struct state_t state;
+	struct state_t *state;
+	s32 rc, i, huge, leaks;
 
-	srand(time(NULL));
+	// the state has to exist before the arguments can be parsed into it, so this one is looked for early
+	for (i = 1, huge = 0; i < argc; i++) {
+		huge |= streq(argv[i], "-hugepages");
+	}
 
-	Init(&state);
-	Run(&state);
-	Close(&state);
+	// everything from here on logs through the logger thread (see log.h)
+	LogStart();
 
-	return 0;
+	ProfThreadName("main");
+
+	state = StateAlloc(huge);
+	if (state == NULL) {
+		return 1;
+	}
+
+	state->seed = time(NULL);
+	state->profile_seconds = PROF_SECONDS;
+	state->metrics_interval = METRICS_INTERVAL;
+	state->alloc_budget = -1;
+
+	if (ParseArgs(state, argc, argv) < 0) {
+		StateFree(state);
+		return 1;
+	}
+
+	srand(state->seed);
+
+	StartupInit(&state->startup);
+
+	if (Init(state) != 0) {
+		StateFree(state);
+		return 1;
+	}
+
+	if (state->bench_load) {
+		BenchLoad(state, state->bench_load);
+	} else if (state->bench_collide) {
+		BenchCollisions(state, state->bench_collide);
+	} else if (state->bench_restart) {
+		BenchRestart(state, state->bench_restart);
+	} else {
+		Run(state);
+	}
+
+	rc = 0;
+
+	LogFlush();
+
+	if (state->golden.dir && GoldenReport(&state->golden) != 0) {
+		rc = 1;
+	}
+
+	Close(state);
+
+	StateFree(state);
+
+	// everything's been freed, so whatever's left is a leak (see NOTE HEAP)
+	leaks = c_memleaks(MEM_LEAKS_SHOWN);
+	if (leaks) {
+		WRN("%d heap allocations leaked\n", leaks);
+	}
+
+	return rc;
+}
+
+// StateAlloc : allocates the (zeroed) state, see NOTE STATE
+struct state_t *StateAlloc(s32 huge)
+{
+	struct state_t *state;
+
+	state = ArenaPageAlloc(sizeof(*state), huge);
+	if (state == NULL) {
+		ERR("Couldn't allocate %zu bytes for the state\n", sizeof(*state));
+		return NULL;
+	}
+
+	state->hugepages = huge;
+
+	return state;
+}
+
+// StateFree : frees the state
+void StateFree(struct state_t *state)
+{
+	ArenaPageFree(state, sizeof(*state), state->hugepages);
 }
 
 // Run : runs the app
 s32 Run(struct state_t *state)
 {
+	struct hudstats_t stats;
+	u64 frame, start;
+	s32 screen, i;
+	f64 ns;
+
 	assert(state);
 
+	ns = 1e9 / SDL_GetPerformanceFrequency(); // per performance counter tick
+
+	// the frames only count their own heap allocations, not startup's
+	for (i = 0; i < MEM_TOTAL; i++) {
+		state->heap_tags[i] = __atomic_load_n(&c_memtags[i].allocs, __ATOMIC_RELAXED);
+	}
+
 	while (state && state->run && !state->io.sig_quit) {
+		PROF_BEGIN("Frame");
+
+		frame = SDL_GetPerformanceCounter();
+
+		// loads (and hot reloads) get swapped in here, between frames
+		PROF_BEGIN("AssetsFrame");
+		AssetsFrame(&state->asset_container);
+		PreloadAssets(state);
+		PROF_END();
+
+		PROF_BEGIN("InputRead");
 		InputRead(&state->io);
-		Update(state);
+		PROF_END();
+
+		screen = state->screen;
+
+		if (state->trace.fp) {
+			TraceInput(state);
+		}
+
+		PROF_BEGIN("Update");
+		start = SDL_GetPerformanceCounter();
+		if (state->counters) {
+			PerfCtrBegin(&state->update_ctr);
+			Update(state);
+			PerfCtrEnd(&state->update_ctr);
+		} else {
+			Update(state);
+		}
+		stats.update_ns = (SDL_GetPerformanceCounter() - start) * ns;
+		MetricRecord(state->metrics.update_ns, stats.update_ns);
+		PROF_END();
+
+		if (state->screen != screen) {
+			TraceEvent(&state->trace, state->ticks, TRACE_SCREEN, screen, state->screen, 0, 0);
+		}
+
+		PROF_BEGIN("Render");
+		start = SDL_GetPerformanceCounter();
 		Render(state);
+		stats.render_ns = (SDL_GetPerformanceCounter() - start) * ns;
+		MetricRecord(state->metrics.render_ns, stats.render_ns);
+		PROF_END();
+
+		// the first frame is out, that's the end of startup
+		if (state->ticks == 0) {
+			StartupFinish(&state->startup);
+
+			if (state->startupreport) {
+				LogFlush();
+				StartupReport(&state->startup, stderr);
+			} else {
+				LOG("first frame %.3f ms after launch\n", state->startup.total_ms);
+			}
+		}
+
+		if (state->golden.dir) {
+			GoldenCheck(&state->golden, state->ticks, ScreenName(state->screen), &state->swrender);
+		}
+
+		PROF_BEGIN("Delay");
 		Delay(state);
+		PROF_END();
+
+		PROF_BEGIN("EndFrame");
+		EndFrame(state);
+		PROF_END();
+
+		stats.frame_ns = (SDL_GetPerformanceCounter() - frame) * ns;
+		MetricRecord(state->metrics.frame_ns, stats.frame_ns);
+
+		FrameStats(state, &stats);
+
+		PROF_END();
+
+		if (state->metrics_fp) {
+			SnapshotMetrics(state, 0);
+		}
+
+		// between frames, so the workers are idle while their zones get read
+		if (state->io.keys[INPUT_KEY_F2] == INSTATE_PRESSED) {
+			ProfDump(state->profpath ? state->profpath : PROF_PATH, state->profile_seconds);
+		}
 
 		state->ticks++;
+
+		if (state->max_frames && state->max_frames <= state->ticks) {
+			break;
+		}
+	}
+
+	return 0;
+}
+
+// EndFrame : throws away the frame's scratch, all at once
+void EndFrame(struct state_t *state)
+{
+	size_t used;
+
+	assert(state);
+
+	// the workers are done with theirs, everything that uses them waits on the pool inside the frame
+	ArenaReset(&state->frame_arena);
+	JobScratchReset(&state->jobs);
+
+	used = state->frame_arena.last + JobScratchPeak(&state->jobs);
+
+	state->scratch_peak = MAX(state->scratch_peak, used);
+	state->scratch_sum += used;
+
+	if (state->scratchreport) {
+		LOG("frame %u scratch: %zu bytes main, %zu bytes busiest worker\n", state->ticks,
+			state->frame_arena.last, JobScratchPeak(&state->jobs));
+	}
+
+	// after the resets, a spill grows the arena right there
+	HeapFrame(state);
+}
+
+// HeapFrame : counts the frame's heap allocations, and checks them against the budget
+void HeapFrame(struct state_t *state)
+{
+	char buf[BUFSMALL];
+	u64 total, frame[MEM_TOTAL], n;
+	s32 i, len;
+
+	assert(state);
+
+	for (i = 0, n = 0; i < MEM_TOTAL; i++) {
+		total = __atomic_load_n(&c_memtags[i].allocs, __ATOMIC_RELAXED);
+		frame[i] = total - state->heap_tags[i];
+		state->heap_tags[i] = total;
+		n += frame[i];
+	}
+
+	state->heap_peak = MAX(state->heap_peak, n);
+
+	// see NOTE HEAP
+	if (state->alloc_budget < 0 || state->screen != GAMESCREEN_PLAY || n <= (u64)state->alloc_budget)
+		return;
+
+	for (i = 0, len = 0, buf[0] = 0; i < MEM_TOTAL && len < (s32)sizeof buf; i++) {
+		if (frame[i]) {
+			len += snprintf(buf + len, sizeof buf - len, " %s %llu", c_memtagname(i), frame[i]);
+		}
+	}
+
+	WRN("frame %u made %llu heap allocations, over the budget of %d:%s\n", state->ticks, n, state->alloc_budget, buf);
+}
+
+// FrameStats : fills in the rest of the frame's numbers (the timings are there), for the hud
+void FrameStats(struct state_t *state, struct hudstats_t *stats)
+{
+	assert(state);
+	assert(stats);
+
+	stats->asteroids = state->asteroids_len;
+	stats->bullets = MetricValue(state->metrics.bullets);
+	stats->bullets_pool = state->bullets_len;
+	stats->draws = state->rcmds.stats.draws;
+	stats->pairs = MetricValue(state->metrics.collide_pairs);
+	stats->allocs = state->frame_arena.allocs + JobScratchAllocs(&state->jobs);
+	stats->heap = c_memallocs();
+
+	HudFrame(&state->hud, stats);
+}
+
+// TraceInput : traces this tick's key edges
+void TraceInput(struct state_t *state)
+{
+	s32 i;
+
+	for (i = 0; i < INPUT_KEY_TOTAL; i++) {
+		if (state->io.keys[i] == INSTATE_PRESSED || state->io.keys[i] == INSTATE_RELEASED) {
+			TraceEvent(&state->trace, state->ticks, TRACE_INPUT, i, state->io.keys[i], 0, 0);
+		}
+	}
+}
+
+// InitMetrics : registers the game's metrics, and opens the -metrics file
+s32 InitMetrics(struct state_t *state)
+{
+	struct gamemetrics_t *metrics;
+
+	assert(state);
+
+	metrics = &state->metrics;
+
+	metrics->asteroids        = MetricRegister("asteroids.live", METRIC_GAUGE);
+	metrics->bullets          = MetricRegister("bullets.live", METRIC_GAUGE);
+	metrics->bullets_pool     = MetricRegister("bullets.pool", METRIC_GAUGE);
+	metrics->bullets_overflow = MetricRegister("bullets.overflow", METRIC_COUNTER);
+	metrics->collide_pairs    = MetricRegister("collide.pairs", METRIC_COUNTER);
+	metrics->collide_hits     = MetricRegister("collide.hits", METRIC_COUNTER);
+	metrics->frame_ns         = MetricRegister("frame.ns", METRIC_HISTOGRAM);
+	metrics->update_ns        = MetricRegister("update.ns", METRIC_HISTOGRAM);
+	metrics->render_ns        = MetricRegister("render.ns", METRIC_HISTOGRAM);
+
+	if (state->metricspath == NULL)
+		return 0;
+
+	state->metrics_fp = fopen(state->metricspath, "w");
+	if (state->metrics_fp == NULL) {
+		ERR("Couldn't open '%s' to write the metrics\n", state->metricspath);
+		return -1;
 	}
 
+	state->metrics_start = state->metrics_last = SDL_GetPerformanceCounter();
+
 	return 0;
 }
 
+// SnapshotMetrics : writes a metrics snapshot, if it's been long enough since the last one
+void SnapshotMetrics(struct state_t *state, s32 force)
+{
+	u64 now, freq;
+
+	assert(state);
+	assert(state->metrics_fp);
+
+	now = SDL_GetPerformanceCounter();
+	freq = SDL_GetPerformanceFrequency();
+
+	if (!force && now - state->metrics_last < state->metrics_interval * freq)
+		return;
+
+	state->metrics_last = now;
+
+	MetricsWrite(state->metrics_fp, (f64)(now - state->metrics_start) / freq);
+}
+
 // Update : the game update function
 void Update(struct state_t *state)
 {
@@ -287,32 +856,56 @@ void Update(struct state_t *state)
 		state->run = 0;
 	}
 
+	if (state->io.keys[INPUT_KEY_F1] == INSTATE_PRESSED) {
+		DD_TOGGLE();
+	}
+
+	if (state->io.keys[INPUT_KEY_F3] == INSTATE_PRESSED) {
+		HudToggle(&state->hud);
+	}
+
 	switch (state->screen) {
 		case GAMESCREEN_TITLE:
 		{
+			PROF_BEGIN("UpdateTitle");
 			UpdateTitle(state);
+			PROF_END();
 			break;
 		}
 
 		case GAMESCREEN_PLAY:
 		{
+			PROF_BEGIN("CheckCollisions");
 			CheckCollisions(state);
+			PROF_END();
 
 			if (state->player.is_dead) {
+				TraceEntity(&state->trace, state->ticks, TRACE_DESTROY, ENTITY_PLAYER, state->player.entity.id,
+					state->player.movement.px, state->player.movement.py);
+
 				state->screen = GAMESCREEN_TITLE;
-				InitPlayer(state);
-				InitAsteroids(state);
+				InitLevel(state);
 			}
 
+			PROF_BEGIN("UpdatePlayer");
 			UpdatePlayer(state);
+			PROF_END();
+
+			PROF_BEGIN("UpdateBullets");
 			UpdateBullets(state);
+			PROF_END();
+
+			PROF_BEGIN("UpdateAsteroids");
 			UpdateAsteroids(state);
+			PROF_END();
 			break;
 		}
 
 		case GAMESCREEN_CREDITS:
 		{
+			PROF_BEGIN("UpdateCredits");
 			UpdateCredits(state);
+			PROF_END();
 			break;
 		}
 
@@ -383,18 +976,29 @@ void CheckCollisions(struct state_t *state)
 	struct player_t *player;
 	struct asteroid_t *asteroid;
 	struct bullet_t *bullet;
+	struct asset_t *a_ship, *a_asteroid, *a_bullet;
+	struct mask_t *m_ship, *m_asteroid, *m_bullet;
+	struct movement_t *a, *b;
+	point ca, cb;
+	s64 pairs, hits;
 	s32 i, j;
-	point a, b;
 
-	// TODO (brian) this would be better if we attempted to circumscribe the asteroid (and
-	// bullet?) with a circle, and check if the distance from the bullet to the asteroid is
-	// less than the radius of the circle. 8 is just a filler because the asteroid sprite
-	// size is 16, so sqrt(8 * 8) = 8
+	// see NOTE COLLISIONS
+	a_ship     = AssetFetchByName(&state->asset_container, "ship");
+	a_asteroid = AssetFetchByName(&state->asset_container, "asteroid");
+	a_bullet   = AssetFetchByName(&state->asset_container, "bullet");
+
+	m_ship     = a_ship->mask;
+	m_asteroid = a_asteroid->mask;
+	m_bullet   = a_bullet->mask;
 
-#define COLLISION_SIZE (8)
+	// no masks, no collisions (the loads must have failed, and that's been logged)
+	if (!m_ship || !m_asteroid || !m_bullet)
+		return;
 
 	player = &state->player;
 
+	pairs = hits = 0;
 
 	// check for player/asteroid collisions first asteroid
 	for (i = 0; i < state->asteroids_len; i++) {
@@ -404,73 +1008,284 @@ void CheckCollisions(struct state_t *state)
 		asteroid = state->asteroids + i;
 
 		// check for player asteroid collisions first
-		a = Point(asteroid->movement.px, asteroid->movement.py);
-		b = Point(player->movement.px, player->movement.py);
+		a = &asteroid->movement;
+		b = &player->movement;
+
+		// the masks are centered on the sprite, which isn't always where the pivot is
+		ca = SpriteCenter(a_asteroid, a);
+		cb = SpriteCenter(a_ship, b);
+
+		pairs++;
+
+		if (MaskCollide(m_asteroid, ca.x, ca.y, SpriteAngle(a), m_ship, cb.x, cb.y, SpriteAngle(b))) {
+			hits++;
+
+			TraceEvent(&state->trace, state->ticks, TRACE_COLLIDE,
+				ENTITY_ASTEROID, asteroid->entity.id, ENTITY_PLAYER, player->entity.id);
 
-		if (Distance(a, b) <= 24.0f) {
 			player->is_dead = 1;
 			asteroid->is_used = 0;
 		}
 
 		// then check for a collision against all other asteroids
-		for (j = 0; j < ARRSIZE(state->bullets); j++) {
+		for (j = 0; j < state->bullets_len; j++) {
 			if (!state->bullets[j].is_used)
 				continue;
 
 			bullet = state->bullets + j;
-			b = Point(bullet->movement.px, bullet->movement.py);
+			b = &bullet->movement;
+			cb = SpriteCenter(a_bullet, b);
+
+			pairs++;
+
+			if (MaskCollide(m_asteroid, ca.x, ca.y, SpriteAngle(a), m_bullet, cb.x, cb.y, SpriteAngle(b))) {
+				hits++;
+
+				TraceEvent(&state->trace, state->ticks, TRACE_COLLIDE,
+					ENTITY_ASTEROID, asteroid->entity.id, ENTITY_BULLET, bullet->entity.id);
+				TraceEntity(&state->trace, state->ticks, TRACE_DESTROY, ENTITY_BULLET, bullet->entity.id,
+					b->px, b->py);
 
-			if (Distance(a, b) <= 8.0f) {
 				asteroid->is_used = 0;
 				bullet->is_used = 0;
 			}
 		}
 	}
+
+	MetricAdd(state->metrics.collide_pairs, pairs);
+	MetricAdd(state->metrics.collide_hits, hits);
 }
 
-// UpdatePlayer : updates the player
-void UpdatePlayer(struct state_t *state)
+// SpriteAngle : the rotation (radians) sprites get drawn with, for a movement
+f32 SpriteAngle(struct movement_t *movement)
 {
-	struct player_t *player;
-	struct movement_t *movement;
-	struct io_t *io;
+	// the sprites point up, and pr == 0 points right
+	return movement->pr - M_PI / 2;
+}
 
-	io = &state->io;
-	player = &state->player;
-	movement = &player->movement;
+// SpriteCenter : where the middle of the sprite ends up, once its pivot is put on the movement
+point SpriteCenter(struct asset_t *asset, struct movement_t *movement)
+{
+	f32 angle, ox, oy;
 
-	player->is_flying = 0;
+	// from the pivot to the middle, unrotated, then spun the same way the sprite gets drawn
+	ox = (0.5f - asset->pivot_x) * asset->w;
+	oy = (0.5f - asset->pivot_y) * asset->h;
 
-	// I know it says acceleration here, but just go with it for now, okay
+	angle = SpriteAngle(movement);
 
-	// NOTE (brian) we should (maybe) make UpdateMovement work with this too...
+	return Point(movement->px + ox * cosf(angle) - oy * sinf(angle),
+		movement->py + ox * sinf(angle) + oy * cosf(angle));
+}
 
-	player->movement.pv = 0.0;
+// BenchCollisions : times n circle only collision tests against n circle + mask tests
+void BenchCollisions(struct state_t *state, s32 n)
+{
+	struct mask_t *m_ship, *m_asteroid, *m_bullet, *other;
+	struct movement_t *cases;
+	s32 i, j, circles, masks;
+	f64 circle_ms, mask_ms;
+	f32 r;
+	u64 start;
 
-	if (player->is_dead) {
-		state->run = 0;
+	assert(state);
+
+	m_ship     = AssetFetchByName(&state->asset_container, "ship")->mask;
+	m_asteroid = AssetFetchByName(&state->asset_container, "asteroid")->mask;
+	m_bullet   = AssetFetchByName(&state->asset_container, "bullet")->mask;
+
+	if (!m_ship || !m_asteroid || !m_bullet) {
+		ERR("Couldn't load the collision masks\n");
 		return;
 	}
 
-	if (io->keys[INPUT_KEY_D] == INSTATE_DOWN) {
-		player->movement.pv += ACCELERATION;
+	// pairs of (asteroid, other thing), with the other thing somewhere around the asteroid, so
+	// a good chunk of them get past the circle test
+	cases = C_CALLOC(MEM_DEBUG, n * 2, sizeof(*cases));
+
+	for (i = 0; i < n * 2; i += 2) {
+		other = (i / 2) % 2 ? m_bullet : m_ship;
+		r = (m_asteroid->radius + other->radius) * 1.25f;
+
+		cases[i].px = RandFloat(0, GAMERES_WIDTH);
+		cases[i].py = RandFloat(0, GAMERES_HEIGHT);
+		cases[i].pr = RandFloat(0, 2 * M_PI);
+
+		cases[i + 1].px = cases[i].px + RandFloat(-r, r);
+		cases[i + 1].py = cases[i].py + RandFloat(-r, r);
+		cases[i + 1].pr = RandFloat(0, 2 * M_PI);
 	}
 
-	if (io->keys[INPUT_KEY_A] == INSTATE_DOWN) {
-		player->movement.pv -= ACCELERATION;
+	start = SDL_GetPerformanceCounter();
+
+	for (i = 0, circles = 0; i < n * 2; i += 2) {
+		j = i + 1;
+		other = (i / 2) % 2 ? m_bullet : m_ship;
+		circles += MaskCircle(m_asteroid, cases[i].px, cases[i].py, other, cases[j].px, cases[j].py);
 	}
 
-	player->movement.pr += player->movement.pv;
+	circle_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
 
-	if (io->keys[INPUT_KEY_W] == INSTATE_DOWN) {
-		// the clocwiseness of sdl is weird, but it checks out
-		player->movement.vx -= cos(player->movement.pr) * ACCELERATION;
-		player->movement.vy -= sin(player->movement.pr) * ACCELERATION;
-		player->is_flying = 1;
+	start = SDL_GetPerformanceCounter();
+
+	for (i = 0, masks = 0; i < n * 2; i += 2) {
+		j = i + 1;
+		other = (i / 2) % 2 ? m_bullet : m_ship;
+		masks += MaskCollide(m_asteroid, cases[i].px, cases[i].py, SpriteAngle(cases + i),
+			other, cases[j].px, cases[j].py, SpriteAngle(cases + j));
 	}
 
-	player->movement.px += player->movement.vx;
-	player->movement.py += player->movement.vy;
+	mask_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+	LogFlush();
+
+	fprintf(stderr, "%-14s %10s %10s %10s\n", "test", "tests", "hits", "ns/test");
+	fprintf(stderr, "%-14s %10d %10d %10.2f\n", "circle", n, circles, circle_ms * 1e6 / n);
+	fprintf(stderr, "%-14s %10d %10d %10.2f\n", "circle+mask", n, masks, mask_ms * 1e6 / n);
+	fprintf(stderr, "%d of %d circle hits (%.1f%%) didn't actually touch\n",
+		circles - masks, circles, circles ? 100.0 * (circles - masks) / circles : 0.0);
+
+	C_FREE(cases);
+}
+
+// BenchRestart : times n level restarts
+void BenchRestart(struct state_t *state, s32 n)
+{
+	f64 reset_ms, spawn_ms;
+	size_t size;
+	u64 start, mid;
+	s32 i;
+
+	assert(state);
+
+	reset_ms = spawn_ms = 0;
+	size = state->level_arena.size;
+
+	for (i = 0; i < n; i++) {
+		start = SDL_GetPerformanceCounter();
+
+		ResetLevel(state);
+
+		mid = SDL_GetPerformanceCounter();
+
+		InitPlayer(state);
+		InitAsteroids(state);
+
+		reset_ms += (mid - start) * 1000.0 / SDL_GetPerformanceFrequency();
+		spawn_ms += (SDL_GetPerformanceCounter() - mid) * 1000.0 / SDL_GetPerformanceFrequency();
+	}
+
+	LogFlush();
+
+	fprintf(stderr, "%d restarts, %zu asteroids, %d bullets\n", n, state->asteroids_len, state->bullets_len);
+	fprintf(stderr, "%-14s %10.3f us/restart\n", "reset pools", reset_ms * 1e3 / n);
+	fprintf(stderr, "%-14s %10.3f us/restart\n", "spawn", spawn_ms * 1e3 / n);
+	fprintf(stderr, "level arena %zu bytes, %s\n", state->level_arena.size,
+		state->level_arena.size == size ? "never grew" : "grew");
+}
+
+// BenchLoad : times n cold page cache loads of every sprite, with each stream backend
+void BenchLoad(struct state_t *state, s32 n)
+{
+	struct asset_container_t ac;
+	char *groups[GAMESCREEN_TOTAL];
+	s32 backends[] = { STREAM_NONE, STREAM_POOL, STREAM_URING };
+	s32 i, j, k, total;
+	f64 ms, best, sum;
+	u64 start;
+
+	assert(state);
+
+	for (i = 0; i < GAMESCREEN_TOTAL; i++) {
+		groups[i] = ScreenName(i);
+	}
+
+	LogFlush();
+
+	fprintf(stderr, "%-8s %8s %8s %10s %10s\n", "backend", "ran as", "assets", "best ms", "mean ms");
+
+	for (i = 0; i < ARRSIZE(backends); i++) {
+		best = sum = 0;
+		total = 0;
+
+		for (j = 0; j < n; j++) {
+			// no pak and no cache, every sprite is a png read off the disk and decoded
+			memset(&ac, 0, sizeof ac);
+			ac.stream = backends[i];
+
+			AssetManifestLoad(&ac, MANIFEST_DEFAULT_PATH, groups, GAMESCREEN_TOTAL, ASSET_CPU_PIXELS);
+
+			for (k = 0; k < ac.assets_len; k++) {
+				StreamEvict(ac.assets[k].path);
+			}
+
+			start = SDL_GetPerformanceCounter();
+
+			total = AssetLoadGroup(&ac, &state->jobs, ~0u);
+
+			// yield, instead of spinning, or the reads can't get a core on a small machine
+			while (AssetUploadPump(&ac) > 0) {
+				SDL_Delay(0);
+			}
+
+			ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+			best = j == 0 ? ms : MIN(best, ms);
+			sum += ms;
+
+			AssetsFree(&ac);
+		}
+
+		LogFlush();
+
+		fprintf(stderr, "%-8s %8s %8d %10.3f %10.3f\n", StreamBackendName(backends[i]),
+			StreamBackendName(backends[i] == STREAM_NONE ? STREAM_NONE : ac.streamed), total, best, sum / n);
+	}
+}
+
+// UpdatePlayer : updates the player
+void UpdatePlayer(struct state_t *state)
+{
+	struct player_t *player;
+	struct movement_t *movement;
+	struct io_t *io;
+
+	io = &state->io;
+	player = &state->player;
+	movement = &player->movement;
+
+	player->is_flying = 0;
+
+	// I know it says acceleration here, but just go with it for now, okay
+
+	// NOTE (brian) we should (maybe) make UpdateMovement work with this too...
+
+	player->movement.pv = 0.0;
+
+	if (player->is_dead) {
+		state->run = 0;
+		return;
+	}
+
+	if (io->keys[INPUT_KEY_D] == INSTATE_DOWN) {
+		player->movement.pv += ACCELERATION;
+	}
+
+	if (io->keys[INPUT_KEY_A] == INSTATE_DOWN) {
+		player->movement.pv -= ACCELERATION;
+	}
+
+	player->movement.pr += player->movement.pv;
+
+	if (io->keys[INPUT_KEY_W] == INSTATE_DOWN) {
+		// the clocwiseness of sdl is weird, but it checks out
+		player->movement.vx -= cos(player->movement.pr) * ACCELERATION;
+		player->movement.vy -= sin(player->movement.pr) * ACCELERATION;
+		player->is_flying = 1;
+	}
+
+	player->movement.px += player->movement.vx;
+	player->movement.py += player->movement.vy;
 
 	// create the bullet after we compute motion
 	if (io->keys[INPUT_KEY_SPACE] == INSTATE_PRESSED) {
@@ -495,17 +1310,29 @@ void UpdateAsteroids(struct state_t *state)
 	s32 i;
 	struct asteroid_t *asteroid;
 
-	for (i = 0; i < state->asteroids_len; i++) {
+	// see NOTE ENTITIES, the dead ones (from the collision checks) go away first
+	for (i = 0; i < state->asteroids_len;) {
 		asteroid = state->asteroids + i;
 
-		if (!asteroid->is_used)
-			continue;
+		if (asteroid->is_used) {
+			i++;
+		} else {
+			TraceEntity(&state->trace, state->ticks, TRACE_DESTROY, ENTITY_ASTEROID, asteroid->entity.id,
+				asteroid->movement.px, asteroid->movement.py);
+			C_REMOVE_SWAP(&state->asteroids, i);
+		}
+	}
+
+	for (i = 0; i < state->asteroids_len; i++) {
+		asteroid = state->asteroids + i;
 
 		UpdateMovement(&asteroid->movement);
 
 		WrapCoord(&asteroid->movement.px, 0, GAMERES_WIDTH);
 		WrapCoord(&asteroid->movement.py, 0, GAMERES_HEIGHT);
 	}
+
+	MetricSet(state->metrics.asteroids, state->asteroids_len);
 }
 
 // CreateBullet : creates a bullet at (px, py) with velocity (vx, vy)
@@ -513,8 +1340,13 @@ void CreateBullet(struct state_t *state, f32 px, f32 py, f32 vx, f32 vy)
 {
 	struct bullet_t *bullet;
 
-	bullet = &state->bullets[state->bullet_next++ % ARRSIZE(state->bullets)];
-	state->bullet_next %= ARRSIZE(state->bullets);
+	bullet = &state->bullets[state->bullet_next++ % state->bullets_len];
+	state->bullet_next %= state->bullets_len;
+
+	// the pool's full, the oldest one's getting reused (see NOTE ENTITIES)
+	if (bullet->is_used) {
+		MetricAdd(state->metrics.bullets_overflow, 1);
+	}
 
 	bullet->movement.px = px;
 	bullet->movement.py = py;
@@ -525,6 +1357,11 @@ void CreateBullet(struct state_t *state, f32 px, f32 py, f32 vx, f32 vy)
 				(bullet->movement.py + bullet->movement.vy));
 
 	bullet->is_used = 1;
+
+	bullet->entity.type = ENTITY_BULLET;
+	bullet->entity.id = ++state->next_id;
+
+	TraceEntity(&state->trace, state->ticks, TRACE_SPAWN, ENTITY_BULLET, bullet->entity.id, px, py);
 }
 
 // Point : makes a point
@@ -544,21 +1381,26 @@ f32 Distance(point p1, point p2)
 void UpdateBullets(struct state_t *state)
 {
 	struct bullet_t *bullet;
-	s32 i;
+	s32 i, live;
 
-	for (i = 0; i < ARRSIZE(state->bullets); i++) {
+	for (i = 0, live = 0; i < state->bullets_len; i++) {
 		bullet = state->bullets + i;
 
 		if (!bullet->is_used)
 			continue;
 
 		if (IsOOB(bullet->movement.px, bullet->movement.py, GAMERES_WIDTH, GAMERES_HEIGHT)) {
+			TraceEntity(&state->trace, state->ticks, TRACE_DESTROY, ENTITY_BULLET, bullet->entity.id,
+				bullet->movement.px, bullet->movement.py);
 			bullet->is_used = 0;
 			continue;
 		}
 
 		UpdateMovement(&state->bullets[i].movement);
+		live++;
 	}
+
+	MetricSet(state->metrics.bullets, live);
 }
 
 // UpdateMovement : updates the individual movement instance
@@ -576,28 +1418,39 @@ void UpdateMovement(struct movement_t *movement)
 // Render : the game render function
 void Render(struct state_t *state)
 {
-	// clear the screen
-	SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 0xff);
-	SDL_RenderClear(gRenderer);
+	// the Render* functions only record commands, nothing touches SDL until the flush below
+	RenderCmdReset(&state->rcmds);
 
 	switch (state->screen) {
 		case GAMESCREEN_TITLE:
 		{
+			PROF_BEGIN("RenderTitle");
 			RenderTitle(state);
+			PROF_END();
 			break;
 		}
 
 		case GAMESCREEN_PLAY:
 		{
+			PROF_BEGIN("RenderAsteroids");
 			RenderAsteroids(state);
+			PROF_END();
+
+			PROF_BEGIN("RenderPlayer");
 			RenderPlayer(state);
+			PROF_END();
+
+			PROF_BEGIN("RenderBullets");
 			RenderBullets(state);
+			PROF_END();
 			break;
 		}
 
 		case GAMESCREEN_CREDITS:
 		{
+			PROF_BEGIN("RenderCredits");
 			RenderCredits(state);
+			PROF_END();
 			break;
 		}
 
@@ -607,8 +1460,31 @@ void Render(struct state_t *state)
 		}
 	}
 
+	PROF_BEGIN("RenderCmdSort");
+	RenderCmdSort(&state->rcmds, &state->frame_arena);
+	PROF_END();
+
+	// clear the screen
+	PROF_BEGIN("RenderCmdExecute");
+	RenderClear(UtilMakeColor(0, 0, 0, 0xff));
+
+	RenderCmdExecute(&state->rcmds);
+
+	// debug overlays go on top of everything, in one batch
+	DD_FLUSH();
+	PROF_END();
+
+	// and the hud goes on top of those
+	if (state->hud.enabled) {
+		PROF_BEGIN("HudDraw");
+		HudDraw(&state->hud);
+		PROF_END();
+	}
+
 	// present the screen
-	SDL_RenderPresent(gRenderer);
+	PROF_BEGIN("RenderPresent");
+	RenderPresent();
+	PROF_END();
 }
 
 // RenderTitle : draws the title screen
@@ -618,6 +1494,7 @@ void RenderTitle(struct state_t *state)
 	s32 i;
 	s32 x, y;
 	SDL_Rect rect;
+	struct color_t mod;
 
 	i = 0;
 
@@ -635,12 +1512,12 @@ void RenderTitle(struct state_t *state)
 		rect.y = y;
 
 		if ((i - 1) == state->title_selection) {
-			SDL_SetTextureColorMod(assets[i]->texture, 0xff, 0x00, 0x00);
+			mod = UtilMakeColor(0xff, 0x00, 0x00, 0xff);
 		} else {
-			SDL_SetTextureColorMod(assets[i]->texture, 0xff, 0xff, 0xff);
+			mod = UtilMakeColor(0xff, 0xff, 0xff, 0xff);
 		}
 
-		SDL_RenderCopy(gRenderer, assets[i]->texture, NULL, &rect);
+		RenderCmdSprite(&state->rcmds, RLAYER_UI, assets[i], &rect, 0, mod);
 
 		y += assets[i]->h + 8;
 	}
@@ -657,7 +1534,37 @@ void RenderCredits(struct state_t *state)
 
 	assert(a_credits);
 
-	SDL_RenderCopy(gRenderer, a_credits->texture, NULL, NULL);
+	RenderCmdSprite(&state->rcmds, RLAYER_BACKGROUND, a_credits, NULL, 0, UtilMakeColor(0xff, 0xff, 0xff, 0xff));
+}
+
+// RenderLoading : draws (and presents) the loading bar
+void RenderLoading(struct state_t *state, s32 done, s32 total)
+{
+	SDL_Rect outline, rows[8];
+	struct color_t white;
+	s32 i;
+
+	assert(state);
+
+	white = UtilMakeColor(0xff, 0xff, 0xff, 0xff);
+
+	outline.w = GAMERES_WIDTH / 2;
+	outline.h = ARRSIZE(rows) + 4;
+	outline.x = (GAMERES_WIDTH - outline.w) / 2;
+	outline.y = (GAMERES_HEIGHT - outline.h) / 2;
+
+	// the fill is a stack of one pixel tall rects, so it's still just one draw
+	for (i = 0; i < ARRSIZE(rows); i++) {
+		rows[i].x = outline.x + 2;
+		rows[i].y = outline.y + 2 + i;
+		rows[i].w = (outline.w - 4) * done / MAX(total, 1);
+		rows[i].h = 1;
+	}
+
+	RenderClear(UtilMakeColor(0, 0, 0, 0xff));
+	RenderDrawRects(&outline, 1, white);
+	RenderDrawRects(rows, ARRSIZE(rows), white);
+	RenderPresent();
 }
 
 // RenderPlayer : renders the player to the screen
@@ -667,6 +1574,9 @@ void RenderPlayer(struct state_t *state)
 	struct asset_t *a_ship, *a_shipgun, *a_shipthruster;
 	SDL_Rect dst;
 	f32 degrotation;
+	struct color_t white;
+	point at[4], center;
+	s32 i, n;
 
 	assert(state);
 
@@ -682,36 +1592,47 @@ void RenderPlayer(struct state_t *state)
 	assert(a_shipthruster);
 
 	// gather the destination information FIRST
+	center = SpriteCenter(a_ship, &player->movement);
+
 	dst.w = a_ship->w;
 	dst.h = a_ship->h;
-	dst.x = player->movement.px - dst.w / 2;
-	dst.y = player->movement.py - dst.h / 2;
+	dst.x = center.x - dst.w / 2;
+	dst.y = center.y - dst.h / 2;
 
-	SDL_SetRenderDrawColor(gRenderer, 0, 0, 0xff, 0xff);
-	SDL_RenderDrawRect(gRenderer, &dst);
+	DD_RECT(&dst, DDCOLOR_BLUE);
+	if (a_ship->mask)
+		DD_CIRCLE(center.x, center.y, a_ship->mask->radius, DDCOLOR_BLUE);
+	DD_LINE(player->movement.px, player->movement.py,
+		player->movement.px + player->movement.vx * 8, player->movement.py + player->movement.vy * 8, DDCOLOR_YELLOW);
 
-	degrotation = ((player->movement.pr - M_PI / 2) * 180 / M_PI);
+	degrotation = SpriteAngle(&player->movement) * 180 / M_PI;
+	white = UtilMakeColor(0xff, 0xff, 0xff, 0xff);
 
-	// then, draw all of the pieces
-	SDL_RenderCopyEx(gRenderer, a_ship->texture, NULL, &dst, degrotation, NULL, SDL_FLIP_NONE);
+	// then, draw all of the pieces, everywhere the ship shows up
+	n = WrapVisible(center.x, center.y, dst.w, dst.h, 1, at);
 
-	if (player->has_fired) {
-		SDL_RenderCopyEx(gRenderer, a_shipgun->texture, NULL, &dst, degrotation, NULL, SDL_FLIP_NONE);
-	}
+	for (i = 0; i < n; i++) {
+		dst.x = at[i].x - dst.w / 2;
+		dst.y = at[i].y - dst.h / 2;
+
+		RenderCmdSprite(&state->rcmds, RLAYER_PLAYER, a_ship, &dst, degrotation, white);
+
+		if (player->has_fired) {
+			RenderCmdSprite(&state->rcmds, RLAYER_PLAYER, a_shipgun, &dst, degrotation, white);
+		}
 
-	if (player->is_flying) {
-		SDL_RenderCopyEx(gRenderer, a_shipthruster->texture, NULL, &dst, degrotation, NULL, SDL_FLIP_NONE);
+		if (player->is_flying) {
+			RenderCmdSprite(&state->rcmds, RLAYER_PLAYER, a_shipthruster, &dst, degrotation, white);
+		}
 	}
 }
 
 // RenderAsteroids : renders all of the asteroids
 void RenderAsteroids(struct state_t *state)
 {
-	s32 i;
-	struct asteroid_t *asteroid;
+	struct rchunk_t *chunk;
 	struct asset_t *a_asteroid;
-	SDL_Rect dst;
-	f32 degrotation;
+	s32 i, n, size;
 
 	assert(state);
 
@@ -720,7 +1641,58 @@ void RenderAsteroids(struct state_t *state)
 
 	assert(a_asteroid);
 
-	for (i = 0; i < state->asteroids_len; i++) {
+	n = (state->asteroids_len + RENDER_CHUNK - 1) / RENDER_CHUNK;
+
+	// NOTE (Brian) the debug draw queues are global, so with those on, everything records right here
+	if (n < 2 || state->jobs.threads_len == 0 || state->rgroup.done == NULL || DD_ENABLED()) {
+		RenderAsteroidRange(state, &state->rcmds, a_asteroid, 0, state->asteroids_len);
+		return;
+	}
+
+	n = MIN(n, RENDER_CHUNKS_MAX);
+	size = (state->asteroids_len + n - 1) / n;
+
+	for (i = 0; i < n; i++) {
+		chunk = state->rchunks + i;
+
+		chunk->state = state;
+		chunk->asset = a_asteroid;
+		chunk->i0 = i * size;
+		chunk->i1 = MIN(state->asteroids_len, chunk->i0 + size);
+
+		JobSubmitGroup(&state->jobs, &state->rgroup, RenderAsteroidJob, chunk);
+	}
+
+	JobWaitGroup(&state->jobs, &state->rgroup);
+
+	// in order, so the frame is the same as the one the main thread would've recorded
+	for (i = 0; i < n; i++) {
+		RenderCmdAppend(&state->rcmds, &state->rchunks[i].cmds);
+	}
+}
+
+// RenderAsteroidJob : (worker) records one rchunk_t
+void RenderAsteroidJob(void *arg, s32 worker)
+{
+	struct rchunk_t *chunk;
+
+	chunk = arg;
+
+	PROF_BEGIN("RenderAsteroidJob");
+	RenderAsteroidRange(chunk->state, &chunk->cmds, chunk->asset, chunk->i0, chunk->i1);
+	PROF_END();
+}
+
+// RenderAsteroidRange : records the asteroids in [i0, i1) into cmds
+void RenderAsteroidRange(struct state_t *state, struct rcmdbuf_t *cmds, struct asset_t *a_asteroid, s32 i0, s32 i1)
+{
+	s32 i, j, n;
+	struct asteroid_t *asteroid;
+	SDL_Rect dst;
+	f32 degrotation;
+	point at[4], center;
+
+	for (i = i0; i < i1; i++) {
 
 		asteroid = state->asteroids + i;
 
@@ -728,18 +1700,29 @@ void RenderAsteroids(struct state_t *state)
 			continue;
 
 		// gather the destination information FIRST
+		center = SpriteCenter(a_asteroid, &asteroid->movement);
+
 		dst.w = a_asteroid->w;
 		dst.h = a_asteroid->h;
-		dst.x = asteroid->movement.px - dst.w / 2;
-		dst.y = asteroid->movement.py - dst.h / 2;
+		dst.x = center.x - dst.w / 2;
+		dst.y = center.y - dst.h / 2;
 
-		SDL_SetRenderDrawColor(gRenderer, 0xff, 0, 0, 0xff);
-		SDL_RenderDrawRect(gRenderer, &dst);
+		degrotation = SpriteAngle(&asteroid->movement) * 180 / M_PI;
 
-		degrotation = ((asteroid->movement.pr - M_PI / 2) * 180 / M_PI);
+		// then, draw all of the pieces (if it's on screen, twice if it's across the seam)
+		n = WrapVisible(center.x, center.y, dst.w, dst.h, 1, at);
 
-		// then, draw all of the pieces
-		SDL_RenderCopyEx(gRenderer, a_asteroid->texture, NULL, &dst, degrotation, NULL, SDL_FLIP_NONE);
+		for (j = 0; j < n; j++) {
+			dst.x = at[j].x - dst.w / 2;
+			dst.y = at[j].y - dst.h / 2;
+			RenderCmdSprite(cmds, RLAYER_ASTEROID, a_asteroid, &dst, degrotation, UtilMakeColor(0xff, 0xff, 0xff, 0xff));
+
+			// the debug shapes go on every copy that's drawn, and only those
+			DD_RECT(&dst, DDCOLOR_RED);
+			if (a_asteroid->mask)
+				DD_CIRCLE(at[j].x, at[j].y, a_asteroid->mask->radius, DDCOLOR_RED);
+			DD_LINE(at[j].x, at[j].y, at[j].x + asteroid->movement.vx * 8, at[j].y + asteroid->movement.vy * 8, DDCOLOR_YELLOW);
+		}
 	}
 }
 
@@ -751,6 +1734,7 @@ void RenderBullets(struct state_t *state)
 	struct asset_t *a_bullet;
 	SDL_Rect dst;
 	f32 degrotation;
+	point at[4], center;
 
 	assert(state);
 
@@ -759,7 +1743,7 @@ void RenderBullets(struct state_t *state)
 
 	assert(a_bullet);
 
-	for (i = 0; i < ARRSIZE(state->bullets); i++) {
+	for (i = 0; i < state->bullets_len; i++) {
 
 		bullet = state->bullets + i;
 
@@ -767,70 +1751,316 @@ void RenderBullets(struct state_t *state)
 			continue;
 
 		// gather the destination information FIRST
+		center = SpriteCenter(a_bullet, &bullet->movement);
+
 		dst.w = a_bullet->w;
 		dst.h = a_bullet->h;
-		dst.x = bullet->movement.px - dst.w / 2;
-		dst.y = bullet->movement.py - dst.h / 2;
+		dst.x = center.x - dst.w / 2;
+		dst.y = center.y - dst.h / 2;
+
+		// bullets don't wrap, they just go away, so this is only a cull
+		if (!WrapVisible(center.x, center.y, dst.w, dst.h, 0, at))
+			continue;
 
-		SDL_SetRenderDrawColor(gRenderer, 0, 0xff, 0, 0xff);
-		SDL_RenderDrawRect(gRenderer, &dst);
+		DD_RECT(&dst, DDCOLOR_GREEN);
 
-		degrotation = ((bullet->movement.pr - M_PI / 2) * 180 / M_PI);
+		degrotation = SpriteAngle(&bullet->movement) * 180 / M_PI;
 
 		// then, draw all of the pieces
-		SDL_RenderCopyEx(gRenderer, a_bullet->texture, NULL, &dst, degrotation, NULL, SDL_FLIP_NONE);
+		RenderCmdSprite(&state->rcmds, RLAYER_BULLET, a_bullet, &dst, degrotation, UtilMakeColor(0xff, 0xff, 0xff, 0xff));
 	}
 }
 
 // Delay : conditional delay, as needed
 void Delay(struct state_t *state)
 {
+	// nobody's watching a headless run, so go as fast as we can
+	if (state->headless)
+		return;
+
 	SDL_Delay(16); // NOTE (Brian) TEMPORARY!!
 }
 
+// ParseArgs : reads the command line into the state
+s32 ParseArgs(struct state_t *state, int argc, char **argv)
+{
+	s32 i, streamset, seedset;
+
+	assert(state);
+
+	streamset = 0;
+	seedset = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (streq(argv[i], "-headless")) {
+			state->headless = 1;
+		} else if (streq(argv[i], "-software")) {
+			state->software = 1;
+		} else if (streq(argv[i], "-bilinear")) {
+			state->filter = SWFILTER_BILINEAR;
+		} else if (streq(argv[i], "-frames") && i + 1 < argc) {
+			state->max_frames = c_atoi(argv[++i]);
+		} else if (streq(argv[i], "-dump") && i + 1 < argc) {
+			state->dumpdir = argv[++i];
+		} else if (streq(argv[i], "-seed") && i + 1 < argc) {
+			state->seed = c_atoi(argv[++i]);
+			seedset = 1;
+		} else if (streq(argv[i], "-record") && i + 1 < argc) {
+			state->record = argv[++i];
+		} else if (streq(argv[i], "-replay") && i + 1 < argc) {
+			state->replay = argv[++i];
+		} else if (streq(argv[i], "-pak") && i + 1 < argc) {
+			state->pakpath = argv[++i];
+		} else if (streq(argv[i], "-nopak")) {
+			state->nopak = 1;
+		} else if (streq(argv[i], "-cache") && i + 1 < argc) {
+			state->cachedir = argv[++i];
+		} else if (streq(argv[i], "-nocache")) {
+			state->nocache = 1;
+		} else if (streq(argv[i], "-asset-budget") && i + 1 < argc) {
+			state->asset_budget = (size_t)c_atoi(argv[++i]) * 1024;
+		} else if (streq(argv[i], "-hotreload")) {
+			state->hotreload = 1;
+		} else if (streq(argv[i], "-memreport")) {
+			state->memreport = 1;
+		} else if (streq(argv[i], "-startup")) {
+			state->startupreport = 1;
+		} else if (streq(argv[i], "-scratch")) {
+			state->scratchreport = 1;
+		} else if (streq(argv[i], "-counters")) {
+			state->counters = 1;
+		} else if (streq(argv[i], "-hud")) {
+			state->showhud = 1;
+		} else if (streq(argv[i], "-heap")) {
+			state->heapreport = 1;
+		} else if (streq(argv[i], "-alloc-budget") && i + 1 < argc) {
+			state->alloc_budget = c_atoi(argv[++i]);
+		} else if (streq(argv[i], "-hugepages")) {
+			state->hugepages = 1;
+		} else if (streq(argv[i], "-trace") && i + 1 < argc) {
+			state->tracepath = argv[++i];
+		} else if (streq(argv[i], "-profile") && i + 1 < argc) {
+			state->profpath = argv[++i];
+		} else if (streq(argv[i], "-profile-seconds") && i + 1 < argc) {
+			state->profile_seconds = atof(argv[++i]);
+		} else if (streq(argv[i], "-metrics") && i + 1 < argc) {
+			state->metricspath = argv[++i];
+		} else if (streq(argv[i], "-metrics-interval") && i + 1 < argc) {
+			state->metrics_interval = atof(argv[++i]);
+		} else if (streq(argv[i], "-bench-collide") && i + 1 < argc) {
+			state->bench_collide = c_atoi(argv[++i]);
+		} else if (streq(argv[i], "-bench-load") && i + 1 < argc) {
+			state->bench_load = c_atoi(argv[++i]);
+		} else if (streq(argv[i], "-bench-restart") && i + 1 < argc) {
+			state->bench_restart = c_atoi(argv[++i]);
+		} else if (streq(argv[i], "-asteroids") && i + 1 < argc) {
+			state->wave_asteroids = c_atoi(argv[++i]);
+		} else if (streq(argv[i], "-stream") && i + 1 < argc) {
+			state->stream = StreamBackendFromName(argv[++i]);
+			if (state->stream < 0) {
+				ERR("Unknown stream backend '%s' (none, auto, uring, pool)\n", argv[i]);
+				return -1;
+			}
+			streamset = 1;
+		} else if (streq(argv[i], "-golden") && i + 1 < argc) {
+			state->golden_dir = argv[++i];
+		} else if (streq(argv[i], "-golden-ticks") && i + 1 < argc) {
+			state->golden_ticks = argv[++i];
+		} else if (streq(argv[i], "-golden-tolerance") && i + 1 < argc) {
+			state->golden_tolerance = c_atoi(argv[++i]);
+		} else if (streq(argv[i], "-golden-update")) {
+			state->golden_update = 1;
+		} else {
+			ERR("Unknown argument '%s'\n", argv[i]);
+			fprintf(stderr, "USAGE: %s [-headless] [-software] [-bilinear] [-frames n] [-dump dir]\n"
+				"    [-seed n] [-record file] [-replay file] [-pak file] [-nopak]\n"
+				"    [-cache dir] [-nocache] [-memreport] [-hotreload] [-bench-collide n]\n"
+				"    [-asset-budget kb] [-startup] [-scratch] [-stream none|auto|uring|pool] [-bench-load n]\n"
+				"    [-asteroids n] [-bench-restart n] [-counters] [-hud] [-hugepages] [-trace file]\n"
+				"    [-profile file] [-profile-seconds n] [-metrics file] [-metrics-interval n]\n"
+				"    [-heap] [-alloc-budget n]\n"
+				"    [-golden dir] [-golden-ticks t1,t2,...] [-golden-tolerance n] [-golden-update]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	if (state->pakpath == NULL) {
+		state->pakpath = PAK_DEFAULT_PATH;
+	}
+
+	if (state->cachedir == NULL) {
+		state->cachedir = CACHE_DEFAULT_DIR;
+	}
+
+	if (!streamset) {
+		state->stream = STREAM_AUTO;
+	}
+
+	// the benchmarks don't need to show anything
+	if (state->bench_collide || state->bench_load || state->bench_restart) {
+		state->headless = 1;
+	}
+
+	// golden checks only make sense on the (deterministic) software renderer
+	if (state->golden_dir) {
+		state->headless = 1;
+		if (state->golden_ticks == NULL) {
+			state->golden_ticks = GOLDEN_DEFAULT_TICKS;
+		}
+
+		// a seed from the clock would make frames nobody can render again
+		if (!seedset) {
+			state->seed = GOLDEN_DEFAULT_SEED;
+			LOG("no -seed, golden frames use seed %u\n", state->seed);
+		}
+	}
+
+	return 0;
+}
+
 // Init : Initializes the Game State
 s32 Init(struct state_t *state)
 {
+	struct rbackend_t backend;
+	u32 sdlflags;
 	s32 rc;
 
 	assert(state);
 
-	memset(state, 0, sizeof(*state));
+	// setup SDL before we do anything, but only the parts this run needs (see startup.h), headless
+	// runs just need events for the input replay
+	StartupBegin(&state->startup, "sdl");
 
-	// setup SDL before we do anything
-	if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
-		ERR("Couldn't initialize SDL: %s\n", SDL_GetError());
+	sdlflags = state->headless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO;
+
+	if (StartupSubsystem(sdlflags) < 0) {
 		return 1;
 	}
 
-	u32 flags;
+	StartupEnd(&state->startup);
+
+	if (!state->headless) {
+		u32 flags;
 
-	flags = SDL_WINDOW_OPENGL|SDL_WINDOW_SHOWN|SDL_WINDOW_RESIZABLE;
+		StartupBegin(&state->startup, "window");
 
-	rc = SDL_CreateWindowAndRenderer(SCREEN_WIDTH, SCREEN_HEIGHT, flags, &gWindow, &gRenderer);
-	if (rc < 0) { // error
-		ERR("Couldn't Create Window or Renderer: %s\n", SDL_GetError());
+		flags = SDL_WINDOW_OPENGL|SDL_WINDOW_SHOWN|SDL_WINDOW_RESIZABLE;
+
+		gWindow = SDL_CreateWindow(WINDOW_NAME, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+			SCREEN_WIDTH, SCREEN_HEIGHT, flags);
+		if (gWindow == NULL) {
+			ERR("Couldn't Create Window: %s\n", SDL_GetError());
+			return -1;
+		}
+
+		StartupEnd(&state->startup);
+
+		StartupBegin(&state->startup, "renderer");
+
+		gRenderer = SDL_CreateRenderer(gWindow, -1, 0);
+		if (gRenderer == NULL) {
+			ERR("Couldn't Create Renderer: %s\n", SDL_GetError());
+			return -1;
+		}
+
+		rc = SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_BLEND);
+		if (rc < 0) {
+			ERR("Couldn't set render blend mode: %s\n", SDL_GetError());
+			return -1;
+		}
+
+		rc = SDL_RenderSetLogicalSize(gRenderer, GAMERES_WIDTH, GAMERES_HEIGHT);
+		if (rc < 0) {
+			ERR("Couldn't set renderer logical size: %s\n", SDL_GetError());
+			return -1;
+		}
+
+		StartupEnd(&state->startup);
+	}
+
+	StartupBegin(&state->startup, "job pool");
+
+	if (JobPoolInit(&state->jobs, 0) < 0) {
+		ERR("Couldn't start the job pool, running everything on the main thread\n");
+	}
+
+	// without it, RenderAsteroids just records everything on the main thread
+	JobGroupInit(&state->rgroup);
+
+	ArenaInit(&state->frame_arena, "frame", MEM_SCRATCH, FRAME_ARENA_BYTES, 0);
+
+	if (state->counters && PerfCtrOpen(&state->update_ctr) == 0) {
+		state->counters = 0;
+	}
+
+	StartupEnd(&state->startup);
+
+	// pick a render backend
+	StartupBegin(&state->startup, "render backend");
+
+	if (state->headless || state->software) {
+		rc = SWRenderInit(&state->swrender, GAMERES_WIDTH, GAMERES_HEIGHT, &state->jobs, gRenderer);
+		if (rc < 0) {
+			ERR("Couldn't setup the software renderer\n");
+			return -1;
+		}
+
+		state->swrender.filter = state->filter;
+		state->swrender.dumpdir = state->dumpdir;
+
+		SWRenderBackend(&backend, &state->swrender);
+	} else {
+		RenderBackendSDL(&backend, gRenderer);
+	}
+
+	RenderSetBackend(&backend);
+
+	StartupEnd(&state->startup);
+
+	if (state->record && InputRecordOpen(&state->io, state->record) < 0) {
 		return -1;
 	}
 
-	SDL_SetWindowTitle(gWindow, WINDOW_NAME);
+	if (state->replay && InputReplayOpen(&state->io, state->replay) < 0) {
+		return -1;
+	}
 
-	rc = SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_BLEND);
-	if (rc < 0) {
-		ERR("Couldn't set render blend mode: %s\n", SDL_GetError());
+	if (state->tracepath && TraceOpen(&state->trace, state->tracepath) < 0) {
 		return -1;
 	}
 
-	rc = SDL_RenderSetLogicalSize(gRenderer, GAMERES_WIDTH, GAMERES_HEIGHT);
-	if (rc < 0) {
-		ERR("Couldn't set renderer logical size: %s\n", SDL_GetError());
+	if (InitMetrics(state) < 0) {
 		return -1;
 	}
 
-	InitAssets(state);
+	state->hud.enabled = state->showhud;
 
-	InitPlayer(state);
-	InitAsteroids(state);
+	if (state->golden_dir) {
+		rc = GoldenInit(&state->golden, state->golden_dir, state->golden_ticks,
+			state->golden_tolerance, state->golden_update);
+		if (rc < 0) {
+			return -1;
+		}
+
+		if (state->max_frames == 0) {
+			state->max_frames = GoldenLastTick(&state->golden) + 1;
+		}
+	}
+
+	StartupBegin(&state->startup, "assets");
+	rc = InitAssets(state);
+	StartupEnd(&state->startup);
+
+	if (rc < 0) {
+		return -1;
+	}
+
+	StartupBegin(&state->startup, "entities");
+	ArenaInit(&state->level_arena, "level", MEM_ENTITY, 0, state->hugepages ? ARENA_HUGEPAGES : 0);
+	if (InitLevel(state) < 0) {
+		return -1;
+	}
+	StartupEnd(&state->startup);
 
 	state->run = 1;
 
@@ -841,55 +2071,211 @@ s32 Init(struct state_t *state)
 s32 InitAssets(struct state_t *state)
 {
 	struct asset_container_t *ac;
+	struct assetmem_t mem;
+	s32 i, total, left;
+	u32 flags;
+	u64 start;
+
+	char *groups[GAMESCREEN_TOTAL];
 
 	assert(state);
 
 	ac = &state->asset_container;
 
-	// load all of the ship assets
-	AssetLoad(ac, "assets/sprites/ship.png");
-	AssetLoad(ac, "assets/sprites/shipguns.png");
-	AssetLoad(ac, "assets/sprites/shipthruster.png");
+	start = SDL_GetPerformanceCounter();
 
-	// load the ship projectile
-	AssetLoad(ac, "assets/sprites/bullet.png");
+	StartupBegin(&state->startup, "pak");
 
-	// load the asteroids
-	AssetLoad(ac, "assets/sprites/asteroid.png");
+	if (!state->nopak) {
+		if (PakOpen(&state->pak, state->pakpath) == 0) {
+			LOG("using '%s' (%u entries)\n", state->pakpath, state->pak.count);
+			ac->pak = &state->pak;
+		} else {
+			LOG("no pak at '%s', loading loose files\n", state->pakpath);
+		}
+	}
+
+	StartupEnd(&state->startup);
+
+	if (!state->nocache) {
+		ac->cachedir = state->cachedir;
+	}
+
+	ac->stream = state->stream;
+
+	// the software renderer draws straight out of the pixels, so it needs them kept around
+	flags = (state->headless || state->software) ? ASSET_CPU_PIXELS : 0;
+
+	ac->budget = state->asset_budget;
+
+	StartupBegin(&state->startup, "manifest");
+
+	// the manifest names groups after the screens that use them
+	for (i = 0; i < GAMESCREEN_TOTAL; i++) {
+		groups[i] = ScreenName(i);
+	}
 
-	// load in the menu assets
-	AssetLoad(ac, "assets/sprites/menu_title.png");
-	AssetLoad(ac, "assets/sprites/menu_play.png");
-	AssetLoad(ac, "assets/sprites/menu_credits.png");
-	AssetLoad(ac, "assets/sprites/menu_quit.png");
+	if (AssetManifestLoad(ac, MANIFEST_DEFAULT_PATH, groups, GAMESCREEN_TOTAL, flags) <= 0) {
+		ERR("No assets in '%s'\n", MANIFEST_DEFAULT_PATH);
+		StartupEnd(&state->startup);
+		return -1;
+	}
+
+	StartupEnd(&state->startup);
+
+	StartupBegin(&state->startup, "first screen");
+
+	// we only wait on the first screen, the pngs get decoded on the job pool, and the textures get
+	// made here as they come in
+	total = AssetLoadGroup(ac, &state->jobs, ASSET_GROUP(GAMESCREEN_TITLE));
+
+	while ((left = AssetUploadPump(ac)) > 0) {
+		if (!state->headless) {
+			SDL_PumpEvents();
+			RenderLoading(state, total - left, total);
+		}
+
+		SDL_Delay(1);
+	}
+
+	// the decodes overlap on the pool, so these add up to more than the phase they're in
+	for (i = 0; i < ac->assets_len; i++) {
+		if (ac->assets[i].state == ASSET_READY) {
+			StartupAdd(&state->startup, ac->assets[i].name, ac->assets[i].decode_ms + ac->assets[i].upload_ms);
+		}
+	}
 
-	// load in the credits resources
-	AssetLoad(ac, "assets/sprites/credits.png");
+	StartupEnd(&state->startup);
+
+	// all cache hits is a warm start, anything else is (at least partly) cold
+	LOG("loaded %d assets in %.3f ms, %s start (%d cached, %d decoded, %d workers)\n", total,
+		(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency(),
+		ac->cache_misses == 0 && ac->cache_hits > 0 ? "warm" : "cold",
+		ac->cache_hits, ac->cache_misses, state->jobs.threads_len);
+
+	// then get started on whatever's probably next, in the background
+	PreloadAssets(state);
+
+	if (state->hotreload) {
+		AssetWatch(ac, &state->jobs, "assets/sprites");
+	}
+
+	if (state->memreport) {
+		LogFlush();
+		AssetsReport(ac, stderr);
+	} else {
+		mem = AssetsMemory(ac);
+		LOG("assets resident: %zu cpu bytes, %zu gpu bytes\n", mem.cpu, mem.gpu);
+	}
 
 	return 0;
 }
 
-// InitPlayer : initializes the player
-s32 InitPlayer(struct state_t *state)
+// PreloadAssets : loads the current screen's assets, and starts on the next likely screen's
+void PreloadAssets(struct state_t *state)
 {
-	struct player_t *player;
+	u32 groups;
 
-	player = &state->player;
+	assert(state);
 
-	memset(player, 0, sizeof(*player));
+	groups = ASSET_GROUP(state->screen);
 
-	player->movement.px = GAMERES_WIDTH / 2;
-	player->movement.py = GAMERES_HEIGHT / 2;
+	switch (state->screen) {
+		case GAMESCREEN_TITLE:
+			// whatever the cursor is on is where we're (probably) headed
+			if (state->title_selection == TITLEENTRY_CREDITS) {
+				groups |= ASSET_GROUP(GAMESCREEN_CREDITS);
+			} else {
+				groups |= ASSET_GROUP(GAMESCREEN_PLAY);
+			}
+			break;
 
-	player->movement.vx = 0.0;
-	player->movement.vy = 0.0;
+		case GAMESCREEN_PLAY:
+		case GAMESCREEN_CREDITS:
+			groups |= ASSET_GROUP(GAMESCREEN_TITLE);
+			break;
+	}
 
-	player->movement.ax = 0.0;
-	player->movement.ay = 0.0;
+	AssetLoadGroup(&state->asset_container, &state->jobs, groups);
+}
 
-	player->movement.pr = M_PI / 2; // face upwards
-	player->movement.pv = 0.0;
-	player->movement.pa = 0.0;
+// InitLevel : starts the level over (the pools, the player, and the asteroids)
+s32 InitLevel(struct state_t *state)
+{
+	assert(state);
+
+	if (ResetLevel(state) < 0)
+		return -1;
+
+	InitPlayer(state);
+	InitAsteroids(state);
+
+	return 0;
+}
+
+// ResetLevel : rewinds the level arena, and carves the current wave's entity pools out of it
+s32 ResetLevel(struct state_t *state)
+{
+	struct wave_t wave;
+	size_t bytes;
+
+	assert(state);
+
+	wave = LevelWave(state);
+
+	bytes = sizeof(*state->asteroids) * wave.asteroids + ARENA_ALIGN;
+	bytes += sizeof(*state->bullets) * wave.bullets + ARENA_ALIGN;
+
+	// this only grows the first time, or for a bigger wave than we've seen
+	ArenaReset(&state->level_arena);
+
+	if (ArenaReserve(&state->level_arena, bytes) < 0)
+		return -1;
+
+	state->asteroids = ARENA_ARRAY(&state->level_arena, struct asteroid_t, wave.asteroids);
+	state->asteroids_len = 0;
+	state->asteroids_cap = wave.asteroids;
+
+	state->bullets = ArenaAllocZero(&state->level_arena, sizeof(*state->bullets) * wave.bullets);
+	state->bullets_len = wave.bullets;
+	state->bullet_next = 0;
+
+	MetricSet(state->metrics.bullets_pool, wave.bullets);
+
+	return 0;
+}
+
+// LevelWave : the current wave, with any overrides from the command line
+struct wave_t LevelWave(struct state_t *state)
+{
+	struct wave_t wave;
+
+	assert(state);
+
+	wave = gWaves[ClampInt(state->wave, 0, ARRSIZE(gWaves) - 1)];
+
+	if (state->wave_asteroids > 0) {
+		wave.asteroids = state->wave_asteroids;
+	}
+
+	return wave;
+}
+
+// InitPlayer : initializes the player
+s32 InitPlayer(struct state_t *state)
+{
+	static const struct player_t start = {
+		.entity = { ENTITY_PLAYER, 0 },
+		.movement = {
+			.px = GAMERES_WIDTH / 2,
+			.py = GAMERES_HEIGHT / 2,
+			.pr = M_PI / 2, // face upwards
+		},
+	};
+
+	state->player = start;
+
+	TraceEntity(&state->trace, state->ticks, TRACE_SPAWN, ENTITY_PLAYER, 0, start.movement.px, start.movement.py);
 
 	return 0;
 }
@@ -900,14 +2286,12 @@ s32 InitAsteroids(struct state_t *state)
 	struct asteroid_t *asteroid;
 	s32 i, n;
 
-	free(state->asteroids);
-	state->asteroids_len = state->asteroids_cap = 0;
-	state->asteroids = NULL;
+	n = (s32)state->asteroids_cap;
 
-	for (i = 0, n = 4; i < n; i++) {
-		C_RESIZE(&state->asteroids);
+	for (i = 0; i < n; i++) {
+		asteroid = state->asteroids + state->asteroids_len++;
 
-		asteroid = state->asteroids + i;
+		memset(asteroid, 0, sizeof(*asteroid));
 
 		asteroid->is_used = 1;
 
@@ -919,7 +2303,11 @@ s32 InitAsteroids(struct state_t *state)
 		asteroid->movement.pr = RandFloat(-ACCELERATION, ACCELERATION);
 		asteroid->movement.pv = ACCELERATION * RandFloat(-1.0, 1.0);
 
-		state->asteroids_len++;
+		asteroid->entity.type = ENTITY_ASTEROID;
+		asteroid->entity.id = ++state->next_id;
+
+		TraceEntity(&state->trace, state->ticks, TRACE_SPAWN, ENTITY_ASTEROID, asteroid->entity.id,
+			asteroid->movement.px, asteroid->movement.py);
 	}
 
 	return 0;
@@ -928,10 +2316,74 @@ s32 InitAsteroids(struct state_t *state)
 // Close : closes the application
 s32 Close(struct state_t *state)
 {
+	s32 i;
+
 	assert(state);
 
+	if (state->profpath) {
+		ProfDump(state->profpath, state->profile_seconds);
+	}
+
 	AssetsFree(&state->asset_container);
 
+	if (state->pak.base)
+		PakClose(&state->pak);
+
+	RenderCmdFree(&state->rcmds);
+
+	for (i = 0; i < RENDER_CHUNKS_MAX; i++) {
+		RenderCmdFree(&state->rchunks[i].cmds);
+	}
+
+	DD_FREE();
+
+	HudFree(&state->hud);
+
+	if (state->swrender.pixels) {
+		if (state->swrender.frame) {
+			LOG("software renderer: %u frames, %.3f ms per frame\n",
+				state->swrender.frame, state->swrender.total_ms / state->swrender.frame);
+		}
+
+		SWRenderFree(&state->swrender);
+	}
+
+	if (state->ticks) {
+		LOG("frame scratch: %zu bytes peak, %.0f bytes mean, the frame arena grew to %zu bytes\n",
+			state->scratch_peak, state->scratch_sum / state->ticks, state->frame_arena.size);
+		LOG("frame heap: %llu allocations peak\n", state->heap_peak);
+	}
+
+	if (state->counters) {
+		LogFlush();
+		PerfCtrReport(&state->update_ctr, "Update, per tick", stderr);
+		PerfCtrClose(&state->update_ctr);
+	}
+
+	ArenaFree(&state->frame_arena);
+	ArenaFree(&state->level_arena);
+
+	JobPoolFree(&state->jobs);
+
+	JobGroupFree(&state->rgroup);
+
+	// the workers are gone, nothing's recording into their rings anymore
+	ProfFree();
+
+	TraceClose(&state->trace);
+
+	// the last partial interval
+	if (state->metrics_fp) {
+		SnapshotMetrics(state, 1);
+		fclose(state->metrics_fp);
+	}
+
+	MetricsFree();
+
+	InputClose(&state->io);
+
+	GoldenFree(&state->golden);
+
 	if (gRenderer)
 		SDL_DestroyRenderer(gRenderer);
 
@@ -940,14 +2392,13 @@ s32 Close(struct state_t *state)
 
 	SDL_Quit();
 
-	return 0;
-}
+	// everything's been freed, so the live bytes are what's going to be reported as leaks
+	if (state->heapreport) {
+		LogFlush();
+		c_memreport();
+	}
 
-// UtilMakeColor : returns a color
-struct color_t UtilMakeColor(u8 r, u8 g, u8 b, u8 a)
-{
-	struct color_t c = { r, g, b, a };
-	return c;
+	return 0;
 }
 
 // RandInt : returns a random int in [min, max]
@@ -970,7 +2421,7 @@ void WrapCoord(f32 *coord, f32 min, f32 max)
 {
 	f32 overhang;
 
-	overhang = max * 0.02;
+	overhang = max * WRAP_OVERHANG;
 
 	if (*coord > max + overhang) {
 		*coord = min - overhang;
@@ -982,6 +2433,57 @@ void WrapCoord(f32 *coord, f32 min, f32 max)
 
 }
 
+// WrapVisible : culls a w x h sprite centered at (px, py), returns where to draw it (0 - 4 places)
+s32 WrapVisible(f32 px, f32 py, f32 w, f32 h, s32 wraps, point *out)
+{
+	f32 xs[2], ys[2], r;
+	s32 nx, ny, i, j, n;
+
+	assert(out);
+
+	// NOTE (Brian) sprites get rotated, so use the circle that covers every rotation. It's a
+	// little generous at the corners, but it's way cheaper than rotating the rect.
+	r = sqrt(w * w + h * h) / 2;
+
+	nx = WrapVisibleAxis(px, r, GAMERES_WIDTH, wraps, xs);
+	ny = WrapVisibleAxis(py, r, GAMERES_HEIGHT, wraps, ys);
+
+	for (i = 0, n = 0; i < nx; i++) {
+		for (j = 0; j < ny; j++) {
+			out[n++] = Point(xs[i], ys[j]);
+		}
+	}
+
+	return n;
+}
+
+// WrapVisibleAxis : WrapVisible, for just one axis
+s32 WrapVisibleAxis(f32 c, f32 r, f32 max, s32 wraps, f32 *out)
+{
+	f32 period;
+	s32 n;
+
+	n = 0;
+
+	if (0 < c + r && c - r < max) {
+		out[n++] = c;
+	}
+
+	// WrapCoord's world is one overhang bigger on each side than the screen, so anything hanging
+	// over that seam has to show up a period away, on the opposite side
+	if (wraps) {
+		period = max + 2 * max * WRAP_OVERHANG;
+
+		if (0 < c - period + r) {
+			out[n++] = c - period;
+		} else if (c + period - r < max) {
+			out[n++] = c + period;
+		}
+	}
+
+	return n;
+}
+
 // IsOOB : is out of bounds?
 s32 IsOOB(f32 cx, f32 cy, f32 w, f32 h)
 {
@@ -1000,3 +2502,14 @@ s32 ClampInt(s32 curr, s32 min, s32 max)
 	return curr;
 }
 
+
+// ScreenName : returns a printable name for a GAMESCREEN_* value
+char *ScreenName(s32 screen)
+{
+	switch (screen) {
+		case GAMESCREEN_TITLE:   return "title";
+		case GAMESCREEN_PLAY:    return "play";
+		case GAMESCREEN_CREDITS: return "credits";
+		default:                 return "unknown";
+	}
+}
@@ -0,0 +1,231 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-19 21:36:50
+ *
+ * Collision Masks
+ */
+
+#include "common.h"
+
+#include <math.h>
+
+#include "mask.h"
+
+#if !defined(M_PI)
+#define M_PI (3.14159265358979323846)
+#endif
+
+// MaskSet : sets the bit for pixel (x, y)
+static void MaskSet(struct maskframe_t *frame, s32 x, s32 y)
+{
+	frame->rows[y * frame->words + (x >> 6)] |= 1ull << (x & 63);
+}
+
+// MaskBuild : builds the rotated masks from RGBA8 pixels (premultiplied or not, only alpha matters)
+s32 MaskBuild(struct mask_t *mask, u8 *rgba, s32 w, s32 h)
+{
+	struct maskframe_t *frame;
+	f32 angle, c, s, dx, dy, u, v, dist;
+	s32 i, x, y, side, center, tx, ty;
+
+	assert(mask);
+	assert(rgba);
+
+	memset(mask, 0, sizeof(*mask));
+
+	// the radius comes from the source, measured to the far corner of each solid pixel
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			if (rgba[(y * w + x) * 4 + 3] < MASK_ALPHA_MIN)
+				continue;
+
+			dx = fabsf(x + 0.5f - w / 2.0f) + 0.5f;
+			dy = fabsf(y + 0.5f - h / 2.0f) + 0.5f;
+			dist = sqrtf(dx * dx + dy * dy);
+
+			mask->radius = MAX(mask->radius, dist);
+			mask->solid = 1;
+		}
+	}
+
+	// every frame is big enough for the sprite at any angle, and odd, so there's a center pixel
+	side = (s32)ceilf(sqrtf((f32)w * w + (f32)h * h)) + 2;
+	side |= 1;
+	center = side / 2;
+
+	for (i = 0; i < MASK_ROTATIONS; i++) {
+		frame = mask->frames + i;
+
+		frame->w = frame->h = side;
+		frame->words = (side + 63) / 64;
+		frame->rows = C_CALLOC(MEM_ASSET, (size_t)frame->words * side, sizeof(*frame->rows));
+		if (frame->rows == NULL) {
+			ERR("Couldn't allocate a collision mask\n");
+			MaskFree(mask);
+			return -1;
+		}
+
+		if (!mask->solid)
+			continue;
+
+		// the sprite gets drawn rotated clockwise (y is down) by angle, so we go the other way
+		// to find which source pixel lands on each of ours
+		angle = i * (2 * M_PI / MASK_ROTATIONS);
+		c = cosf(angle);
+		s = sinf(angle);
+
+		for (y = 0; y < side; y++) {
+			for (x = 0; x < side; x++) {
+				dx = (f32)(x - center);
+				dy = (f32)(y - center);
+
+				u =  c * dx + s * dy + w / 2.0f;
+				v = -s * dx + c * dy + h / 2.0f;
+
+				tx = (s32)floorf(u);
+				ty = (s32)floorf(v);
+
+				if (tx < 0 || ty < 0 || tx >= w || ty >= h)
+					continue;
+
+				if (rgba[(ty * w + tx) * 4 + 3] >= MASK_ALPHA_MIN) {
+					MaskSet(frame, x, y);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+// MaskFree : releases the mask
+void MaskFree(struct mask_t *mask)
+{
+	s32 i;
+
+	assert(mask);
+
+	for (i = 0; i < MASK_ROTATIONS; i++) {
+		C_FREE(mask->frames[i].rows);
+	}
+
+	memset(mask, 0, sizeof(*mask));
+}
+
+// MaskBytes : how much memory the mask is using
+size_t MaskBytes(struct mask_t *mask)
+{
+	size_t bytes;
+	s32 i;
+
+	assert(mask);
+
+	for (i = 0, bytes = sizeof(*mask); i < MASK_ROTATIONS; i++) {
+		bytes += (size_t)mask->frames[i].words * mask->frames[i].h * sizeof(u64);
+	}
+
+	return bytes;
+}
+
+// MaskBucket : the rotation bucket for an angle (radians, the same rotation the sprite is drawn with)
+s32 MaskBucket(f32 angle)
+{
+	f32 t;
+
+	t = angle / (2 * M_PI);
+	t -= floorf(t);
+
+	return (s32)(t * MASK_ROTATIONS + 0.5f) % MASK_ROTATIONS;
+}
+
+// MaskCircle : the cheap check, true if the bounding circles overlap
+s32 MaskCircle(struct mask_t *a, f32 ax, f32 ay, struct mask_t *b, f32 bx, f32 by)
+{
+	f32 dx, dy, r;
+
+	dx = bx - ax;
+	dy = by - ay;
+	r = a->radius + b->radius;
+
+	return dx * dx + dy * dy <= r * r;
+}
+
+// MaskRowHit : true if row a and row b overlap, with b shifted right by shift (>= 0) pixels
+static s32 MaskRowHit(u64 *a, s32 awords, u64 *b, s32 bwords, s32 shift)
+{
+	s32 i, j, q, r;
+	u64 word;
+
+	q = shift >> 6;
+	r = shift & 63;
+
+	for (i = q; i < awords; i++) {
+		j = i - q;
+
+		word = 0;
+
+		if (j < bwords)
+			word |= b[j] << r;
+
+		// the bits that got shifted out of the previous word
+		if (r && 0 < j && j - 1 < bwords)
+			word |= b[j - 1] >> (64 - r);
+
+		if (a[i] & word)
+			return 1;
+	}
+
+	return 0;
+}
+
+// MaskOverlap : the exact check, true if any solid pixels of a (centered at ax, ay) and b overlap
+s32 MaskOverlap(struct mask_t *a, f32 ax, f32 ay, f32 aangle, struct mask_t *b, f32 bx, f32 by, f32 bangle)
+{
+	struct maskframe_t *fa, *fb;
+	s32 dx, dy, y, y0, y1;
+	u64 *ra, *rb;
+
+	assert(a);
+	assert(b);
+
+	if (!a->solid || !b->solid)
+		return 0;
+
+	fa = a->frames + MaskBucket(aangle);
+	fb = b->frames + MaskBucket(bangle);
+
+	// b's top left corner, relative to a's
+	dx = ((s32)floorf(bx) - fb->w / 2) - ((s32)floorf(ax) - fa->w / 2);
+	dy = ((s32)floorf(by) - fb->h / 2) - ((s32)floorf(ay) - fa->h / 2);
+
+	if (dx >= fa->w || -dx >= fb->w || dy >= fa->h || -dy >= fb->h)
+		return 0;
+
+	y0 = MAX(0, dy);
+	y1 = MIN(fa->h, dy + fb->h);
+
+	for (y = y0; y < y1; y++) {
+		ra = fa->rows + y * fa->words;
+		rb = fb->rows + (y - dy) * fb->words;
+
+		if (dx >= 0) {
+			if (MaskRowHit(ra, fa->words, rb, fb->words, dx))
+				return 1;
+		} else {
+			if (MaskRowHit(rb, fb->words, ra, fa->words, -dx))
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+// MaskCollide : MaskCircle, then MaskOverlap if the circles touch
+s32 MaskCollide(struct mask_t *a, f32 ax, f32 ay, f32 aangle, struct mask_t *b, f32 bx, f32 by, f32 bangle)
+{
+	if (!MaskCircle(a, ax, ay, b, bx, by))
+		return 0;
+
+	return MaskOverlap(a, ax, ay, aangle, b, bx, by, bangle);
+}
+
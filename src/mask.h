@@ -0,0 +1,60 @@
+#ifndef MASK_H
+#define MASK_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-19 21:36:50
+ *
+ * Collision Masks
+ *
+ * One bit per pixel, "is this pixel solid", built from a sprite's alpha channel when it's loaded.
+ * Sprites spin, so there's a mask per rotation bucket, each one big enough to hold the sprite at
+ * any angle, centered on the sprite's center.
+ *
+ * Rows are packed into u64s (bit 0 is the leftmost pixel), so checking two masks against each
+ * other is a shift and an AND per 64 pixels of overlapping row, instead of a loop over pixels.
+ *
+ * The mask also knows its radius (the farthest solid pixel from the center), which makes for a
+ * cheap circle check to do first.
+ */
+
+#include "common.h"
+
+#define MASK_ROTATIONS  (32)  // rotation buckets, over a full turn
+#define MASK_ALPHA_MIN  (128) // alpha at or above this is solid
+
+struct maskframe_t {
+	u64 *rows;   // h rows of words u64s
+	s32 w, h;    // square, and odd, so the center lands on a pixel
+	s32 words;   // u64s per row
+};
+
+struct mask_t {
+	struct maskframe_t frames[MASK_ROTATIONS];
+	f32 radius;
+	s32 solid; // any solid pixels at all
+};
+
+// MaskBuild : builds the rotated masks from RGBA8 pixels (premultiplied or not, only alpha matters)
+s32 MaskBuild(struct mask_t *mask, u8 *rgba, s32 w, s32 h);
+
+// MaskFree : releases the mask
+void MaskFree(struct mask_t *mask);
+
+// MaskBytes : how much memory the mask is using
+size_t MaskBytes(struct mask_t *mask);
+
+// MaskBucket : the rotation bucket for an angle (radians, the same rotation the sprite is drawn with)
+s32 MaskBucket(f32 angle);
+
+// MaskCircle : the cheap check, true if the bounding circles overlap
+s32 MaskCircle(struct mask_t *a, f32 ax, f32 ay, struct mask_t *b, f32 bx, f32 by);
+
+// MaskOverlap : the exact check, true if any solid pixels of a (centered at ax, ay) and b overlap
+s32 MaskOverlap(struct mask_t *a, f32 ax, f32 ay, f32 aangle, struct mask_t *b, f32 bx, f32 by, f32 bangle);
+
+// MaskCollide : MaskCircle, then MaskOverlap if the circles touch
+s32 MaskCollide(struct mask_t *a, f32 ax, f32 ay, f32 aangle, struct mask_t *b, f32 bx, f32 by, f32 bangle);
+
+#endif // MASK_H
+
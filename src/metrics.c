@@ -0,0 +1,218 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-30 16:22:08
+ *
+ * Runtime Metrics
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+#include "metrics.h"
+
+static struct metric_t gMetrics[METRICS_MAX];
+static s32 gMetricsLen;
+static SDL_SpinLock gMetricsLock;
+
+// MetricBucket : the histogram bucket value goes in
+static s32 MetricBucket(u64 value)
+{
+	s32 e;
+
+	if (value < METRIC_SUB)
+		return (s32)value;
+
+	e = 63 - __builtin_clzll(value); // at least METRIC_SUB_BITS
+
+	return (e - METRIC_SUB_BITS + 1) * METRIC_SUB + (s32)((value >> (e - METRIC_SUB_BITS)) & (METRIC_SUB - 1));
+}
+
+// MetricBucketTop : the biggest value that goes in bucket
+static u64 MetricBucketTop(s32 bucket)
+{
+	s32 e, sub;
+
+	if (bucket < METRIC_SUB)
+		return bucket;
+
+	e = bucket / METRIC_SUB + METRIC_SUB_BITS - 1;
+	sub = bucket % METRIC_SUB;
+
+	return (((u64)(METRIC_SUB + sub) + 1) << (e - METRIC_SUB_BITS)) - 1;
+}
+
+// MetricRegister : returns the metric called name, making it the first time, NULL if there's no room
+struct metric_t *MetricRegister(char *name, s32 type)
+{
+	struct metric_t *metric;
+	s32 i;
+
+	assert(name);
+	assert(0 <= type && type < METRIC_TOTAL);
+
+	SDL_AtomicLock(&gMetricsLock);
+
+	for (i = 0; i < gMetricsLen; i++) {
+		if (streq(gMetrics[i].name, name)) {
+			SDL_AtomicUnlock(&gMetricsLock);
+			assert(gMetrics[i].type == type);
+			return gMetrics + i;
+		}
+	}
+
+	if (gMetricsLen == METRICS_MAX) {
+		SDL_AtomicUnlock(&gMetricsLock);
+		ERR("Too many metrics, couldn't register '%s'\n", name);
+		return NULL;
+	}
+
+	metric = gMetrics + gMetricsLen;
+	memset(metric, 0, sizeof(*metric));
+
+	if (type == METRIC_HISTOGRAM) {
+		metric->buckets = C_CALLOC(MEM_DEBUG, METRIC_BUCKETS, sizeof(*metric->buckets));
+		if (metric->buckets == NULL) {
+			SDL_AtomicUnlock(&gMetricsLock);
+			ERR("Couldn't allocate the histogram for '%s'\n", name);
+			return NULL;
+		}
+	}
+
+	snprintf(metric->name, sizeof metric->name, "%s", name);
+	metric->type = type;
+
+	// published last, MetricsWrite only looks at what's below gMetricsLen
+	__atomic_store_n(&gMetricsLen, gMetricsLen + 1, __ATOMIC_RELEASE);
+
+	SDL_AtomicUnlock(&gMetricsLock);
+
+	return metric;
+}
+
+// MetricAdd : adds n to a counter
+void MetricAdd(struct metric_t *metric, s64 n)
+{
+	if (metric == NULL)
+		return;
+
+	__atomic_fetch_add(&metric->value, n, __ATOMIC_RELAXED);
+}
+
+// MetricSet : sets a gauge
+void MetricSet(struct metric_t *metric, s64 value)
+{
+	if (metric == NULL)
+		return;
+
+	__atomic_store_n(&metric->value, value, __ATOMIC_RELAXED);
+}
+
+// MetricValue : a counter's or a gauge's value
+s64 MetricValue(struct metric_t *metric)
+{
+	if (metric == NULL)
+		return 0;
+
+	return __atomic_load_n(&metric->value, __ATOMIC_RELAXED);
+}
+
+// MetricRecord : adds a sample to a histogram
+void MetricRecord(struct metric_t *metric, u64 value)
+{
+	u64 max;
+
+	if (metric == NULL)
+		return;
+
+	assert(metric->type == METRIC_HISTOGRAM);
+
+	__atomic_fetch_add(metric->buckets + MetricBucket(value), 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&metric->sum, value, __ATOMIC_RELAXED);
+
+	max = __atomic_load_n(&metric->max, __ATOMIC_RELAXED);
+	while (max < value) {
+		if (__atomic_compare_exchange_n(&metric->max, &max, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+}
+
+// MetricsWriteHistogram : writes one histogram's line, and starts it over
+static void MetricsWriteHistogram(FILE *fp, f64 seconds, struct metric_t *metric)
+{
+	static f64 quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	u64 counts[METRIC_BUCKETS];
+	u64 count, seen, sum, max;
+	s32 i, q;
+
+	// taken one bucket at a time, a sample that lands mid-snapshot shows up in this one or the next
+	for (i = 0, count = 0; i < METRIC_BUCKETS; i++) {
+		counts[i] = __atomic_exchange_n(metric->buckets + i, 0, __ATOMIC_RELAXED);
+		count += counts[i];
+	}
+
+	sum = __atomic_exchange_n(&metric->sum, 0, __ATOMIC_RELAXED);
+	max = __atomic_exchange_n(&metric->max, 0, __ATOMIC_RELAXED);
+
+	fprintf(fp, "%.3f histogram %s %llu %.0f", seconds, metric->name,
+		(unsigned long long)count, count ? (f64)sum / count : 0.0);
+
+	for (q = 0, i = 0, seen = 0; q < ARRSIZE(quantiles); q++) {
+		while (i < METRIC_BUCKETS && (seen == 0 || seen < quantiles[q] * count)) {
+			seen += counts[i++];
+		}
+
+		fprintf(fp, " %llu", count ? (unsigned long long)MIN(MetricBucketTop(i - 1), max) : 0ULL);
+	}
+
+	fprintf(fp, " %llu\n", (unsigned long long)max);
+}
+
+// MetricsWrite : appends a snapshot of every metric, at seconds, to fp (and starts the histograms over)
+void MetricsWrite(FILE *fp, f64 seconds)
+{
+	struct metric_t *metric;
+	s32 i, n;
+
+	assert(fp);
+
+	n = __atomic_load_n(&gMetricsLen, __ATOMIC_ACQUIRE);
+
+	for (i = 0; i < n; i++) {
+		metric = gMetrics + i;
+
+		if (metric->type == METRIC_HISTOGRAM) {
+			MetricsWriteHistogram(fp, seconds, metric);
+		} else {
+			fprintf(fp, "%.3f %s %s %lld\n", seconds, MetricTypeName(metric->type), metric->name,
+				(long long)__atomic_load_n(&metric->value, __ATOMIC_RELAXED));
+		}
+	}
+
+	fflush(fp);
+}
+
+// MetricTypeName : returns a printable name for a METRIC_* value
+char *MetricTypeName(s32 type)
+{
+	static char *names[] = { "counter", "gauge", "histogram" };
+
+	return 0 <= type && type < METRIC_TOTAL ? names[type] : "unknown";
+}
+
+// MetricsFree : throws every metric away
+void MetricsFree(void)
+{
+	s32 i;
+
+	SDL_AtomicLock(&gMetricsLock);
+
+	for (i = 0; i < gMetricsLen; i++) {
+		C_FREE(gMetrics[i].buckets);
+	}
+
+	memset(gMetrics, 0, sizeof gMetrics);
+	gMetricsLen = 0;
+
+	SDL_AtomicUnlock(&gMetricsLock);
+}
@@ -0,0 +1,90 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-30 16:22:08
+ *
+ * Runtime Metrics
+ *
+ * Named numbers that get looked at over a long session, instead of for a single frame:
+ *
+ *   METRIC_COUNTER    only goes up (collisions found, bullets that overwrote a live one)
+ *   METRIC_GAUGE      what something is right now (live asteroids)
+ *   METRIC_HISTOGRAM  a distribution of u64 samples (frame time, in nanoseconds)
+ *
+ * Each one is registered once, by name, at startup, and the handle is kept around. Updates are
+ * atomic adds and stores (the __atomic builtins, SDL only has 32 bit atomics), so any thread can
+ * update any metric without a lock.
+ *
+ * Histograms are log-linear, like HdrHistogram: the values below METRIC_SUB go in a bucket each,
+ * and every power of two above that is split into METRIC_SUB buckets. Any value is within
+ * 1 / METRIC_SUB (about 6%) of its bucket, from nanoseconds to centuries, in under 8K a histogram.
+ *
+ * MetricsWrite appends a snapshot of every metric to a file, one metric a line:
+ *
+ *   <seconds> counter <name> <value>
+ *   <seconds> gauge <name> <value>
+ *   <seconds> histogram <name> <count> <mean> <p50> <p90> <p99> <p999> <max>
+ *
+ * Counters and gauges are the value right now. Histograms are only the samples since the last
+ * snapshot, so each line is one interval. Percentiles are the top of the bucket they landed in.
+ */
+
+#include "common.h"
+
+enum {
+	METRIC_COUNTER,
+	METRIC_GAUGE,
+	METRIC_HISTOGRAM,
+	METRIC_TOTAL
+};
+
+// how many metrics there can be
+#define METRICS_MAX     (64)
+#define METRIC_NAMELEN  (32)
+
+// histogram buckets per power of two, and how many that makes, for every u64
+#define METRIC_SUB_BITS (4)
+#define METRIC_SUB      (1 << METRIC_SUB_BITS)
+#define METRIC_BUCKETS  ((64 - METRIC_SUB_BITS + 1) * METRIC_SUB)
+
+// seconds between snapshots, without -metrics-interval
+#define METRICS_INTERVAL (1)
+
+struct metric_t {
+	char name[METRIC_NAMELEN];
+	s32 type;
+
+	s64 value; // counters and gauges
+
+	// histograms
+	u64 *buckets;
+	u64 sum, max;
+};
+
+// MetricRegister : returns the metric called name, making it the first time, NULL if there's no room
+struct metric_t *MetricRegister(char *name, s32 type);
+
+// MetricAdd : adds n to a counter
+void MetricAdd(struct metric_t *metric, s64 n);
+
+// MetricSet : sets a gauge
+void MetricSet(struct metric_t *metric, s64 value);
+
+// MetricValue : a counter's or a gauge's value
+s64 MetricValue(struct metric_t *metric);
+
+// MetricRecord : adds a sample to a histogram
+void MetricRecord(struct metric_t *metric, u64 value);
+
+// MetricsWrite : appends a snapshot of every metric, at seconds, to fp (and starts the histograms over)
+void MetricsWrite(FILE *fp, f64 seconds);
+
+// MetricTypeName : returns a printable name for a METRIC_* value
+char *MetricTypeName(s32 type);
+
+// MetricsFree : throws every metric away
+void MetricsFree(void);
+
+#endif // METRICS_H
@@ -0,0 +1,228 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-17 15:02:11
+ *
+ * Packed Asset Archive
+ */
+
+#include "common.h"
+
+#include "pak.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// PakHash : hashes a name (64 bit FNV-1a)
+u64 PakHash(char *name)
+{
+	u64 hash;
+
+	for (hash = 0xcbf29ce484222325ull; *name; name++) {
+		hash ^= (u8)*name;
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+// PakMapFile : maps any file read-only (not just paks), NULL if we can't
+u8 *PakMapFile(char *path, size_t *size)
+{
+#if defined(_WIN32)
+	HANDLE file, mapping;
+	LARGE_INTEGER li;
+	u8 *base;
+
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	if (!GetFileSizeEx(file, &li) || li.QuadPart == 0) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file); // the mapping keeps the file open
+	if (mapping == NULL)
+		return NULL;
+
+	base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping); // and the view keeps the mapping around
+	if (base == NULL)
+		return NULL;
+
+	*size = (size_t)li.QuadPart;
+
+	return base;
+#else
+	struct stat st;
+	void *base;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps the file open
+	if (base == MAP_FAILED)
+		return NULL;
+
+	*size = st.st_size;
+
+	return base;
+#endif
+}
+
+// PakUnmapFile : releases a PakMapFile mapping
+void PakUnmapFile(u8 *base, size_t size)
+{
+	if (base == NULL)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(base);
+#else
+	munmap(base, size);
+#endif
+}
+
+// PakOpen : maps the archive at path, read-only
+s32 PakOpen(struct pak_t *pak, char *path)
+{
+	struct pakheader_t *header;
+	struct pakentry_t *entry;
+	u32 i;
+
+	assert(pak);
+	assert(path);
+
+	memset(pak, 0, sizeof(*pak));
+
+	pak->base = PakMapFile(path, &pak->size);
+	if (pak->base == NULL) {
+		return -1;
+	}
+
+	header = (struct pakheader_t *)pak->base;
+
+	if (pak->size < sizeof(*header) || memcmp(header->magic, PAK_MAGIC, sizeof(header->magic)) != 0) {
+		ERR("'%s' isn't a pak file\n", path);
+		PakClose(pak);
+		return -1;
+	}
+
+	if (header->version != PAK_VERSION) {
+		ERR("'%s' is version %u, we only read version %d\n", path, header->version, PAK_VERSION);
+		PakClose(pak);
+		return -1;
+	}
+
+	if ((pak->size - sizeof(*header)) / sizeof(*entry) < header->count) {
+		ERR("'%s' is truncated (table of contents)\n", path);
+		PakClose(pak);
+		return -1;
+	}
+
+	pak->entries = (struct pakentry_t *)(pak->base + sizeof(*header));
+	pak->count = header->count;
+
+	// check the blobs up front, so nobody has to later
+	for (i = 0; i < pak->count; i++) {
+		entry = pak->entries + i;
+		if (entry->offset > pak->size || entry->size > pak->size - entry->offset) {
+			ERR("'%s' is truncated ('%.*s')\n", path, PAK_NAMELEN, entry->name);
+			PakClose(pak);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+// PakClose : unmaps the archive
+void PakClose(struct pak_t *pak)
+{
+	assert(pak);
+
+	PakUnmapFile(pak->base, pak->size);
+
+	memset(pak, 0, sizeof(*pak));
+}
+
+// PakFind : looks up an entry by name, NULL if it isn't in the archive
+struct pakentry_t *PakFind(struct pak_t *pak, char *name)
+{
+	struct pakentry_t *entry;
+	u64 hash;
+	s64 lo, hi, mid;
+
+	assert(pak);
+	assert(name);
+
+	hash = PakHash(name);
+
+	// find the first entry with this hash
+	for (lo = 0, hi = pak->count; lo < hi;) {
+		mid = lo + (hi - lo) / 2;
+		if (pak->entries[mid].hash < hash) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	// then walk the (almost certainly single) run of collisions
+	for (; lo < pak->count && pak->entries[lo].hash == hash; lo++) {
+		entry = pak->entries + lo;
+		if (strncmp(entry->name, name, PAK_NAMELEN) == 0) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+// PakPrefetch : asks the os to start reading the entry's bytes in, without waiting on it
+void PakPrefetch(struct pak_t *pak, struct pakentry_t *entry)
+{
+#if defined(_WIN32)
+	// NOTE (Brian) PrefetchVirtualMemory would do it, but it's Windows 8 and up, so we just fault
+	// the pages in when stb reads them
+#else
+	uintptr_t start, end, page;
+
+	assert(pak);
+	assert(entry);
+
+	page = (uintptr_t)sysconf(_SC_PAGESIZE);
+
+	start = (uintptr_t)(pak->base + entry->offset) & ~(page - 1);
+	end = (uintptr_t)(pak->base + entry->offset + entry->size);
+
+	madvise((void *)start, end - start, MADV_WILLNEED);
+#endif
+}
+
+// PakData : returns a pointer to the entry's bytes (inside the mapping)
+u8 *PakData(struct pak_t *pak, struct pakentry_t *entry)
+{
+	assert(pak);
+	assert(entry);
+
+	return pak->base + entry->offset;
+}
+
@@ -0,0 +1,80 @@
+#ifndef PAK_H
+#define PAK_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-17 15:02:11
+ *
+ * Packed Asset Archive
+ *
+ * All of the assets, in one file, so a cold start is one open and one mmap instead of an open and
+ * a read for every png. The file looks like this:
+ *
+ *   pakheader_t
+ *   pakentry_t[count]   sorted by (hash, name)
+ *   blobs               every one starts on a PAK_ALIGN boundary
+ *
+ * Everything is little endian. Names are the paths the game asks for ("assets/sprites/ship.png"),
+ * always with forward slashes, so a lookup is just a binary search on the hash of the path.
+ *
+ * The archive is mapped read-only, and PakData points straight into the mapping, so decoding out
+ * of it doesn't copy anything.
+ *
+ * tools/pak.c builds these.
+ */
+
+#include "common.h"
+
+#define PAK_MAGIC    ("APAK")
+#define PAK_VERSION  (1)
+#define PAK_ALIGN    (16)
+#define PAK_NAMELEN  (104)
+
+struct pakheader_t {
+	char magic[4];
+	u32 version;
+	u32 count;
+	u32 reserved;
+};
+
+struct pakentry_t {
+	u64 hash;   // PakHash(name)
+	u64 offset; // from the start of the file
+	u64 size;
+	char name[PAK_NAMELEN];
+};
+
+struct pak_t {
+	u8 *base;
+	size_t size;
+
+	struct pakentry_t *entries;
+	u32 count;
+};
+
+// PakHash : hashes a name (64 bit FNV-1a)
+u64 PakHash(char *name);
+
+// PakMapFile : maps any file read-only (not just paks), NULL if we can't
+u8 *PakMapFile(char *path, size_t *size);
+
+// PakUnmapFile : releases a PakMapFile mapping
+void PakUnmapFile(u8 *base, size_t size);
+
+// PakOpen : maps the archive at path, read-only
+s32 PakOpen(struct pak_t *pak, char *path);
+
+// PakClose : unmaps the archive
+void PakClose(struct pak_t *pak);
+
+// PakFind : looks up an entry by name, NULL if it isn't in the archive
+struct pakentry_t *PakFind(struct pak_t *pak, char *name);
+
+// PakPrefetch : asks the os to start reading the entry's bytes in, without waiting on it
+void PakPrefetch(struct pak_t *pak, struct pakentry_t *entry);
+
+// PakData : returns a pointer to the entry's bytes (inside the mapping)
+u8 *PakData(struct pak_t *pak, struct pakentry_t *entry);
+
+#endif // PAK_H
+
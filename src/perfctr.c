@@ -0,0 +1,195 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-26 18:22:40
+ *
+ * Hardware Performance Counters
+ */
+
+#include "common.h"
+
+#include "perfctr.h"
+
+#if defined(__linux__)
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// PerfCtrRead : reads one counter, 0 if it isn't open
+static u64 PerfCtrRead(int fd)
+{
+	u64 v;
+
+	if (fd < 0 || read(fd, &v, sizeof v) != sizeof v)
+		return 0;
+
+	return v;
+}
+
+// PerfCtrOpen : opens every counter we can, returns how many that was
+s32 PerfCtrOpen(struct perfctr_t *ctr)
+{
+	struct perf_event_attr attr;
+	s32 i;
+
+	static const struct { u32 type; u64 config; } events[PERFCTR_TOTAL] = {
+		[PERFCTR_CYCLES]       = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		[PERFCTR_INSTRUCTIONS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		[PERFCTR_L1D_MISSES]   = { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+			(PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		[PERFCTR_LLC_MISSES]   = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		[PERFCTR_DTLB_MISSES]  = { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+			(PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		[PERFCTR_TASK_CLOCK]   = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+	};
+
+	assert(ctr);
+
+	memset(ctr, 0, sizeof(*ctr));
+
+	for (i = 0; i < PERFCTR_TOTAL; i++) {
+		memset(&attr, 0, sizeof attr);
+
+		attr.size = sizeof attr;
+		attr.type = events[i].type;
+		attr.config = events[i].config;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		// this thread, on any cpu
+		ctr->fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (ctr->fd[i] >= 0)
+			ctr->opened++;
+	}
+
+	if (ctr->opened == 0) {
+		ERR("Couldn't open any performance counters (check kernel.perf_event_paranoid)\n");
+	} else if (ctr->opened < PERFCTR_TOTAL) {
+		WRN("Only %d of %d performance counters are available here\n", ctr->opened, PERFCTR_TOTAL);
+	}
+
+	return ctr->opened;
+}
+
+// PerfCtrBegin : starts a sample
+void PerfCtrBegin(struct perfctr_t *ctr)
+{
+	s32 i;
+
+	assert(ctr);
+
+	for (i = 0; i < PERFCTR_TOTAL; i++) {
+		ctr->start[i] = PerfCtrRead(ctr->fd[i]);
+	}
+}
+
+// PerfCtrEnd : ends a sample, adding it to the totals
+void PerfCtrEnd(struct perfctr_t *ctr)
+{
+	s32 i;
+
+	assert(ctr);
+
+	for (i = 0; i < PERFCTR_TOTAL; i++) {
+		ctr->total[i] += PerfCtrRead(ctr->fd[i]) - ctr->start[i];
+	}
+
+	ctr->samples++;
+}
+
+// PerfCtrClose : closes the counters
+void PerfCtrClose(struct perfctr_t *ctr)
+{
+	s32 i;
+
+	assert(ctr);
+
+	for (i = 0; i < PERFCTR_TOTAL; i++) {
+		if (ctr->fd[i] >= 0)
+			close(ctr->fd[i]);
+		ctr->fd[i] = -1;
+	}
+
+	ctr->opened = 0;
+}
+
+#else
+
+// PerfCtrOpen : opens every counter we can, returns how many that was
+s32 PerfCtrOpen(struct perfctr_t *ctr)
+{
+	s32 i;
+
+	assert(ctr);
+
+	memset(ctr, 0, sizeof(*ctr));
+
+	for (i = 0; i < PERFCTR_TOTAL; i++) {
+		ctr->fd[i] = -1;
+	}
+
+	ERR("Performance counters aren't supported on this platform\n");
+
+	return 0;
+}
+
+// PerfCtrBegin : starts a sample
+void PerfCtrBegin(struct perfctr_t *ctr)
+{
+}
+
+// PerfCtrEnd : ends a sample, adding it to the totals
+void PerfCtrEnd(struct perfctr_t *ctr)
+{
+	assert(ctr);
+
+	ctr->samples++;
+}
+
+// PerfCtrClose : closes the counters
+void PerfCtrClose(struct perfctr_t *ctr)
+{
+}
+
+#endif
+
+// PerfCtrReport : writes the per sample average of every counter to fp
+void PerfCtrReport(struct perfctr_t *ctr, char *name, FILE *fp)
+{
+	s32 i;
+
+	assert(ctr);
+	assert(fp);
+
+	if (ctr->samples == 0)
+		return;
+
+	fprintf(fp, "%s, %llu samples\n", name, (unsigned long long)ctr->samples);
+
+	for (i = 0; i < PERFCTR_TOTAL; i++) {
+		if (ctr->fd[i] < 0) {
+			fprintf(fp, "    %-14s %14s\n", PerfCtrName(i), "n/a");
+		} else {
+			fprintf(fp, "    %-14s %14.1f\n", PerfCtrName(i), (f64)ctr->total[i] / ctr->samples);
+		}
+	}
+
+	if (ctr->fd[PERFCTR_CYCLES] >= 0 && ctr->fd[PERFCTR_INSTRUCTIONS] >= 0 && ctr->total[PERFCTR_CYCLES]) {
+		fprintf(fp, "    %-14s %14.2f\n", "ipc",
+			(f64)ctr->total[PERFCTR_INSTRUCTIONS] / ctr->total[PERFCTR_CYCLES]);
+	}
+}
+
+// PerfCtrName : returns a printable name for a PERFCTR_* value
+char *PerfCtrName(s32 id)
+{
+	switch (id) {
+		case PERFCTR_CYCLES:       return "cycles";
+		case PERFCTR_INSTRUCTIONS: return "instructions";
+		case PERFCTR_L1D_MISSES:   return "l1d misses";
+		case PERFCTR_LLC_MISSES:   return "llc misses";
+		case PERFCTR_DTLB_MISSES:  return "dtlb misses";
+		case PERFCTR_TASK_CLOCK:   return "task clock ns";
+		default:                   return "unknown";
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-26 18:22:40
+ *
+ * Hardware Performance Counters
+ *
+ * Counts cycles, instructions, cache and TLB misses (and the task clock) around a piece of code,
+ * so a change to the memory layout can be measured, instead of guessed at:
+ *
+ *   PerfCtrBegin(&ctr);
+ *   Update(state);
+ *   PerfCtrEnd(&ctr);
+ *
+ * This is perf_event_open, so it's Linux only, counting this thread in user space. Every counter
+ * is opened on its own, so a machine (or a VM) without one (no PMU, or perf_event_paranoid set too
+ * high) still gets the rest, and the report says which ones weren't there.
+ */
+
+#include "common.h"
+
+#include <stdio.h>
+
+enum {
+	PERFCTR_CYCLES,
+	PERFCTR_INSTRUCTIONS,
+	PERFCTR_L1D_MISSES,
+	PERFCTR_LLC_MISSES,
+	PERFCTR_DTLB_MISSES,
+	PERFCTR_TASK_CLOCK, // ns, software, so it's nearly always there
+	PERFCTR_TOTAL
+};
+
+struct perfctr_t {
+	int fd[PERFCTR_TOTAL]; // -1 if we couldn't open it
+	u64 start[PERFCTR_TOTAL];
+	u64 total[PERFCTR_TOTAL];
+	u64 samples; // Begin / End pairs
+	s32 opened;
+};
+
+// PerfCtrOpen : opens every counter we can, returns how many that was
+s32 PerfCtrOpen(struct perfctr_t *ctr);
+
+// PerfCtrBegin : starts a sample
+void PerfCtrBegin(struct perfctr_t *ctr);
+
+// PerfCtrEnd : ends a sample, adding it to the totals
+void PerfCtrEnd(struct perfctr_t *ctr);
+
+// PerfCtrReport : writes the per sample average of every counter to fp
+void PerfCtrReport(struct perfctr_t *ctr, char *name, FILE *fp);
+
+// PerfCtrName : returns a printable name for a PERFCTR_* value
+char *PerfCtrName(s32 id);
+
+// PerfCtrClose : closes the counters
+void PerfCtrClose(struct perfctr_t *ctr);
+
+#endif // PERFCTR_H
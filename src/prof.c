@@ -0,0 +1,197 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-29 19:48:15
+ *
+ * Profiling Zones
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+#include "prof.h"
+
+#define PROF_MASK (PROF_RING - 1)
+
+static struct profthread_t *gProfThreads[PROF_THREADS];
+static SDL_atomic_t gProfThreadsLen;
+
+static _Thread_local struct profthread_t *tProf;
+
+// ProfThread : this thread's zones, made the first time it asks
+static struct profthread_t *ProfThread(void)
+{
+	struct profthread_t *thread;
+	s32 i;
+
+	if (tProf)
+		return tProf;
+
+	i = SDL_AtomicAdd(&gProfThreadsLen, 1);
+	if (i >= PROF_THREADS) {
+		SDL_AtomicAdd(&gProfThreadsLen, -1);
+		return NULL;
+	}
+
+	thread = C_CALLOC(MEM_DEBUG, 1, sizeof(*thread));
+	if (thread)
+		thread->ring = C_CALLOC(MEM_DEBUG, PROF_RING, sizeof(*thread->ring));
+
+	if (thread == NULL || thread->ring == NULL) {
+		ERR("Couldn't allocate the profiling zones for a thread\n");
+		C_FREE(thread);
+		return NULL;
+	}
+
+	thread->tid = i + 1;
+	snprintf(thread->name, sizeof thread->name, "thread %d", i);
+
+	// published last, ProfDump only looks at what's here
+	SDL_AtomicSetPtr((void **)&gProfThreads[i], thread);
+
+	tProf = thread;
+
+	return thread;
+}
+
+// ProfBegin : opens a zone on this thread (name has to be a literal, or live as long as the program)
+void ProfBegin(const char *name)
+{
+	struct profthread_t *thread;
+	struct profzone_t *zone;
+
+	thread = ProfThread();
+	if (thread == NULL)
+		return;
+
+	// too deep, it's counted so the ProfEnd still lines up, but not recorded
+	if (thread->depth >= PROF_DEPTH) {
+		thread->depth++;
+		return;
+	}
+
+	zone = thread->stack + thread->depth;
+	zone->name = name;
+	zone->depth = thread->depth++;
+	zone->start = SDL_GetPerformanceCounter();
+}
+
+// ProfEnd : closes this thread's innermost zone
+void ProfEnd(void)
+{
+	struct profthread_t *thread;
+	struct profzone_t *zone;
+	u64 end;
+
+	end = SDL_GetPerformanceCounter();
+
+	thread = tProf;
+	if (thread == NULL || thread->depth == 0)
+		return;
+
+	if (--thread->depth >= PROF_DEPTH)
+		return;
+
+	zone = thread->ring + (thread->count & PROF_MASK);
+	*zone = thread->stack[thread->depth];
+	zone->end = end;
+
+	thread->count++;
+}
+
+// ProfThreadName : names this thread, in the trace
+void ProfThreadName(const char *name)
+{
+	struct profthread_t *thread;
+
+	thread = ProfThread();
+	if (thread)
+		snprintf(thread->name, sizeof thread->name, "%s", name);
+}
+
+// ProfDump : writes the last seconds of every thread's zones to path, as Chrome trace json
+s32 ProfDump(char *path, f64 seconds)
+{
+	struct profthread_t *thread;
+	struct profzone_t *zone;
+	u64 now, since, origin, i, first;
+	f64 us;
+	s32 t, n, zones;
+	FILE *fp;
+
+	assert(path);
+
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		ERR("Couldn't open '%s' to write the profile\n", path);
+		return -1;
+	}
+
+	now = SDL_GetPerformanceCounter();
+	us = 1e6 / SDL_GetPerformanceFrequency();
+	since = now - MIN(now, (u64)(seconds * SDL_GetPerformanceFrequency()));
+
+	n = MIN(SDL_AtomicGet(&gProfThreadsLen), PROF_THREADS);
+
+	// timestamps start at the oldest zone that's going in
+	for (t = 0, origin = now; t < n; t++) {
+		thread = SDL_AtomicGetPtr((void **)&gProfThreads[t]);
+		if (thread == NULL)
+			continue;
+
+		first = thread->count > PROF_RING ? thread->count - PROF_RING : 0;
+		for (i = first; i < thread->count; i++) {
+			zone = thread->ring + (i & PROF_MASK);
+			if (zone->end >= since && zone->start < origin)
+				origin = zone->start;
+		}
+	}
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	for (t = 0, zones = 0; t < n; t++) {
+		thread = SDL_AtomicGetPtr((void **)&gProfThreads[t]);
+		if (thread == NULL)
+			continue;
+
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			t ? ",\n" : "", thread->tid, thread->name);
+
+		first = thread->count > PROF_RING ? thread->count - PROF_RING : 0;
+		for (i = first; i < thread->count; i++) {
+			zone = thread->ring + (i & PROF_MASK);
+			if (zone->end < since)
+				continue;
+
+			fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				zone->name, thread->tid, (zone->start - origin) * us, (zone->end - zone->start) * us);
+			zones++;
+		}
+	}
+
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+
+	LOG("profile: %d zones from the last %.1f seconds, on %d threads, in '%s'\n", zones, seconds, n, path);
+
+	return 0;
+}
+
+// ProfFree : frees every thread's ring
+void ProfFree(void)
+{
+	struct profthread_t *thread;
+	s32 t, n;
+
+	n = MIN(SDL_AtomicGet(&gProfThreadsLen), PROF_THREADS);
+
+	for (t = 0; t < n; t++) {
+		thread = SDL_AtomicSetPtr((void **)&gProfThreads[t], NULL);
+		if (thread) {
+			C_FREE(thread->ring);
+			C_FREE(thread);
+		}
+	}
+
+	tProf = NULL;
+}
@@ -0,0 +1,83 @@
+#ifndef PROF_H
+#define PROF_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-29 19:48:15
+ *
+ * Profiling Zones
+ *
+ * Always on, cheap enough to leave in a release build, so there's a timeline of where the frame
+ * went without attaching a profiler:
+ *
+ *   PROF_BEGIN("Update");
+ *   Update(state);
+ *   PROF_END();
+ *
+ * Zones nest. Each thread gets its own ring of finished zones (made the first time it opens one),
+ * so recording is two performance counter reads and a store, with no locks. The rings keep the
+ * last PROF_RING zones per thread, which at a few dozen zones a frame is well over a minute.
+ *
+ * ProfDump writes the last n seconds of every thread's zones as Chrome trace event json, which
+ * chrome://tracing and ui.perfetto.dev both open. It reads the other threads' rings without
+ * stopping them, so it should be called between frames, when the job pool is idle.
+ *
+ * -DPROF_DISABLE compiles every zone out.
+ */
+
+#include "common.h"
+
+// finished zones each thread keeps, a power of two
+#define PROF_RING (1 << 16)
+
+// how deep zones can nest
+#define PROF_DEPTH (32)
+
+// threads that can record zones
+#define PROF_THREADS (64)
+
+// what gets dumped, without -profile or -profile-seconds
+#define PROF_PATH    ("profile.json")
+#define PROF_SECONDS (5)
+
+struct profzone_t {
+	const char *name;
+	u64 start, end; // performance counter
+	u32 depth;
+};
+
+struct profthread_t {
+	char name[32];
+	u32 tid; // for the trace, in the order threads showed up
+
+	struct profzone_t *ring;
+	u64 count; // zones ever finished, the newest is at (count - 1) & (PROF_RING - 1)
+
+	struct profzone_t stack[PROF_DEPTH]; // open ones
+	u32 depth;
+};
+
+#if defined(PROF_DISABLE)
+#define PROF_BEGIN(name) ((void)0)
+#define PROF_END()       ((void)0)
+#else
+#define PROF_BEGIN(name) ProfBegin(name)
+#define PROF_END()       ProfEnd()
+#endif
+
+// ProfBegin : opens a zone on this thread (name has to be a literal, or live as long as the program)
+void ProfBegin(const char *name);
+
+// ProfEnd : closes this thread's innermost zone
+void ProfEnd(void);
+
+// ProfThreadName : names this thread, in the trace
+void ProfThreadName(const char *name);
+
+// ProfDump : writes the last seconds of every thread's zones to path, as Chrome trace json
+s32 ProfDump(char *path, f64 seconds);
+
+// ProfFree : frees every thread's ring
+void ProfFree(void);
+
+#endif // PROF_H
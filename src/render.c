@@ -0,0 +1,323 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-09 14:12:40
+ *
+ * Render Command Buffer
+ */
+
+#include "common.h"
+
+#include "render.h"
+
+static struct rbackend_t gBackend;
+
+#define RKEY_LAYER_SHIFT   (56)
+#define RKEY_TEXTURE_SHIFT (40)
+#define RKEY_COLOR_SHIFT   (16)
+
+// RenderMakeKey : packs the sort key for a command
+static u64 RenderMakeKey(s32 layer, struct asset_t *asset, struct color_t color)
+{
+	u64 key;
+	u64 texid;
+
+	// NOTE (Brian) ids go in manifest order, so that's the order different sprites stack in inside
+	// of a layer. The ship's guns and thruster only draw over the hull because they come after it
+	// in assets/manifest.txt
+	texid = (u64)(asset->id + 1);
+
+	key = 0;
+	key |= ((u64)layer & 0xff) << RKEY_LAYER_SHIFT;
+	key |= (texid & 0xffff) << RKEY_TEXTURE_SHIFT;
+	key |= ((u64)color.r << 16 | (u64)color.g << 8 | (u64)color.b) << RKEY_COLOR_SHIFT;
+
+	return key;
+}
+
+// RenderCmdPush : reserves the next command in the buffer
+static struct rcmd_t *RenderCmdPush(struct rcmdbuf_t *buf)
+{
+	struct rcmd_t *cmd;
+
+	C_RESIZE(&buf->cmds);
+
+	cmd = buf->cmds + buf->cmds_len++;
+
+	memset(cmd, 0, sizeof(*cmd));
+
+	return cmd;
+}
+
+// RenderCmdSprite : appends a sprite draw; dst == NULL covers the whole screen
+void RenderCmdSprite(struct rcmdbuf_t *buf, s32 layer, struct asset_t *asset, SDL_Rect *dst, f32 angle, struct color_t mod)
+{
+	struct rcmd_t *cmd;
+
+	assert(buf);
+	assert(asset);
+
+	cmd = RenderCmdPush(buf);
+
+	cmd->type = dst ? RCMD_SPRITE : RCMD_SPRITE_FULL;
+	cmd->asset = asset;
+	cmd->angle = angle;
+	cmd->color = mod;
+
+	if (dst) {
+		cmd->dst = *dst;
+	}
+
+	cmd->key = RenderMakeKey(layer, asset, mod);
+}
+
+// RenderCmdAppend : moves all of the commands in src to the end of dst, and resets src
+void RenderCmdAppend(struct rcmdbuf_t *dst, struct rcmdbuf_t *src)
+{
+	assert(dst);
+	assert(src);
+
+	if (src->cmds_len == 0)
+		return;
+
+	C_RESERVE(&dst->cmds, dst->cmds_len + src->cmds_len);
+
+	memcpy(dst->cmds + dst->cmds_len, src->cmds, src->cmds_len * sizeof(*src->cmds));
+	dst->cmds_len += src->cmds_len;
+
+	RenderCmdReset(src);
+}
+
+// rsortkey_t : what the radix sort actually moves around, instead of whole commands
+struct rsortkey_t {
+	u64 key;
+	size_t idx;
+};
+
+// RenderCmdSort : sorts the commands by key (the scratch comes out of arena)
+void RenderCmdSort(struct rcmdbuf_t *buf, struct arena_t *arena)
+{
+	struct rsortkey_t *a, *b;
+	struct rcmd_t *cmds;
+	u32 counts[8][256], sum, t;
+	size_t i, n;
+	s32 pass, digit;
+
+	assert(buf);
+	assert(arena);
+
+	n = buf->cmds_len;
+	if (n < 2)
+		return;
+
+	// NOTE (Brian) lots of commands share a key, and they have to come out in the order they were
+	// submitted in. Each LSD pass is stable and carries idx along, so ties stay in index order
+	a = ARENA_ARRAY(arena, struct rsortkey_t, n);
+	b = ARENA_ARRAY(arena, struct rsortkey_t, n);
+
+	memset(counts, 0, sizeof counts);
+
+	for (i = 0; i < n; i++) {
+		a[i].key = buf->cmds[i].key;
+		a[i].idx = i;
+
+		for (pass = 0; pass < 8; pass++) {
+			counts[pass][(a[i].key >> (pass * 8)) & 0xff]++;
+		}
+	}
+
+	for (pass = 0; pass < 8; pass++) {
+		// every key has the same byte here (most of the color and texture bytes), nothing to do
+		if (counts[pass][(a[0].key >> (pass * 8)) & 0xff] == n)
+			continue;
+
+		for (digit = 0, sum = 0; digit < 256; digit++) {
+			t = counts[pass][digit];
+			counts[pass][digit] = sum;
+			sum += t;
+		}
+
+		for (i = 0; i < n; i++) {
+			b[counts[pass][(a[i].key >> (pass * 8)) & 0xff]++] = a[i];
+		}
+
+		SWAP(a, b, struct rsortkey_t *);
+	}
+
+	cmds = ARENA_ARRAY(arena, struct rcmd_t, n);
+
+	for (i = 0; i < n; i++) {
+		cmds[i] = buf->cmds[a[i].idx];
+	}
+
+	memcpy(buf->cmds, cmds, n * sizeof(*cmds));
+}
+
+// RenderSDLExecute : submits the (sorted) commands to SDL, minimizing state changes
+static void RenderSDLExecute(void *ctx, struct rcmdbuf_t *buf)
+{
+	SDL_Renderer *renderer;
+	struct rcmd_t *cmd;
+	size_t i;
+
+	assert(buf);
+
+	renderer = ctx;
+
+	memset(&buf->stats, 0, sizeof(buf->stats));
+
+	buf->stats.cmds = buf->cmds_len;
+
+	for (i = 0; i < buf->cmds_len; i++) {
+		cmd = buf->cmds + i;
+
+		switch (cmd->type) {
+			case RCMD_SPRITE:
+			case RCMD_SPRITE_FULL:
+			{
+				struct asset_t *asset;
+				u32 colormod;
+
+				asset = cmd->asset;
+				colormod = (u32)cmd->color.r << 16 | (u32)cmd->color.g << 8 | (u32)cmd->color.b;
+
+				// color mod is per-texture state in SDL, so only set it when it's different
+				if (asset->colormod != colormod) {
+					asset->colormod = colormod;
+					SDL_SetTextureColorMod(asset->texture, cmd->color.r, cmd->color.g, cmd->color.b);
+					buf->stats.state_changes++;
+				}
+
+				if (cmd->type == RCMD_SPRITE_FULL) {
+					SDL_RenderCopy(renderer, asset->texture, NULL, NULL);
+				} else {
+					SDL_RenderCopyEx(renderer, asset->texture, NULL, &cmd->dst, cmd->angle, NULL, SDL_FLIP_NONE);
+				}
+
+				buf->stats.draws++;
+
+				break;
+			}
+
+			default:
+			{
+				assert(0);
+			}
+		}
+	}
+}
+
+// RenderSDLClear : clears the screen with SDL
+static void RenderSDLClear(void *ctx, struct color_t color)
+{
+	SDL_SetRenderDrawColor(ctx, color.r, color.g, color.b, color.a);
+	SDL_RenderClear(ctx);
+}
+
+// RenderSDLDrawRects : draws rect outlines with SDL
+static void RenderSDLDrawRects(void *ctx, SDL_Rect *rects, s32 n, struct color_t color)
+{
+	SDL_SetRenderDrawColor(ctx, color.r, color.g, color.b, color.a);
+	SDL_RenderDrawRects(ctx, rects, n);
+}
+
+// RenderSDLDrawLines : draws a line strip with SDL
+static void RenderSDLDrawLines(void *ctx, SDL_Point *points, s32 n, struct color_t color)
+{
+	SDL_SetRenderDrawColor(ctx, color.r, color.g, color.b, color.a);
+	SDL_RenderDrawLines(ctx, points, n);
+}
+
+// RenderSDLPresent : presents with SDL
+static void RenderSDLPresent(void *ctx)
+{
+	SDL_RenderPresent(ctx);
+}
+
+// RenderBackendSDL : fills out a backend that draws with SDL's renderer
+void RenderBackendSDL(struct rbackend_t *backend, SDL_Renderer *renderer)
+{
+	assert(backend);
+
+	memset(backend, 0, sizeof(*backend));
+
+	backend->name = "sdl";
+	backend->ctx = renderer;
+	backend->Clear = RenderSDLClear;
+	backend->Execute = RenderSDLExecute;
+	backend->DrawRects = RenderSDLDrawRects;
+	backend->DrawLines = RenderSDLDrawLines;
+	backend->Present = RenderSDLPresent;
+}
+
+// RenderSetBackend : routes all of the drawing below to the given backend (copied)
+void RenderSetBackend(struct rbackend_t *backend)
+{
+	assert(backend);
+
+	gBackend = *backend;
+}
+
+// RenderGetBackend : returns the active backend
+struct rbackend_t *RenderGetBackend(void)
+{
+	return &gBackend;
+}
+
+// RenderClear : clears the whole screen to the color
+void RenderClear(struct color_t color)
+{
+	gBackend.Clear(gBackend.ctx, color);
+}
+
+// RenderCmdExecute : submits the (sorted) commands to the backend
+void RenderCmdExecute(struct rcmdbuf_t *buf)
+{
+	assert(buf);
+
+	gBackend.Execute(gBackend.ctx, buf);
+}
+
+// RenderDrawRects : draws rect outlines, immediately
+void RenderDrawRects(SDL_Rect *rects, s32 n, struct color_t color)
+{
+	gBackend.DrawRects(gBackend.ctx, rects, n, color);
+}
+
+// RenderDrawLines : draws a connected line strip, immediately
+void RenderDrawLines(SDL_Point *points, s32 n, struct color_t color)
+{
+	gBackend.DrawLines(gBackend.ctx, points, n, color);
+}
+
+// RenderPresent : shows the finished frame
+void RenderPresent(void)
+{
+	gBackend.Present(gBackend.ctx);
+}
+
+// RenderCmdReset : empties the buffer, keeping the allocation around for the next frame
+void RenderCmdReset(struct rcmdbuf_t *buf)
+{
+	assert(buf);
+
+	buf->cmds_len = 0;
+}
+
+// RenderCmdFree : releases the buffer's memory
+void RenderCmdFree(struct rcmdbuf_t *buf)
+{
+	assert(buf);
+
+	C_FREE(buf->cmds);
+
+	buf->cmds = NULL;
+	buf->cmds_len = buf->cmds_cap = 0;
+}
+
+// UtilMakeColor : returns a color
+struct color_t UtilMakeColor(u8 r, u8 g, u8 b, u8 a)
+{
+	struct color_t c = { r, g, b, a };
+	return c;
+}
+
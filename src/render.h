@@ -0,0 +1,138 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-09 14:12:40
+ *
+ * Render Command Buffer
+ *
+ * The Render* functions don't talk to SDL directly. They append compact commands to a per-frame
+ * command buffer, the buffer gets sorted by a 64-bit key, and the executor walks the sorted list
+ * and only pokes SDL when the state actually changes.
+ *
+ * The key is laid out so the sort groups things the way the renderer wants them:
+ *
+ *    63      56 55            40 39                    16 15             0
+ *   +----------+----------------+------------------------+----------------+
+ *   |  layer   |   texture id   |   color mod (r, g, b)  |     unused     |
+ *   +----------+----------------+------------------------+----------------+
+ *
+ * Layers always draw in order. Inside of a layer, everything that uses the same texture and the
+ * same color mod sits next to each other. Plenty of commands share a key, and those keep the
+ * order they were submitted in, because the sort is stable (it breaks ties on the index).
+ *
+ * Command buffers don't share anything, so a worker thread can fill its own buffer, and the main
+ * thread can RenderCmdAppend it into the frame's buffer before sorting. Appended in the order the
+ * work was split up, the frame comes out the same as if one thread had recorded all of it.
+ *
+ * BACKENDS
+ *
+ * Nothing outside of this module knows what actually draws the commands. RenderClear,
+ * RenderCmdExecute, RenderDrawRects, RenderDrawLines, and RenderPresent all go through whatever
+ * backend was handed to RenderSetBackend: SDL's renderer (below), or the CPU rasterizer in
+ * swrender.c.
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+#include "asset.h"
+#include "arena.h"
+
+struct color_t {
+	u8 r, g, b, a;
+};
+
+enum {
+	RLAYER_BACKGROUND,
+	RLAYER_ASTEROID,
+	RLAYER_PLAYER,
+	RLAYER_BULLET,
+	RLAYER_UI,
+	RLAYER_DEBUG,
+	RLAYER_TOTAL
+};
+
+enum {
+	RCMD_SPRITE,      // textured quad, rotated about its center
+	RCMD_SPRITE_FULL, // textured quad covering the whole logical screen
+	RCMD_TOTAL
+};
+
+struct rcmd_t {
+	u64 key;
+	struct asset_t *asset;
+	SDL_Rect dst;
+	f32 angle; // degrees, clockwise
+	struct color_t color;
+	u8 type;
+};
+
+struct rstats_t {
+	s32 cmds;
+	s32 draws;
+	s32 state_changes;
+};
+
+struct rcmdbuf_t {
+	struct rcmd_t *cmds;
+	size_t cmds_len, cmds_cap;
+	struct rstats_t stats;
+};
+
+struct rbackend_t {
+	char *name;
+	void *ctx;
+	void (*Clear)(void *ctx, struct color_t color);
+	void (*Execute)(void *ctx, struct rcmdbuf_t *buf);
+	void (*DrawRects)(void *ctx, SDL_Rect *rects, s32 n, struct color_t color);
+	void (*DrawLines)(void *ctx, SDL_Point *points, s32 n, struct color_t color);
+	void (*Present)(void *ctx);
+};
+
+// RenderCmdSprite : appends a sprite draw; dst == NULL covers the whole screen
+void RenderCmdSprite(struct rcmdbuf_t *buf, s32 layer, struct asset_t *asset, SDL_Rect *dst, f32 angle, struct color_t mod);
+
+// RenderCmdAppend : moves all of the commands in src to the end of dst, and resets src
+void RenderCmdAppend(struct rcmdbuf_t *dst, struct rcmdbuf_t *src);
+
+// RenderCmdSort : sorts the commands by key (the scratch comes out of arena)
+void RenderCmdSort(struct rcmdbuf_t *buf, struct arena_t *arena);
+
+// RenderCmdExecute : submits the (sorted) commands to the backend
+void RenderCmdExecute(struct rcmdbuf_t *buf);
+
+// RenderCmdReset : empties the buffer, keeping the allocation around for the next frame
+void RenderCmdReset(struct rcmdbuf_t *buf);
+
+// RenderCmdFree : releases the buffer's memory
+void RenderCmdFree(struct rcmdbuf_t *buf);
+
+// RenderSetBackend : routes all of the drawing below to the given backend (copied)
+void RenderSetBackend(struct rbackend_t *backend);
+
+// RenderGetBackend : returns the active backend
+struct rbackend_t *RenderGetBackend(void);
+
+// RenderBackendSDL : fills out a backend that draws with SDL's renderer
+void RenderBackendSDL(struct rbackend_t *backend, SDL_Renderer *renderer);
+
+// RenderClear : clears the whole screen to the color
+void RenderClear(struct color_t color);
+
+// RenderDrawRects : draws rect outlines, immediately
+void RenderDrawRects(SDL_Rect *rects, s32 n, struct color_t color);
+
+// RenderDrawLines : draws a connected line strip, immediately
+void RenderDrawLines(SDL_Point *points, s32 n, struct color_t color);
+
+// RenderPresent : shows the finished frame
+void RenderPresent(void);
+
+// UtilMakeColor : returns a color
+struct color_t UtilMakeColor(u8 r, u8 g, u8 b, u8 a);
+
+#endif // RENDER_H
+
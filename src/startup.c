@@ -0,0 +1,128 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-23 10:41:07
+ *
+ * Startup Profiler
+ */
+
+#include "common.h"
+
+#include "startup.h"
+
+// StartupMs : milliseconds since the performance counter said start
+static f64 StartupMs(u64 start)
+{
+	return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// StartupInit : starts the clock
+void StartupInit(struct startup_t *startup)
+{
+	assert(startup);
+
+	memset(startup, 0, sizeof(*startup));
+
+	// NOTE (Brian) the performance counter works before SDL_Init, so SDL_Init gets timed too
+	startup->start = SDL_GetPerformanceCounter();
+}
+
+// StartupBegin : opens a phase (inside whatever phase is open)
+void StartupBegin(struct startup_t *startup, char *name)
+{
+	struct startupphase_t *phase;
+
+	assert(startup);
+
+	if (startup->phases_len == STARTUP_PHASES || startup->open_len == STARTUP_PHASES) {
+		WRN("Too many startup phases, not timing '%s'\n", name);
+		return;
+	}
+
+	phase = startup->phases + startup->phases_len;
+
+	phase->name = name;
+	phase->depth = startup->open_len;
+	phase->start = SDL_GetPerformanceCounter();
+
+	startup->open[startup->open_len++] = startup->phases_len++;
+}
+
+// StartupEnd : closes the innermost open phase
+void StartupEnd(struct startup_t *startup)
+{
+	struct startupphase_t *phase;
+
+	assert(startup);
+
+	if (startup->open_len == 0)
+		return;
+
+	phase = startup->phases + startup->open[--startup->open_len];
+
+	phase->ms = StartupMs(phase->start);
+}
+
+// StartupAdd : records a phase that was timed somewhere else, inside the open phase
+void StartupAdd(struct startup_t *startup, char *name, f64 ms)
+{
+	struct startupphase_t *phase;
+
+	assert(startup);
+
+	if (startup->phases_len == STARTUP_PHASES)
+		return;
+
+	phase = startup->phases + startup->phases_len++;
+
+	phase->name = name;
+	phase->depth = startup->open_len;
+	phase->ms = ms;
+}
+
+// StartupFinish : stops the clock (call it when the first frame is out)
+void StartupFinish(struct startup_t *startup)
+{
+	assert(startup);
+
+	while (startup->open_len > 0) {
+		StartupEnd(startup);
+	}
+
+	startup->total_ms = StartupMs(startup->start);
+}
+
+// StartupReport : prints every phase, and the total
+void StartupReport(struct startup_t *startup, FILE *fp)
+{
+	struct startupphase_t *phase;
+	s32 i;
+
+	assert(startup);
+	assert(fp);
+
+	fprintf(fp, "%-32s %10s\n", "phase", "ms");
+
+	for (i = 0; i < startup->phases_len; i++) {
+		phase = startup->phases + i;
+		fprintf(fp, "%*s%-*s %10.3f\n", phase->depth * 2, "", 32 - phase->depth * 2, phase->name, phase->ms);
+	}
+
+	fprintf(fp, "%-32s %10.3f\n", "first frame", startup->total_ms);
+}
+
+// StartupSubsystem : brings up the SDL subsystems that aren't up yet, returns -1 if it can't
+s32 StartupSubsystem(u32 subsystems)
+{
+	u32 missing;
+
+	missing = subsystems & ~SDL_WasInit(subsystems);
+	if (missing == 0)
+		return 0;
+
+	if (SDL_InitSubSystem(missing) < 0) {
+		ERR("Couldn't initialize SDL subsystems 0x%x: %s\n", missing, SDL_GetError());
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-23 10:41:07
+ *
+ * Startup Profiler
+ *
+ * Times the phases of startup (SDL, the window, the renderer, the assets, ...), up to the first
+ * frame, so there's a number to look at when startup gets slow. Phases nest:
+ *
+ *   StartupBegin(&startup, "assets");
+ *       StartupBegin(&startup, "manifest");
+ *       StartupEnd(&startup);
+ *   StartupEnd(&startup);
+ *
+ * StartupAdd records something that was timed somewhere else (a decode on the job pool) as a child
+ * of the open phase.
+ *
+ * SDL subsystems come up here too, the first time something asks for them with StartupSubsystem,
+ * instead of all at once with SDL_INIT_EVERYTHING. Audio, haptics, joysticks and sensors cost time
+ * on every launch, and most runs never touch them.
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+#define STARTUP_PHASES (64)
+
+struct startupphase_t {
+	char *name;
+	f64 ms;
+	s32 depth;
+	u64 start; // performance counter, while it's open
+};
+
+struct startup_t {
+	struct startupphase_t phases[STARTUP_PHASES];
+	s32 phases_len;
+	s32 open[STARTUP_PHASES]; // stack of open phases
+	s32 open_len;
+	u64 start;
+	f64 total_ms; // to the first frame, once StartupFinish is called
+};
+
+// StartupInit : starts the clock
+void StartupInit(struct startup_t *startup);
+
+// StartupBegin : opens a phase (inside whatever phase is open)
+void StartupBegin(struct startup_t *startup, char *name);
+
+// StartupEnd : closes the innermost open phase
+void StartupEnd(struct startup_t *startup);
+
+// StartupAdd : records a phase that was timed somewhere else, inside the open phase
+void StartupAdd(struct startup_t *startup, char *name, f64 ms);
+
+// StartupFinish : stops the clock (call it when the first frame is out)
+void StartupFinish(struct startup_t *startup);
+
+// StartupReport : prints every phase, and the total
+void StartupReport(struct startup_t *startup, FILE *fp);
+
+// StartupSubsystem : brings up the SDL subsystems that aren't up yet, returns -1 if it can't
+s32 StartupSubsystem(u32 subsystems);
+
+#endif // STARTUP_H
@@ -0,0 +1,473 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-24 14:20:33
+ *
+ * Streaming Reads
+ */
+
+#include "common.h"
+
+#include "stream.h"
+
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define STREAM_HAS_URING
+#endif
+
+// streamread_t : one file on its way in
+struct streamread_t {
+	struct streamreq_t req;
+	streamfunc_t func;
+	u8 *buf;
+	size_t got;
+	int fd;
+#if defined(STREAM_HAS_URING)
+	struct iovec iov;
+#endif
+};
+
+static char *stream_names[] = {
+	"none", "auto", "uring", "pool"
+};
+
+// StreamDone : hands a finished read to func (a failed one gets a NULL buffer)
+static void StreamDone(struct streamread_t *read, s32 ok, s32 worker)
+{
+	if (!ok) {
+		C_FREE(read->buf);
+		read->buf = NULL;
+		read->got = 0;
+	}
+
+	read->func(read->req.arg, read->buf, read->got, worker);
+}
+
+// StreamPreadJob : reads one whole file, on a pool worker
+static void StreamPreadJob(void *arg, s32 worker)
+{
+	struct streamread_t *read;
+	s32 ok;
+
+	read = arg;
+
+	// NOTE (Brian) the + 1 is so an empty file still gets a buffer
+	read->buf = C_ALLOC(MEM_IO, read->req.size + 1);
+
+	ok = 0;
+
+#if defined(_WIN32)
+	{
+		FILE *fp;
+
+		fp = fopen(read->req.path, "rb");
+		if (fp && read->buf) {
+			read->got = fread(read->buf, 1, read->req.size, fp);
+			ok = read->got == read->req.size;
+		}
+
+		if (fp)
+			fclose(fp);
+	}
+#else
+	{
+		ssize_t n;
+
+		read->fd = open(read->req.path, O_RDONLY | O_CLOEXEC);
+		if (read->fd >= 0 && read->buf) {
+			while (read->got < read->req.size) {
+				n = pread(read->fd, read->buf + read->got, read->req.size - read->got, read->got);
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n <= 0)
+					break;
+				read->got += n;
+			}
+
+			ok = read->got == read->req.size;
+		}
+
+		if (read->fd >= 0)
+			close(read->fd);
+	}
+#endif
+
+	StreamDone(read, ok, worker);
+
+	C_FREE(read);
+}
+
+// StreamPool : queues every read up on the pool
+static void StreamPool(struct streamreq_t *reqs, s32 n, struct jobpool_t *pool, streamfunc_t func)
+{
+	struct streamread_t *read;
+	s32 i;
+
+	for (i = 0; i < n; i++) {
+		read = C_CALLOC(MEM_IO, 1, sizeof(*read));
+
+		read->req = reqs[i];
+		read->func = func;
+		read->fd = -1;
+
+		JobSubmit(pool, StreamPreadJob, read);
+	}
+}
+
+#if defined(STREAM_HAS_URING)
+
+// streamring_t : the bits of an io_uring we need (the kernel shares these with us)
+struct streamring_t {
+	int fd;
+	u32 entries;
+
+	u32 *sq_head, *sq_tail, *sq_mask, *sq_array;
+	struct io_uring_sqe *sqes;
+
+	u32 *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	u8 *sq_ptr, *cq_ptr;
+	size_t sq_size, cq_size, sqes_size;
+};
+
+// streambatch_t : everything the io_uring thread owns
+struct streambatch_t {
+	struct streamring_t ring;
+	struct streamread_t *reads;
+	s32 n;
+};
+
+// StreamRingFree : unmaps and closes the ring
+static void StreamRingFree(struct streamring_t *ring)
+{
+	if (ring->sqes)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr)
+		munmap(ring->cq_ptr, ring->cq_size);
+	if (ring->sq_ptr)
+		munmap(ring->sq_ptr, ring->sq_size);
+	if (ring->fd >= 0)
+		close(ring->fd);
+
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+}
+
+// StreamRingInit : sets up a ring with room for (at least) entries reads
+static s32 StreamRingInit(struct streamring_t *ring, u32 entries)
+{
+	struct io_uring_params p;
+	void *ptr;
+
+	memset(ring, 0, sizeof(*ring));
+	memset(&p, 0, sizeof p);
+
+	ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if (ring->fd < 0)
+		return -1;
+
+	ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(u32);
+	ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+	// newer kernels put both rings in one mapping
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->sq_size = ring->cq_size = MAX(ring->sq_size, ring->cq_size);
+	}
+
+	ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ptr == MAP_FAILED)
+		goto fail;
+	ring->sq_ptr = ptr;
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->cq_ptr = ring->sq_ptr;
+	} else {
+		ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if (ptr == MAP_FAILED)
+			goto fail;
+		ring->cq_ptr = ptr;
+	}
+
+	ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	ptr = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ptr == MAP_FAILED)
+		goto fail;
+	ring->sqes = ptr;
+
+	ring->sq_head  = (u32 *)(ring->sq_ptr + p.sq_off.head);
+	ring->sq_tail  = (u32 *)(ring->sq_ptr + p.sq_off.tail);
+	ring->sq_mask  = (u32 *)(ring->sq_ptr + p.sq_off.ring_mask);
+	ring->sq_array = (u32 *)(ring->sq_ptr + p.sq_off.array);
+
+	ring->cq_head = (u32 *)(ring->cq_ptr + p.cq_off.head);
+	ring->cq_tail = (u32 *)(ring->cq_ptr + p.cq_off.tail);
+	ring->cq_mask = (u32 *)(ring->cq_ptr + p.cq_off.ring_mask);
+	ring->cqes    = (struct io_uring_cqe *)(ring->cq_ptr + p.cq_off.cqes);
+
+	ring->entries = p.sq_entries;
+
+	return 0;
+
+fail:
+	StreamRingFree(ring);
+	return -1;
+}
+
+// StreamRingRead : queues a read of whatever's left of the file (it goes in on the next enter)
+static void StreamRingRead(struct streamring_t *ring, struct streamread_t *read)
+{
+	struct io_uring_sqe *sqe;
+	u32 tail, idx;
+
+	// we're the only one writing the tail, the kernel only reads it
+	tail = *ring->sq_tail;
+	idx = tail & *ring->sq_mask;
+
+	read->iov.iov_base = read->buf + read->got;
+	read->iov.iov_len = read->req.size - read->got;
+
+	// NOTE (Brian) READV instead of READ, it's been around since the first io_uring kernel (5.1)
+	sqe = ring->sqes + idx;
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = read->fd;
+	sqe->addr = (u64)(uintptr_t)&read->iov;
+	sqe->len = 1;
+	sqe->off = read->got;
+	sqe->user_data = (u64)(uintptr_t)read;
+
+	ring->sq_array[idx] = idx;
+
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// StreamUringThread : keeps the ring full, and hands off completions as they come in
+static int StreamUringThread(void *arg)
+{
+	struct streambatch_t *batch;
+	struct streamring_t *ring;
+	struct streamread_t *read;
+	struct io_uring_cqe *cqe;
+	u32 head, tail, submit, inflight;
+	s32 next, res, i;
+	int rc;
+
+	batch = arg;
+	ring = &batch->ring;
+
+	next = 0;
+	submit = inflight = 0;
+
+	while (next < batch->n || inflight > 0) {
+		// top the ring up, the buffers were sized from the stat, so it's one read per file
+		while (next < batch->n && inflight < ring->entries) {
+			read = batch->reads + next++;
+
+			read->fd = open(read->req.path, O_RDONLY | O_CLOEXEC);
+			read->buf = C_ALLOC(MEM_IO, read->req.size + 1);
+
+			if (read->fd < 0 || read->buf == NULL) {
+				if (read->fd >= 0)
+					close(read->fd);
+				StreamDone(read, 0, -1);
+				continue;
+			}
+
+			StreamRingRead(ring, read);
+			submit++;
+			inflight++;
+		}
+
+		if (inflight == 0)
+			break;
+
+		rc = (int)syscall(__NR_io_uring_enter, ring->fd, submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (rc < 0) {
+			if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+				continue;
+
+			// NOTE (Brian) the kernel might still have some of these buffers, so they leak
+			// instead of getting freed out from under it
+			ERR("io_uring_enter failed: %s\n", strerror(errno));
+			StreamRingFree(ring);
+
+			for (i = 0; i < batch->n; i++) {
+				read = batch->reads + i;
+				if (read->fd >= 0 && read->buf) {
+					close(read->fd);
+					read->func(read->req.arg, NULL, 0, -1);
+				}
+			}
+
+			for (; next < batch->n; next++) {
+				batch->reads[next].func(batch->reads[next].req.arg, NULL, 0, -1);
+			}
+
+			break;
+		}
+
+		submit -= rc;
+
+		head = *ring->cq_head;
+		tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+		for (; head != tail; head++) {
+			cqe = ring->cqes + (head & *ring->cq_mask);
+
+			read = (struct streamread_t *)(uintptr_t)cqe->user_data;
+			res = cqe->res;
+
+			// give the slot back before handing anything off
+			__atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+			inflight--;
+
+			if (res > 0) {
+				read->got += res;
+			}
+
+			// short reads (and interrupted ones) go around again for the rest
+			if ((res > 0 && read->got < read->req.size) || res == -EAGAIN || res == -EINTR) {
+				StreamRingRead(ring, read);
+				submit++;
+				inflight++;
+				continue;
+			}
+
+			close(read->fd);
+			read->fd = -1;
+
+			StreamDone(read, res >= 0 && read->got == read->req.size, -1);
+		}
+	}
+
+	StreamRingFree(ring);
+
+	C_FREE(batch->reads);
+	C_FREE(batch);
+
+	return 0;
+}
+
+// StreamUring : hands every read to a new io_uring thread, -1 if we can't get a ring
+static s32 StreamUring(struct streamreq_t *reqs, s32 n, streamfunc_t func)
+{
+	struct streambatch_t *batch;
+	SDL_Thread *thread;
+	s32 i;
+
+	batch = C_CALLOC(MEM_IO, 1, sizeof(*batch));
+
+	if (StreamRingInit(&batch->ring, MIN(n, STREAM_RING_ENTRIES)) < 0) {
+		C_FREE(batch);
+		return -1;
+	}
+
+	batch->n = n;
+	batch->reads = C_CALLOC(MEM_IO, n, sizeof(*batch->reads));
+
+	for (i = 0; i < n; i++) {
+		batch->reads[i].req = reqs[i];
+		batch->reads[i].func = func;
+		batch->reads[i].fd = -1;
+	}
+
+	thread = SDL_CreateThread(StreamUringThread, "stream", batch);
+	if (thread == NULL) {
+		ERR("Couldn't create the stream thread: %s\n", SDL_GetError());
+		StreamRingFree(&batch->ring);
+		C_FREE(batch->reads);
+		C_FREE(batch);
+		return -1;
+	}
+
+	// it cleans up after itself
+	SDL_DetachThread(thread);
+
+	return 0;
+}
+
+#else
+
+// StreamUring : hands every read to a new io_uring thread, -1 if we can't get a ring
+static s32 StreamUring(struct streamreq_t *reqs, s32 n, streamfunc_t func)
+{
+	return -1;
+}
+
+#endif
+
+// StreamRead : starts reading every file in reqs, returns the backend that took them (-1 on error)
+s32 StreamRead(struct streamreq_t *reqs, s32 n, struct jobpool_t *pool, streamfunc_t func, s32 backend)
+{
+	assert(reqs || n == 0);
+	assert(pool);
+	assert(func);
+
+	if (backend <= STREAM_NONE || backend >= STREAM_TOTAL)
+		return -1;
+
+	if (n <= 0)
+		return backend;
+
+	if (backend == STREAM_AUTO || backend == STREAM_URING) {
+		if (StreamUring(reqs, n, func) == 0)
+			return STREAM_URING;
+
+		if (backend == STREAM_URING) {
+			WRN("io_uring isn't available, reading on the job pool\n");
+		}
+	}
+
+	StreamPool(reqs, n, pool, func);
+
+	return STREAM_POOL;
+}
+
+// StreamBackendName : returns a printable name for a STREAM_* value
+char *StreamBackendName(s32 backend)
+{
+	if (backend < 0 || backend >= STREAM_TOTAL)
+		return "unknown";
+
+	return stream_names[backend];
+}
+
+// StreamBackendFromName : STREAM_* from a name, -1 if it isn't one
+s32 StreamBackendFromName(char *name)
+{
+	s32 i;
+
+	for (i = 0; i < STREAM_TOTAL; i++) {
+		if (streq(stream_names[i], name))
+			return i;
+	}
+
+	return -1;
+}
+
+// StreamEvict : drops a file from the page cache, so the next read really goes to the disk
+void StreamEvict(char *path)
+{
+#if defined(__linux__)
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	// clean pages just go, which is all a freshly read sprite has
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+
+	close(fd);
+#endif
+}
@@ -0,0 +1,61 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-24 14:20:33
+ *
+ * Streaming Reads
+ *
+ * Reads a batch of whole files into buffers sized up front (the caller already stat'd them), and
+ * calls func as each one finishes, so it can be handed to a decoder while the rest are still
+ * coming in. There are two ways to do it:
+ *
+ *   STREAM_URING  every read goes into one io_uring submission, and a thread reaps the
+ *                 completions (Linux only, raw syscalls, no liburing)
+ *   STREAM_POOL   every read is a job on the pool, doing a pread
+ *
+ * STREAM_AUTO tries io_uring first, and falls back to the pool if the kernel won't give us a ring
+ * (too old, or turned off with the io_uring_disabled sysctl).
+ *
+ * func gets the worker that did the read, or -1 when it wasn't a pool worker (the io_uring thread),
+ * so the pool path can decode right where the read finished. A read that fails gets a NULL buf.
+ * The buffer belongs to func.
+ */
+
+#include "common.h"
+
+#include "job.h"
+
+enum {
+	STREAM_NONE, // nobody streams, every decode reads its own file
+	STREAM_AUTO,
+	STREAM_URING,
+	STREAM_POOL,
+	STREAM_TOTAL
+};
+
+// how many reads the ring holds at once, bigger batches go through in waves
+#define STREAM_RING_ENTRIES (256)
+
+typedef void (*streamfunc_t)(void *arg, u8 *buf, size_t size, s32 worker);
+
+struct streamreq_t {
+	char *path;
+	size_t size;
+	void *arg;
+};
+
+// StreamRead : starts reading every file in reqs, returns the backend that took them (-1 on error)
+s32 StreamRead(struct streamreq_t *reqs, s32 n, struct jobpool_t *pool, streamfunc_t func, s32 backend);
+
+// StreamBackendName : returns a printable name for a STREAM_* value
+char *StreamBackendName(s32 backend);
+
+// StreamBackendFromName : STREAM_* from a name, -1 if it isn't one
+s32 StreamBackendFromName(char *name);
+
+// StreamEvict : drops a file from the page cache, so the next read really goes to the disk
+void StreamEvict(char *path);
+
+#endif // STREAM_H
@@ -0,0 +1,543 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-12 00:18:33
+ *
+ * Software Renderer
+ */
+
+#include "common.h"
+
+#include <math.h>
+
+#include "swrender.h"
+#include "prof.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SW_SSE2
+#include <emmintrin.h>
+#endif
+
+// NOTE (Brian) pixels are RGBA in memory order, so on a little endian machine, the packed u32 is
+// 0xAABBGGRR, which is what SW_PACK builds.
+#define SW_PACK(r, g, b, a) ((u32)(r) | (u32)(g) << 8 | (u32)(b) << 16 | (u32)(a) << 24)
+#define SW_R(p) (((p) >>  0) & 0xff)
+#define SW_G(p) (((p) >>  8) & 0xff)
+#define SW_B(p) (((p) >> 16) & 0xff)
+#define SW_A(p) (((p) >> 24) & 0xff)
+
+// SWDiv255 : x / 255, rounded, for x in [0, 255 * 255]
+static u32 SWDiv255(u32 x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+#if defined(SW_SSE2)
+// SWDiv255x8 : SWDiv255, on eight 16-bit lanes
+static __m128i SWDiv255x8(__m128i x)
+{
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// SWBlend2 : blends two (premultiplied) pixels, unpacked to 16-bit lanes
+static __m128i SWBlend2(__m128i s, __m128i d, __m128i mod)
+{
+	__m128i ia;
+
+	// color mod first, alpha's mod is always 255
+	s = SWDiv255x8(_mm_mullo_epi16(s, mod));
+
+	// broadcast each pixel's (inverse) alpha to all four of its lanes
+	ia = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+	ia = _mm_shufflehi_epi16(ia, _MM_SHUFFLE(3, 3, 3, 3));
+	ia = _mm_sub_epi16(_mm_set1_epi16(255), ia);
+
+	// src factor is 1 for every channel, so the alpha channel ends up as a + da * (1 - a)
+	return _mm_add_epi16(s, SWDiv255x8(_mm_mullo_epi16(d, ia)));
+}
+#endif
+
+// SWBlendPixel : blends one premultiplied src pixel over one dst pixel, with the color mod applied to src
+static u32 SWBlendPixel(u32 d, u32 s, struct color_t mod)
+{
+	u32 r, g, b, a, ia;
+
+	a = SW_A(s);
+	if (a == 0)
+		return d;
+
+	ia = 255 - a;
+
+	r = SWDiv255(SW_R(s) * mod.r) + SWDiv255(SW_R(d) * ia);
+	g = SWDiv255(SW_G(s) * mod.g) + SWDiv255(SW_G(d) * ia);
+	b = SWDiv255(SW_B(s) * mod.b) + SWDiv255(SW_B(d) * ia);
+	a = a + SWDiv255(SW_A(d) * ia);
+
+	return SW_PACK(MIN(r, 255), MIN(g, 255), MIN(b, 255), MIN(a, 255));
+}
+
+// SWBlendRow : blends n src pixels over n dst pixels
+static void SWBlendRow(u32 *dst, u32 *src, s32 n, struct color_t mod)
+{
+	s32 i;
+
+	i = 0;
+
+#if defined(SW_SSE2)
+	{
+		__m128i zero, vmod, amask, s, d, lo, hi;
+
+		zero = _mm_setzero_si128();
+		vmod = _mm_set_epi16(255, mod.b, mod.g, mod.r, 255, mod.b, mod.g, mod.r);
+		amask = _mm_set1_epi32((s32)0xff000000);
+
+		for (; i + 4 <= n; i += 4) {
+			s = _mm_loadu_si128((__m128i *)(src + i));
+
+			// most of a sprite's bounding box is empty, skip it
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, amask), zero)) == 0xffff)
+				continue;
+
+			d = _mm_loadu_si128((__m128i *)(dst + i));
+
+			lo = SWBlend2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), vmod);
+			hi = SWBlend2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), vmod);
+
+			_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+		}
+	}
+#endif
+
+	for (; i < n; i++) {
+		dst[i] = SWBlendPixel(dst[i], src[i], mod);
+	}
+}
+
+// SWFetch : returns the texel at (x, y), or transparent black if it's off of the image
+static u32 SWFetch(u32 *texels, s32 w, s32 h, s32 x, s32 y)
+{
+	if (x < 0 || y < 0 || x >= w || y >= h)
+		return 0;
+	return texels[y * w + x];
+}
+
+// SWSampleBilinear : bilinear sample at (u, v) in texel space
+static u32 SWSampleBilinear(u32 *texels, s32 w, s32 h, f32 u, f32 v)
+{
+	u32 p00, p10, p01, p11;
+	u32 out, c, top, bot;
+	s32 x, y, fx, fy, shift;
+
+	u -= 0.5f;
+	v -= 0.5f;
+
+	x = (s32)floorf(u);
+	y = (s32)floorf(v);
+
+	// 8 bits of fraction is plenty for 8 bit channels
+	fx = (s32)((u - x) * 256);
+	fy = (s32)((v - y) * 256);
+
+	p00 = SWFetch(texels, w, h, x, y);
+	p10 = SWFetch(texels, w, h, x + 1, y);
+	p01 = SWFetch(texels, w, h, x, y + 1);
+	p11 = SWFetch(texels, w, h, x + 1, y + 1);
+
+	for (out = 0, shift = 0; shift < 32; shift += 8) {
+		top = ((p00 >> shift) & 0xff) * (256 - fx) + ((p10 >> shift) & 0xff) * fx;
+		bot = ((p01 >> shift) & 0xff) * (256 - fx) + ((p11 >> shift) & 0xff) * fx;
+		c = (top * (256 - fy) + bot * fy) >> 16;
+		out |= c << shift;
+	}
+
+	return out;
+}
+
+// SWDrawSprite : draws the part of a sprite command that lands in [y0, y1)
+static void SWDrawSprite(struct swrender_t *sw, struct swband_t *band, struct rcmd_t *cmd)
+{
+	struct asset_t *asset;
+	SDL_Rect dst;
+	u32 *texels;
+	f32 rad, c, s, cx, cy, hw, hh, ex, ey;
+	f32 sx, sy, dx, dy, u, v, du, dv;
+	s32 x0, x1, y0, y1, x, y, tx, ty;
+
+	asset = cmd->asset;
+	texels = asset->bytes;
+
+	// nothing to sample from (the cpu copy of the pixels is gone)
+	if (texels == NULL)
+		return;
+
+	if (cmd->type == RCMD_SPRITE_FULL) {
+		dst.x = dst.y = 0;
+		dst.w = sw->w;
+		dst.h = sw->h;
+		rad = 0;
+	} else {
+		dst = cmd->dst;
+		rad = cmd->angle * M_PI / 180;
+	}
+
+	if (dst.w <= 0 || dst.h <= 0)
+		return;
+
+	c = cosf(rad);
+	s = sinf(rad);
+
+	hw = dst.w / 2.0f;
+	hh = dst.h / 2.0f;
+	cx = dst.x + hw;
+	cy = dst.y + hh;
+
+	// the rotated rect's bounding box, clipped to the band
+	ex = fabsf(c) * hw + fabsf(s) * hh;
+	ey = fabsf(s) * hw + fabsf(c) * hh;
+
+	x0 = MAX(0, (s32)floorf(cx - ex));
+	x1 = MIN(sw->w, (s32)ceilf(cx + ex));
+	y0 = MAX(band->y0, (s32)floorf(cy - ey));
+	y1 = MIN(band->y1, (s32)ceilf(cy + ey));
+
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	sx = asset->w / (f32)dst.w;
+	sy = asset->h / (f32)dst.h;
+
+	// stepping one pixel right in the destination steps (du, dv) in the source
+	du =  c * sx;
+	dv = -s * sy;
+
+	for (y = y0; y < y1; y++) {
+		dx = x0 + 0.5f - cx;
+		dy = y + 0.5f - cy;
+
+		// undo the (clockwise) rotation, then scale into texel space
+		u = ( c * dx + s * dy + hw) * sx;
+		v = (-s * dx + c * dy + hh) * sy;
+
+		if (sw->filter == SWFILTER_BILINEAR) {
+			for (x = x0; x < x1; x++, u += du, v += dv) {
+				band->row[x - x0] = SWSampleBilinear(texels, asset->w, asset->h, u, v);
+			}
+		} else {
+			for (x = x0; x < x1; x++, u += du, v += dv) {
+				tx = (s32)floorf(u);
+				ty = (s32)floorf(v);
+				band->row[x - x0] = SWFetch(texels, asset->w, asset->h, tx, ty);
+			}
+		}
+
+		SWBlendRow(sw->pixels + y * sw->w + x0, band->row, x1 - x0, cmd->color);
+	}
+}
+
+// SWPutPixel : blends a single solid pixel, if it's on the screen and inside [y0, y1)
+static void SWPutPixel(struct swrender_t *sw, s32 x, s32 y, s32 y0, s32 y1, struct color_t color)
+{
+	u32 *p;
+
+	if (x < 0 || x >= sw->w || y < y0 || y >= y1)
+		return;
+
+	p = sw->pixels + y * sw->w + x;
+	// premultiplied white, which the color mod turns into the color
+	*p = SWBlendPixel(*p, SW_PACK(color.a, color.a, color.a, color.a), color);
+}
+
+// SWDrawRect : draws a rect outline, limited to rows [y0, y1)
+static void SWDrawRect(struct swrender_t *sw, SDL_Rect *rect, s32 y0, s32 y1, struct color_t color)
+{
+	s32 x, y;
+
+	if (rect->w <= 0 || rect->h <= 0)
+		return;
+
+	for (x = rect->x; x < rect->x + rect->w; x++) {
+		SWPutPixel(sw, x, rect->y, y0, y1, color);
+		if (rect->h > 1)
+			SWPutPixel(sw, x, rect->y + rect->h - 1, y0, y1, color);
+	}
+
+	for (y = MAX(rect->y + 1, y0); y < MIN(rect->y + rect->h - 1, y1); y++) {
+		SWPutPixel(sw, rect->x, y, y0, y1, color);
+		if (rect->w > 1)
+			SWPutPixel(sw, rect->x + rect->w - 1, y, y0, y1, color);
+	}
+}
+
+// SWDrawLine : bresenham, clipped per pixel
+static void SWDrawLine(struct swrender_t *sw, SDL_Point a, SDL_Point b, struct color_t color)
+{
+	s32 dx, dy, sx, sy, err, e2;
+
+	dx = abs(b.x - a.x);
+	dy = -abs(b.y - a.y);
+	sx = a.x < b.x ? 1 : -1;
+	sy = a.y < b.y ? 1 : -1;
+	err = dx + dy;
+
+	for (;;) {
+		SWPutPixel(sw, a.x, a.y, 0, sw->h, color);
+
+		if (a.x == b.x && a.y == b.y)
+			break;
+
+		e2 = 2 * err;
+		if (e2 >= dy) {
+			err += dy;
+			a.x += sx;
+		}
+		if (e2 <= dx) {
+			err += dx;
+			a.y += sy;
+		}
+	}
+}
+
+// SWBandJob : draws every command into one band of the framebuffer
+static void SWBandJob(void *arg, s32 worker)
+{
+	struct swband_t *band;
+	struct swrender_t *sw;
+	struct rcmd_t *cmd;
+	size_t i;
+
+	band = arg;
+	sw = band->sw;
+
+	PROF_BEGIN("SWBandJob");
+
+	band->row = ARENA_ARRAY(sw->pool ? JobScratch(sw->pool, worker) : &sw->scratch, u32, sw->w);
+
+	for (i = 0; i < sw->buf->cmds_len; i++) {
+		cmd = sw->buf->cmds + i;
+
+		switch (cmd->type) {
+			case RCMD_SPRITE:
+			case RCMD_SPRITE_FULL:
+				SWDrawSprite(sw, band, cmd);
+				break;
+
+			default:
+				assert(0);
+		}
+	}
+
+	PROF_END();
+}
+
+// SWRenderClear : fills the framebuffer with a color
+static void SWRenderClear(void *ctx, struct color_t color)
+{
+	struct swrender_t *sw;
+	u32 pixel;
+	s32 i;
+
+	sw = ctx;
+	pixel = SW_PACK(color.r, color.g, color.b, color.a);
+
+	for (i = 0; i < sw->w * sw->h; i++) {
+		sw->pixels[i] = pixel;
+	}
+}
+
+// SWRenderExecute : draws the command buffer, one job per band
+static void SWRenderExecute(void *ctx, struct rcmdbuf_t *buf)
+{
+	struct swrender_t *sw;
+	u64 start;
+	s32 j;
+
+	sw = ctx;
+
+	start = SDL_GetPerformanceCounter();
+
+	sw->buf = buf;
+
+	// there's no device state to change here, every command is just a draw
+	memset(&buf->stats, 0, sizeof(buf->stats));
+	buf->stats.cmds = buf->cmds_len;
+	buf->stats.draws = buf->cmds_len;
+
+	if (sw->pool) {
+		for (j = 0; j < sw->bands_len; j++) {
+			JobSubmitGroup(sw->pool, &sw->group, SWBandJob, sw->bands + j);
+		}
+		JobWaitGroup(sw->pool, &sw->group);
+	} else {
+		ArenaReset(&sw->scratch);
+		for (j = 0; j < sw->bands_len; j++) {
+			SWBandJob(sw->bands + j, 0);
+		}
+	}
+
+	sw->buf = NULL;
+
+	sw->execute_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+	sw->total_ms += sw->execute_ms;
+}
+
+// SWRenderDrawRects : draws rect outlines right now
+static void SWRenderDrawRects(void *ctx, SDL_Rect *rects, s32 n, struct color_t color)
+{
+	struct swrender_t *sw;
+	s32 i;
+
+	sw = ctx;
+
+	for (i = 0; i < n; i++) {
+		SWDrawRect(sw, rects + i, 0, sw->h, color);
+	}
+}
+
+// SWRenderDrawLines : draws a line strip right now
+static void SWRenderDrawLines(void *ctx, SDL_Point *points, s32 n, struct color_t color)
+{
+	struct swrender_t *sw;
+	s32 i;
+
+	sw = ctx;
+
+	for (i = 0; i + 1 < n; i++) {
+		SWDrawLine(sw, points[i], points[i + 1], color);
+	}
+}
+
+// SWRenderPresent : shows the frame in the window (if we have one), and dumps it (if asked)
+static void SWRenderPresent(void *ctx)
+{
+	struct swrender_t *sw;
+	char path[BUFSMALL];
+
+	sw = ctx;
+
+	if (sw->texture) {
+		SDL_UpdateTexture(sw->texture, NULL, sw->pixels, sw->w * sizeof(*sw->pixels));
+		SDL_RenderCopy(sw->renderer, sw->texture, NULL, NULL);
+		SDL_RenderPresent(sw->renderer);
+	}
+
+	if (sw->dumpdir) {
+		snprintf(path, sizeof path, "%s/frame_%06u.ppm", sw->dumpdir, sw->frame);
+		SWRenderDump(sw, path);
+	}
+
+	sw->frame++;
+}
+
+// SWRenderInit : sets up the framebuffer; pool and renderer can be NULL
+s32 SWRenderInit(struct swrender_t *sw, s32 w, s32 h, struct jobpool_t *pool, SDL_Renderer *renderer)
+{
+	struct swband_t *band;
+	s32 i, rows;
+
+	assert(sw);
+
+	memset(sw, 0, sizeof(*sw));
+
+	sw->w = w;
+	sw->h = h;
+	sw->pool = pool;
+
+	sw->pixels = C_CALLOC(MEM_RENDER, w * h, sizeof(*sw->pixels));
+	if (sw->pixels == NULL) {
+		ERR("Couldn't allocate a %dx%d framebuffer\n", w, h);
+		return -1;
+	}
+
+	rows = MAX(SW_BAND_ROWS, (h + SW_MAX_BANDS - 1) / SW_MAX_BANDS);
+
+	for (i = 0; i * rows < h; i++) {
+		band = sw->bands + sw->bands_len++;
+
+		band->sw = sw;
+		band->y0 = i * rows;
+		band->y1 = MIN(h, band->y0 + rows);
+	}
+
+	ArenaInit(&sw->scratch, "swrender", MEM_SCRATCH, 0, 0);
+
+	if (pool && JobGroupInit(&sw->group) < 0) {
+		return -1;
+	}
+
+	if (renderer) {
+		sw->renderer = renderer;
+		sw->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, w, h);
+		if (sw->texture == NULL) {
+			ERR("Couldn't create the software framebuffer texture: %s\n", SDL_GetError());
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+// SWRenderFree : releases the framebuffer
+void SWRenderFree(struct swrender_t *sw)
+{
+	assert(sw);
+
+	if (sw->texture)
+		SDL_DestroyTexture(sw->texture);
+
+	JobGroupFree(&sw->group);
+
+	ArenaFree(&sw->scratch);
+
+	C_FREE(sw->pixels);
+
+	memset(sw, 0, sizeof(*sw));
+}
+
+// SWRenderBackend : fills out a render backend that draws with this software renderer
+void SWRenderBackend(struct rbackend_t *backend, struct swrender_t *sw)
+{
+	assert(backend);
+	assert(sw);
+
+	memset(backend, 0, sizeof(*backend));
+
+	backend->name = "software";
+	backend->ctx = sw;
+	backend->Clear = SWRenderClear;
+	backend->Execute = SWRenderExecute;
+	backend->DrawRects = SWRenderDrawRects;
+	backend->DrawLines = SWRenderDrawLines;
+	backend->Present = SWRenderPresent;
+}
+
+// SWRenderDump : writes the framebuffer out to disk as a binary ppm
+s32 SWRenderDump(struct swrender_t *sw, char *path)
+{
+	FILE *fp;
+	u8 rgb[3];
+	s32 i;
+
+	assert(sw);
+	assert(path);
+
+	fp = fopen(path, "wb");
+	if (fp == NULL) {
+		ERR("Couldn't open '%s' for writing\n", path);
+		return -1;
+	}
+
+	fprintf(fp, "P6\n%d %d\n255\n", sw->w, sw->h);
+
+	for (i = 0; i < sw->w * sw->h; i++) {
+		rgb[0] = SW_R(sw->pixels[i]);
+		rgb[1] = SW_G(sw->pixels[i]);
+		rgb[2] = SW_B(sw->pixels[i]);
+		fwrite(rgb, 1, sizeof rgb, fp);
+	}
+
+	fclose(fp);
+
+	return 0;
+}
+
@@ -0,0 +1,87 @@
+#ifndef SWRENDER_H
+#define SWRENDER_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-12 00:18:33
+ *
+ * Software Renderer
+ *
+ * A render backend that doesn't need a GPU (or a window, or even a display). Commands get drawn
+ * into an RGBA framebuffer on the CPU, sampling sprites straight out of asset_t->bytes.
+ *
+ * The framebuffer is cut into horizontal bands, and each band is a job on the job pool. Every band
+ * walks the whole (sorted) command list, and only touches its own rows, so there's no locking and
+ * the output is the same no matter how many cores we have.
+ *
+ * Sprites are premultiplied alpha (see asset.h), so blending is src + dst * (1 - src alpha). It's
+ * SSE2 when we've got it, 4 pixels at a time, and plain C when we don't.
+ *
+ * When a renderer is handed to SWRenderInit, Present uploads the framebuffer to a streaming
+ * texture so you can watch it, otherwise the frame just sits in memory (and optionally gets
+ * written out to disk, as a ppm).
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+#include "render.h"
+#include "job.h"
+
+#define SW_MAX_BANDS  (64)
+#define SW_BAND_ROWS  (32)
+
+enum {
+	SWFILTER_NEAREST,
+	SWFILTER_BILINEAR,
+	SWFILTER_TOTAL
+};
+
+struct swrender_t;
+
+struct swband_t {
+	struct swrender_t *sw;
+	s32 y0, y1;  // [y0, y1)
+	u32 *row;    // scratch row of sampled source pixels (from the worker's arena, every frame)
+};
+
+struct swrender_t {
+	u32 *pixels; // RGBA8 in memory order, w * h
+	s32 w, h;
+
+	s32 filter; // SWFILTER_*
+
+	struct jobpool_t *pool;
+	struct jobgroup_t group; // the bands, so Execute doesn't wait on anything else in the pool
+	struct arena_t scratch;  // for the rows, when there's no pool
+
+	struct swband_t bands[SW_MAX_BANDS];
+	s32 bands_len;
+
+	struct rcmdbuf_t *buf; // the buffer being executed
+
+	SDL_Renderer *renderer; // optional, for showing the framebuffer in a window
+	SDL_Texture *texture;
+
+	char *dumpdir; // when set, Present writes every frame here
+	u32 frame;
+
+	f64 execute_ms; // how long the last Execute took
+	f64 total_ms;   // and all of them, added up
+};
+
+// SWRenderInit : sets up the framebuffer; pool and renderer can be NULL
+s32 SWRenderInit(struct swrender_t *sw, s32 w, s32 h, struct jobpool_t *pool, SDL_Renderer *renderer);
+
+// SWRenderFree : releases the framebuffer
+void SWRenderFree(struct swrender_t *sw);
+
+// SWRenderBackend : fills out a render backend that draws with this software renderer
+void SWRenderBackend(struct rbackend_t *backend, struct swrender_t *sw);
+
+// SWRenderDump : writes the framebuffer out to disk as a binary ppm
+s32 SWRenderDump(struct swrender_t *sw, char *path);
+
+#endif // SWRENDER_H
+
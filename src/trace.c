@@ -0,0 +1,192 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-28 21:05:37
+ *
+ * Binary Trace Log
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+#include "trace.h"
+
+// TraceWriter : writes out each buffer it's handed, until it's told to quit
+static int TraceWriter(void *arg)
+{
+	struct trace_t *trace;
+
+	trace = arg;
+
+	while (1) {
+		SDL_SemWait(trace->full);
+
+		if (trace->quit)
+			break;
+
+		if (fwrite(trace->pending, sizeof(*trace->pending), trace->pending_len, trace->fp) != trace->pending_len) {
+			ERR("Couldn't write %u trace records\n", trace->pending_len);
+		}
+
+		SDL_SemPost(trace->empty);
+	}
+
+	return 0;
+}
+
+// TraceSwap : hands the buffer being filled to the writer, and starts on the other one
+static void TraceSwap(struct trace_t *trace)
+{
+	// the writer still has the other one if it's more than a whole buffer behind
+	SDL_SemWait(trace->empty);
+
+	trace->pending = trace->buf[trace->cur];
+	trace->pending_len = trace->len;
+
+	SDL_SemPost(trace->full);
+
+	trace->cur ^= 1;
+	trace->len = 0;
+}
+
+// TraceOpen : starts writing a trace to path
+s32 TraceOpen(struct trace_t *trace, char *path)
+{
+	struct traceheader_t header;
+
+	assert(trace);
+	assert(path);
+
+	memset(trace, 0, sizeof(*trace));
+
+	trace->fp = fopen(path, "wb");
+	if (trace->fp == NULL) {
+		ERR("Couldn't open '%s' to write the trace\n", path);
+		return -1;
+	}
+
+	memset(&header, 0, sizeof header);
+
+	memcpy(header.magic, TRACE_MAGIC, sizeof header.magic);
+	header.version = TRACE_VERSION;
+	header.recsize = sizeof(struct tracerec_t);
+	header.freq = SDL_GetPerformanceFrequency();
+	header.start = SDL_GetPerformanceCounter();
+
+	fwrite(&header, sizeof header, 1, trace->fp);
+
+	trace->buf[0] = C_CALLOC(MEM_DEBUG, TRACE_BUFFER, sizeof(struct tracerec_t));
+	trace->buf[1] = C_CALLOC(MEM_DEBUG, TRACE_BUFFER, sizeof(struct tracerec_t));
+	trace->full = SDL_CreateSemaphore(0);
+	trace->empty = SDL_CreateSemaphore(1);
+
+	if (!trace->buf[0] || !trace->buf[1] || !trace->full || !trace->empty) {
+		ERR("Couldn't set up the trace buffers\n");
+		goto fail;
+	}
+
+	trace->thread = SDL_CreateThread(TraceWriter, "trace", trace);
+	if (trace->thread == NULL) {
+		ERR("Couldn't create the trace writer thread: %s\n", SDL_GetError());
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	C_FREE(trace->buf[0]);
+	C_FREE(trace->buf[1]);
+	if (trace->full)
+		SDL_DestroySemaphore(trace->full);
+	if (trace->empty)
+		SDL_DestroySemaphore(trace->empty);
+	fclose(trace->fp);
+
+	memset(trace, 0, sizeof(*trace));
+
+	return -1;
+}
+
+// TraceClose : writes out what's left, and closes the trace
+void TraceClose(struct trace_t *trace)
+{
+	assert(trace);
+
+	if (trace->fp == NULL)
+		return;
+
+	if (trace->len) {
+		TraceSwap(trace);
+	}
+
+	// once it's done with the last buffer, it's waiting on full again
+	SDL_SemWait(trace->empty);
+
+	trace->quit = 1;
+	SDL_SemPost(trace->full);
+	SDL_WaitThread(trace->thread, NULL);
+
+	LOG("trace: %llu events\n", (unsigned long long)trace->records);
+
+	fclose(trace->fp);
+
+	C_FREE(trace->buf[0]);
+	C_FREE(trace->buf[1]);
+	SDL_DestroySemaphore(trace->full);
+	SDL_DestroySemaphore(trace->empty);
+
+	memset(trace, 0, sizeof(*trace));
+}
+
+// TraceNext : the next record to fill in
+static struct tracerec_t *TraceNext(struct trace_t *trace, u32 tick, u32 event)
+{
+	struct tracerec_t *rec;
+
+	if (trace->len == TRACE_BUFFER) {
+		TraceSwap(trace);
+	}
+
+	rec = trace->buf[trace->cur] + trace->len++;
+
+	rec->time = SDL_GetPerformanceCounter();
+	rec->tick = tick;
+	rec->event = event;
+	rec->reserved = 0;
+
+	trace->records++;
+
+	return rec;
+}
+
+// TraceEvent : records an event with four int arguments (see TRACE_EVENTS)
+void TraceEvent(struct trace_t *trace, u32 tick, u32 event, s32 a, s32 b, s32 c, s32 d)
+{
+	struct tracerec_t *rec;
+
+	if (trace->fp == NULL)
+		return;
+
+	rec = TraceNext(trace, tick, event);
+
+	rec->args[0].i = a;
+	rec->args[1].i = b;
+	rec->args[2].i = c;
+	rec->args[3].i = d;
+}
+
+// TraceEntity : records a spawn or destroy of an entity, at (x, y)
+void TraceEntity(struct trace_t *trace, u32 tick, u32 event, s32 kind, s32 id, f32 x, f32 y)
+{
+	struct tracerec_t *rec;
+
+	if (trace->fp == NULL)
+		return;
+
+	rec = TraceNext(trace, tick, event);
+
+	rec->args[0].i = kind;
+	rec->args[1].i = id;
+	rec->args[2].f = x;
+	rec->args[3].f = y;
+}
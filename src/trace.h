@@ -0,0 +1,111 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-28 21:05:37
+ *
+ * Binary Trace Log
+ *
+ * Structured events (spawns, deaths, collisions, input edges, screen changes), written as fixed
+ * size binary records instead of text, so there can be thousands a second without formatting
+ * anything. tools/tracedump.c turns a trace back into text or csv, offline. The file looks like:
+ *
+ *   traceheader_t
+ *   tracerec_t...
+ *
+ * Every record is the tick, the performance counter (the header has its frequency), the event, and
+ * four 32 bit arguments. What the arguments mean, and whether they're ints or floats, is in
+ * TRACE_EVENTS, which the writer and the decoder both use. Everything is little endian.
+ *
+ * Entity kinds are ENTITY_* in main.c (1 player, 2 asteroid, 3 bullet), keys are INPUT_KEY_* and
+ * key states INSTATE_* (io.h), and screens are GAMESCREEN_* (main.c).
+ *
+ * Writing is a copy into a buffer. A full buffer goes to a writer thread, and the next one gets
+ * filled in the meantime, so the caller only waits on the disk if it's behind by a whole buffer.
+ * The Trace* calls do nothing when the trace isn't open. It's meant for the main thread only.
+ */
+
+#include "common.h"
+
+#include <stdio.h>
+
+#define TRACE_MAGIC   ("ATRC")
+#define TRACE_VERSION (1)
+
+// records in each of the two buffers
+#define TRACE_BUFFER (4096)
+
+// X(id, name, arguments), the arguments are "name:type", i for an int, f for a float, - if unused
+#define TRACE_EVENTS(X) \
+	X(TRACE_SPAWN,   "spawn",   "kind:i id:i x:f y:f") \
+	X(TRACE_DESTROY, "destroy", "kind:i id:i x:f y:f") \
+	X(TRACE_COLLIDE, "collide", "kind:i id:i other_kind:i other_id:i") \
+	X(TRACE_INPUT,   "input",   "key:i state:i - -") \
+	X(TRACE_SCREEN,  "screen",  "from:i to:i - -")
+
+#define TRACE_ENUM(id, name, args) id,
+
+enum {
+	TRACE_NONE,
+	TRACE_EVENTS(TRACE_ENUM)
+	TRACE_TOTAL
+};
+
+#undef TRACE_ENUM
+
+struct traceheader_t {
+	char magic[4];
+	u32 version;
+	u32 recsize; // sizeof(struct tracerec_t)
+	u32 reserved;
+	u64 freq;    // performance counter ticks per second
+	u64 start;   // the performance counter when the trace was opened
+};
+
+union tracearg_t {
+	s32 i;
+	f32 f;
+};
+
+struct tracerec_t {
+	u64 time; // performance counter
+	u32 tick;
+	u16 event; // TRACE_*
+	u16 reserved;
+	union tracearg_t args[4];
+};
+
+struct trace_t {
+	FILE *fp;
+
+	// the one being filled, and the other one, which the writer might still have
+	struct tracerec_t *buf[2];
+	s32 cur;
+	u32 len;
+
+	// handed to the writer thread
+	struct tracerec_t *pending;
+	u32 pending_len;
+
+	struct SDL_Thread *thread;
+	struct SDL_semaphore *full;  // pending is ready to write
+	struct SDL_semaphore *empty; // the writer is done with pending
+	s32 quit;
+
+	u64 records;
+};
+
+// TraceOpen : starts writing a trace to path
+s32 TraceOpen(struct trace_t *trace, char *path);
+
+// TraceClose : writes out what's left, and closes the trace
+void TraceClose(struct trace_t *trace);
+
+// TraceEvent : records an event with four int arguments (see TRACE_EVENTS)
+void TraceEvent(struct trace_t *trace, u32 tick, u32 event, s32 a, s32 b, s32 c, s32 d);
+
+// TraceEntity : records a spawn or destroy of an entity, at (x, y)
+void TraceEntity(struct trace_t *trace, u32 tick, u32 event, s32 kind, s32 id, f32 x, f32 y);
+
+#endif // TRACE_H
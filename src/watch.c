@@ -0,0 +1,132 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-21 19:12:40
+ *
+ * Directory Watcher
+ */
+
+#include "common.h"
+
+#include "watch.h"
+
+#if defined(__linux__)
+
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+
+// how long the thread sleeps between checks of the quit flag
+#define WATCH_POLL_MS (100)
+
+// WatchThread : reads inotify events until we're told to quit
+static int WatchThread(void *arg)
+{
+	struct watch_t *watch;
+	struct inotify_event *event;
+	struct pollfd pfd;
+	char buf[BUFLARGE] __attribute__((aligned(__alignof__(struct inotify_event))));
+	char path[BUFLARGE];
+	ssize_t n;
+	char *p;
+
+	watch = arg;
+
+	pfd.fd = watch->fd;
+	pfd.events = POLLIN;
+
+	while (!SDL_AtomicGet(&watch->quit)) {
+		if (poll(&pfd, 1, WATCH_POLL_MS) <= 0)
+			continue;
+
+		n = read(watch->fd, buf, sizeof buf);
+		if (n <= 0)
+			continue;
+
+		for (p = buf; p < buf + n; p += sizeof(*event) + event->len) {
+			event = (struct inotify_event *)p;
+
+			if (event->len == 0 || (event->mask & IN_ISDIR))
+				continue;
+
+			snprintf(path, sizeof path, "%s/%s", watch->dir, event->name);
+
+			watch->func(watch->arg, path);
+		}
+	}
+
+	return 0;
+}
+
+// WatchStart : starts watching dir
+s32 WatchStart(struct watch_t *watch, char *dir, watchfunc_t func, void *arg)
+{
+	assert(watch);
+	assert(dir);
+	assert(func);
+
+	memset(watch, 0, sizeof(*watch));
+
+	watch->dir = dir;
+	watch->func = func;
+	watch->arg = arg;
+
+	watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch->fd < 0) {
+		ERR("Couldn't start inotify\n");
+		return -1;
+	}
+
+	if (inotify_add_watch(watch->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		ERR("Couldn't watch '%s'\n", dir);
+		close(watch->fd);
+		return -1;
+	}
+
+	watch->thread = SDL_CreateThread(WatchThread, "watch", watch);
+	if (watch->thread == NULL) {
+		ERR("Couldn't create the watcher thread: %s\n", SDL_GetError());
+		close(watch->fd);
+		return -1;
+	}
+
+	return 0;
+}
+
+// WatchStop : stops the watcher, and waits for the thread to go away
+void WatchStop(struct watch_t *watch)
+{
+	assert(watch);
+
+	if (watch->thread == NULL)
+		return;
+
+	SDL_AtomicSet(&watch->quit, 1);
+	SDL_WaitThread(watch->thread, NULL);
+
+	close(watch->fd);
+
+	memset(watch, 0, sizeof(*watch));
+}
+
+#else
+
+// WatchStart : starts watching dir
+s32 WatchStart(struct watch_t *watch, char *dir, watchfunc_t func, void *arg)
+{
+	assert(watch);
+
+	memset(watch, 0, sizeof(*watch));
+
+	ERR("Watching directories isn't supported on this platform\n");
+
+	return -1;
+}
+
+// WatchStop : stops the watcher, and waits for the thread to go away
+void WatchStop(struct watch_t *watch)
+{
+	assert(watch);
+}
+
+#endif
+
@@ -0,0 +1,41 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+/*
+ * Brian Chrzanowski
+ * 2021-01-21 19:12:40
+ *
+ * Directory Watcher
+ *
+ * A thread that sits on a directory, and calls func with the path ("dir/name") of every file that
+ * gets written (closed after writing, or renamed into place, which is what most editors do). The
+ * callback runs on the watcher thread, so it should just queue the path up for somebody else.
+ *
+ * This is inotify, so it's Linux only. Everywhere else WatchStart fails, and nothing else changes.
+ */
+
+#include "common.h"
+
+#include <SDL.h>
+
+typedef void (*watchfunc_t)(void *arg, char *path);
+
+struct watch_t {
+	SDL_Thread *thread;
+	SDL_atomic_t quit;
+
+	char *dir;
+	int fd; // inotify
+
+	watchfunc_t func;
+	void *arg;
+};
+
+// WatchStart : starts watching dir
+s32 WatchStart(struct watch_t *watch, char *dir, watchfunc_t func, void *arg);
+
+// WatchStop : stops the watcher, and waits for the thread to go away
+void WatchStop(struct watch_t *watch);
+
+#endif // WATCH_H
+
@@ -0,0 +1,333 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-17 15:40:27
+ *
+ * Pak Tool
+ *
+ * Builds a pak archive (see src/pak.h) out of a directory tree.
+ *
+ * USAGE
+ *
+ *   pak [-ext .png] out.pak dir...
+ *
+ * Entries are named by their path, exactly the way the game asks for them, so run this from the
+ * top of the repo (pak -ext .png assets.pak assets/sprites).
+ */
+
+#define COMMON_IMPLEMENTATION
+#include "../src/common.h"
+#undef COMMON_IMPLEMENTATION
+
+#include "../src/pak.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+struct file_t {
+	char *path;
+	u64 hash;
+	u64 offset;
+	u64 size;
+};
+
+struct files_t {
+	struct file_t *files;
+	size_t files_len, files_cap;
+	char *ext;
+};
+
+// HasExt : true if there's no filter, or the path ends in ext
+static int HasExt(char *path, char *ext)
+{
+	size_t plen, elen;
+
+	if (ext == NULL)
+		return 1;
+
+	plen = strlen(path);
+	elen = strlen(ext);
+
+	return plen >= elen && streq(path + plen - elen, ext);
+}
+
+// AddFile : adds a file to the list
+static void AddFile(struct files_t *list, char *path)
+{
+	struct file_t *file;
+
+	if (!HasExt(path, list->ext))
+		return;
+
+	if (strlen(path) >= PAK_NAMELEN) {
+		ERR("'%s' is too long for a pak name (%d), skipping\n", path, PAK_NAMELEN - 1);
+		return;
+	}
+
+	C_RESIZE(&list->files);
+
+	file = list->files + list->files_len++;
+	memset(file, 0, sizeof(*file));
+
+	file->path = strdup_null(path);
+	file->hash = PakHash(file->path);
+}
+
+// Walk : adds everything under dir to the list
+static void Walk(struct files_t *list, char *dir)
+{
+	char path[BUFLARGE];
+
+#if defined(_WIN32)
+	WIN32_FIND_DATAA data;
+	HANDLE find;
+
+	snprintf(path, sizeof path, "%s/*", dir);
+
+	find = FindFirstFileA(path, &data);
+	if (find == INVALID_HANDLE_VALUE) {
+		ERR("Couldn't open directory '%s'\n", dir);
+		return;
+	}
+
+	do {
+		if (streq(data.cFileName, ".") || streq(data.cFileName, ".."))
+			continue;
+
+		snprintf(path, sizeof path, "%s/%s", dir, data.cFileName);
+
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			Walk(list, path);
+		} else {
+			AddFile(list, path);
+		}
+	} while (FindNextFileA(find, &data));
+
+	FindClose(find);
+#else
+	struct dirent *ent;
+	struct stat st;
+	DIR *d;
+
+	d = opendir(dir);
+	if (d == NULL) {
+		ERR("Couldn't open directory '%s'\n", dir);
+		return;
+	}
+
+	while ((ent = readdir(d)) != NULL) {
+		if (streq(ent->d_name, ".") || streq(ent->d_name, ".."))
+			continue;
+
+		snprintf(path, sizeof path, "%s/%s", dir, ent->d_name);
+
+		if (stat(path, &st) < 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			Walk(list, path);
+		} else if (S_ISREG(st.st_mode)) {
+			AddFile(list, path);
+		}
+	}
+
+	closedir(d);
+#endif
+}
+
+// FileCmp : sorts files by (hash, path), the order PakFind expects
+static int FileCmp(const void *a, const void *b)
+{
+	const struct file_t *x, *y;
+
+	x = a;
+	y = b;
+
+	if (x->hash != y->hash)
+		return x->hash < y->hash ? -1 : 1;
+
+	return strcmp(x->path, y->path);
+}
+
+// Pad : writes zeros until the file is aligned
+static u64 Pad(FILE *fp, u64 offset)
+{
+	static u8 zeros[PAK_ALIGN];
+	u64 n;
+
+	n = (PAK_ALIGN - offset % PAK_ALIGN) % PAK_ALIGN;
+
+	fwrite(zeros, 1, n, fp);
+
+	return offset + n;
+}
+
+// WritePak : writes the archive out
+static s32 WritePak(struct files_t *list, char *outpath)
+{
+	struct pakheader_t header;
+	struct pakentry_t entry;
+	struct file_t *file;
+	FILE *fp, *in;
+	u8 buf[BUFLARGE];
+	u64 offset;
+	size_t i, n;
+
+	fp = fopen(outpath, "wb");
+	if (fp == NULL) {
+		ERR("Couldn't open '%s' for writing\n", outpath);
+		return -1;
+	}
+
+	memset(&header, 0, sizeof header);
+	memcpy(header.magic, PAK_MAGIC, sizeof header.magic);
+	header.version = PAK_VERSION;
+	header.count = list->files_len;
+
+	// lay the blobs out first, so the table of contents can be written in one go
+	offset = sizeof(header) + list->files_len * sizeof(entry);
+
+	for (i = 0; i < list->files_len; i++) {
+		file = list->files + i;
+
+		offset = (offset + PAK_ALIGN - 1) / PAK_ALIGN * PAK_ALIGN;
+
+		in = fopen(file->path, "rb");
+		if (in == NULL) {
+			ERR("Couldn't open '%s'\n", file->path);
+			fclose(fp);
+			return -1;
+		}
+
+		fseek(in, 0, SEEK_END);
+		file->size = ftell(in);
+		fclose(in);
+
+		file->offset = offset;
+		offset += file->size;
+	}
+
+	fwrite(&header, sizeof header, 1, fp);
+
+	for (i = 0; i < list->files_len; i++) {
+		file = list->files + i;
+
+		memset(&entry, 0, sizeof entry);
+		entry.hash = file->hash;
+		entry.offset = file->offset;
+		entry.size = file->size;
+		strncpy(entry.name, file->path, sizeof(entry.name) - 1);
+
+		fwrite(&entry, sizeof entry, 1, fp);
+	}
+
+	offset = sizeof(header) + list->files_len * sizeof(entry);
+
+	for (i = 0; i < list->files_len; i++) {
+		file = list->files + i;
+
+		offset = Pad(fp, offset);
+		assert(offset == file->offset);
+
+		in = fopen(file->path, "rb");
+		if (in == NULL) {
+			ERR("Couldn't open '%s'\n", file->path);
+			fclose(fp);
+			return -1;
+		}
+
+		while ((n = fread(buf, 1, sizeof buf, in)) > 0) {
+			fwrite(buf, 1, n, fp);
+			offset += n;
+		}
+
+		fclose(in);
+
+		if (offset != file->offset + file->size) {
+			ERR("'%s' changed while we were packing it\n", file->path);
+			fclose(fp);
+			return -1;
+		}
+
+		printf("%016llx %10llu %10llu %s\n", file->hash, file->offset, file->size, file->path);
+	}
+
+	if (fclose(fp) != 0) {
+		ERR("Couldn't finish writing '%s'\n", outpath);
+		return -1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct files_t list;
+	struct pak_t pak;
+	char *outpath;
+	s32 i, rc;
+
+	memset(&list, 0, sizeof list);
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (streq(argv[i], "-ext") && i + 1 < argc) {
+			list.ext = argv[++i];
+		} else {
+			break;
+		}
+	}
+
+	if (argc - i < 2) {
+		fprintf(stderr, "USAGE: %s [-ext .png] out.pak dir...\n", argv[0]);
+		return 1;
+	}
+
+	outpath = argv[i++];
+
+	for (; i < argc; i++) {
+		Walk(&list, argv[i]);
+	}
+
+	if (list.files_len == 0) {
+		ERR("Nothing to pack\n");
+		return 1;
+	}
+
+	qsort(list.files, list.files_len, sizeof(*list.files), FileCmp);
+
+	rc = WritePak(&list, outpath);
+
+	// make sure the game will actually be able to read it
+	if (rc == 0) {
+		if (PakOpen(&pak, outpath) < 0) {
+			ERR("Couldn't read '%s' back\n", outpath);
+			rc = -1;
+		} else {
+			for (i = 0; i < list.files_len; i++) {
+				if (PakFind(&pak, list.files[i].path) == NULL) {
+					ERR("'%s' is missing from '%s'\n", list.files[i].path, outpath);
+					rc = -1;
+				}
+			}
+
+			PakClose(&pak);
+		}
+	}
+
+	if (rc == 0) {
+		printf("packed %zu files into '%s'\n", list.files_len, outpath);
+	}
+
+	for (i = 0; i < list.files_len; i++) {
+		C_FREE(list.files[i].path);
+	}
+
+	C_FREE(list.files);
+
+	return rc == 0 ? 0 : 1;
+}
+
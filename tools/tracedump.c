@@ -0,0 +1,189 @@
+/*
+ * Brian Chrzanowski
+ * 2021-01-28 22:31:09
+ *
+ * Trace Dump
+ *
+ * Decodes a binary trace (see src/trace.h) into text, or csv.
+ *
+ * USAGE
+ *
+ *   tracedump [-csv] trace.bin
+ *
+ * Text is one event a line, with its arguments named. Csv has these columns:
+ *
+ *   tick,seconds,event,a,b,c,d
+ *
+ * and whatever an event doesn't use is left empty. Either way, how many of each event there were
+ * goes to stderr at the end.
+ */
+
+#define COMMON_IMPLEMENTATION
+#include "../src/common.h"
+#undef COMMON_IMPLEMENTATION
+
+#include "../src/trace.h"
+
+#define TRACE_NAME(id, name, args) [id] = name,
+#define TRACE_ARGS(id, name, args) [id] = args,
+
+static char *gEventNames[TRACE_TOTAL] = { TRACE_EVENTS(TRACE_NAME) };
+static char *gEventArgs[TRACE_TOTAL] = { TRACE_EVENTS(TRACE_ARGS) };
+
+#undef TRACE_NAME
+#undef TRACE_ARGS
+
+// argdesc_t : one argument, out of TRACE_EVENTS
+struct argdesc_t {
+	char name[32];
+	char type; // 'i', 'f', or '-' for unused
+};
+
+// ParseArgs : splits an event's "name:type ..." description into four arguments
+static void ParseArgs(char *desc, struct argdesc_t *args)
+{
+	char *p, *colon;
+	s32 i, n;
+
+	memset(args, 0, sizeof(*args) * 4);
+
+	for (i = 0, p = desc; i < 4; i++) {
+		args[i].type = '-';
+
+		while (*p == ' ')
+			p++;
+
+		n = strcspn(p, " ");
+		if (n == 0)
+			continue;
+
+		colon = memchr(p, ':', n);
+		if (colon) {
+			snprintf(args[i].name, sizeof args[i].name, "%.*s", (int)(colon - p), p);
+			args[i].type = colon[1];
+		}
+
+		p += n;
+	}
+}
+
+// PrintArg : writes one argument's value, the way its type says to
+static void PrintArg(FILE *fp, union tracearg_t arg, char type)
+{
+	if (type == 'f') {
+		fprintf(fp, "%.3f", arg.f);
+	} else if (type == 'i') {
+		fprintf(fp, "%d", arg.i);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct traceheader_t header;
+	struct tracerec_t recs[BUFSMALL], *rec;
+	struct argdesc_t descs[TRACE_TOTAL][4], *args, unknown[4];
+	u64 counts[TRACE_TOTAL + 1];
+	char *path, *name;
+	f64 seconds;
+	size_t n, i;
+	s32 csv, j;
+	FILE *fp;
+
+	csv = 0;
+	path = NULL;
+
+	for (j = 1; j < argc; j++) {
+		if (streq(argv[j], "-csv")) {
+			csv = 1;
+		} else if (path == NULL) {
+			path = argv[j];
+		} else {
+			path = NULL;
+			break;
+		}
+	}
+
+	if (path == NULL) {
+		fprintf(stderr, "USAGE: %s [-csv] trace.bin\n", argv[0]);
+		return 1;
+	}
+
+	fp = fopen(path, "rb");
+	if (fp == NULL) {
+		ERR("Couldn't open '%s'\n", path);
+		return 1;
+	}
+
+	if (fread(&header, sizeof header, 1, fp) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof header.magic) != 0) {
+		ERR("'%s' isn't a trace\n", path);
+		fclose(fp);
+		return 1;
+	}
+
+	if (header.version != TRACE_VERSION || header.recsize != sizeof(struct tracerec_t)) {
+		ERR("'%s' is trace version %u (%u byte records), this reads version %d (%zu byte records)\n",
+			path, header.version, header.recsize, TRACE_VERSION, sizeof(struct tracerec_t));
+		fclose(fp);
+		return 1;
+	}
+
+	for (j = 0; j < TRACE_TOTAL; j++) {
+		ParseArgs(gEventArgs[j] ? gEventArgs[j] : "", descs[j]);
+	}
+
+	ParseArgs("a:i b:i c:i d:i", unknown);
+
+	memset(counts, 0, sizeof counts);
+
+	if (csv) {
+		printf("tick,seconds,event,a,b,c,d\n");
+	}
+
+	while ((n = fread(recs, sizeof(*recs), ARRSIZE(recs), fp)) > 0) {
+		for (i = 0; i < n; i++) {
+			rec = recs + i;
+
+			if (rec->event < TRACE_TOTAL && gEventNames[rec->event]) {
+				name = gEventNames[rec->event];
+				args = descs[rec->event];
+				counts[rec->event]++;
+			} else {
+				name = "unknown";
+				args = unknown;
+				counts[TRACE_TOTAL]++;
+			}
+
+			seconds = (f64)(s64)(rec->time - header.start) / header.freq;
+
+			if (csv) {
+				printf("%u,%.6f,%s", rec->tick, seconds, name);
+				for (j = 0; j < 4; j++) {
+					putchar(',');
+					PrintArg(stdout, rec->args[j], args[j].type);
+				}
+			} else {
+				printf("%8u %12.6f %-8s", rec->tick, seconds, name);
+				for (j = 0; j < 4; j++) {
+					if (args[j].type == '-')
+						continue;
+					printf(" %s=", args[j].name);
+					PrintArg(stdout, rec->args[j], args[j].type);
+				}
+			}
+
+			putchar('\n');
+		}
+	}
+
+	fclose(fp);
+
+	for (j = 0; j < TRACE_TOTAL; j++) {
+		if (counts[j])
+			fprintf(stderr, "%-10s %10llu\n", gEventNames[j], (unsigned long long)counts[j]);
+	}
+
+	if (counts[TRACE_TOTAL])
+		fprintf(stderr, "%-10s %10llu\n", "unknown", (unsigned long long)counts[TRACE_TOTAL]);
+
+	return 0;
+}